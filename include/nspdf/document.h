@@ -15,11 +15,26 @@
 #ifndef NSPDF_DOCUMENT_H_
 #define NSPDF_DOCUMENT_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <nspdf/errors.h>
 
 struct nspdf_doc;
 
+/**
+ * byte source fetch callback
+ *
+ * Fills a buffer with document data from a random access source such as a
+ * chunked object store or a byte range fetcher.
+ *
+ * \param ctx The context passed to nspdf_document_open_source()
+ * \param offset The byte offset within the document to read from.
+ * \param buffer The buffer to fill.
+ * \param length The number of bytes required.
+ * \return NSPDFERROR_OK if all the requested bytes were read else error code.
+ */
+typedef nspdferror (*nspdf_source_fetch_fn)(void *ctx, uint64_t offset, uint8_t *buffer, size_t length);
+
 /**
  * create a new PDF document
  */
@@ -33,14 +48,114 @@ nspdferror nspdf_document_create(struct nspdf_doc **doc_out);
  */
 nspdferror nspdf_document_destroy(struct nspdf_doc *doc);
 
+/**
+ * set the maximum nesting depth of a document
+ *
+ * Arrays, dictionaries and indirect objects nested deeper than the limit are
+ * rejected with NSPDFERROR_RANGE. Parser state is held on the heap so the
+ * limit is not constrained by the C stack. Objects dereferenced while
+ * another is parsed, such as a stream length, are also limited by it. The
+ * chain of cross reference sections added by incremental updates is not
+ * limited by it.
+ *
+ * \param doc The document.
+ * \param max_depth The maximum depth or zero for the default.
+ */
+nspdferror nspdf_document_set_max_depth(struct nspdf_doc *doc, unsigned int max_depth);
+
 /**
  * parse a PDF from a memory buffer
  *
  * reads all metadata and validates header, trailer, xref table and page tree
- * ready to render pages. The passed buffer ownership is transfered and must
- * not be altered untill the document is destroyed.
+ * ready to render pages. The buffer contents are copied into a padded buffer
+ * owned by the document so it may be freed by the caller on return. Use
+ * nspdf_document_open_file() or nspdf_document_open_source() to avoid the copy.
+ */
+nspdferror nspdf_document_parse(struct nspdf_doc *doc, const uint8_t *buffer, size_t buffer_length);
+
+/**
+ * parse a PDF from a file
+ *
+ * The file is mapped read only and parsed in place instead of being read into
+ * a buffer so only the parts of the file actually used are paged in. The
+ * mapping is owned by the document and released when it is destroyed.
+ */
+nspdferror nspdf_document_open_file(struct nspdf_doc *doc, const char *filename);
+
+/**
+ * parse a PDF from a random access byte source
+ *
+ * Document data is fetched on demand through the callback in chunks which
+ * are held in a small cache so the whole document is never held in memory.
+ * The source must remain available until the document is destroyed.
+ *
+ * \param doc The document to parse into.
+ * \param fetch The callback used to read document data.
+ * \param ctx The context passed to the fetch callback.
+ * \param length The total length of the document data.
+ * \param chunk_size The size of cached chunks or zero for the default.
+ */
+nspdferror nspdf_document_open_source(struct nspdf_doc *doc, nspdf_source_fetch_fn fetch, void *ctx, uint64_t length, size_t chunk_size);
+
+/**
+ * get the chunk cache statistics of a document opened from a byte source
+ *
+ * \param doc The document.
+ * \param hits_out The number of chunk lookups satisfied by the cache.
+ * \param misses_out The number of chunk lookups which required a fetch.
+ * \return NSPDFERROR_OK and counters updated or NSPDFERROR_NOTFOUND if the
+ *         document is not using a byte source.
+ */
+nspdferror nspdf_document_source_stats(struct nspdf_doc *doc, uint64_t *hits_out, uint64_t *misses_out);
+
+/**
+ * get the object allocation statistics of a document
+ *
+ * Objects parsed from the document are allocated from a region owned by the
+ * document which is released when the document is destroyed.
+ *
+ * \param doc The document.
+ * \param allocs_out The number of allocations made from the region.
+ * \param bytes_out The number of bytes allocated from the region.
+ * \param blocks_out The number of blocks the region obtained from the heap.
+ * \return NSPDFERROR_OK and counters updated or NSPDFERROR_NOTFOUND if the
+ *         document has no input.
+ */
+nspdferror nspdf_document_arena_stats(struct nspdf_doc *doc, uint64_t *allocs_out, uint64_t *bytes_out, uint64_t *blocks_out);
+
+/**
+ * append data to a PDF being received progressively
+ *
+ * The data is copied into a buffer owned by the document and the document
+ * structure is decoded again as each block arrives until it succeeds. Once
+ * the document is ready it is decoded again whenever an end of file marker
+ * is appended so later incremental updates are used.
+ *
+ * \return NSPDFERROR_OK once the document is ready for page operations,
+ *         NSPDFERROR_INCOMPLETE if more data is required or an error code.
+ */
+nspdferror nspdf_document_append_data(struct nspdf_doc *doc, const uint8_t *data, unsigned int data_length);
+
+/**
+ * signal that all data for a progressively received PDF has been appended
+ *
+ * The document structure is decoded again if data was appended after the
+ * last decode.
+ *
+ * \return NSPDFERROR_OK if the document is ready or the error encountered
+ *         decoding the complete data.
+ */
+nspdferror nspdf_document_append_done(struct nspdf_doc *doc);
+
+/**
+ * query if a document is ready for page operations
+ *
+ * Page operations on a ready document which need objects that have not yet
+ * been received return NSPDFERROR_INCOMPLETE.
+ *
+ * \return NSPDFERROR_OK if the document is ready else NSPDFERROR_INCOMPLETE
  */
-nspdferror nspdf_document_parse(struct nspdf_doc *doc, const uint8_t *buffer, unsigned int buffer_length);
+nspdferror nspdf_document_ready(struct nspdf_doc *doc);
 
 
 #endif /* NSPDF_DOCUMENT_H_ */
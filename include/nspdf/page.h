@@ -78,4 +78,20 @@ nspdferror nspdf_page_count(struct nspdf_doc *doc, unsigned int *pages_out);
 
 nspdferror nspdf_page_render(struct nspdf_doc *doc, unsigned int page_num, struct nspdf_render_ctx* render_ctx);
 
+/**
+ * Get the byte range of a page within a linearized document.
+ *
+ * The range is taken from the page offset hint table and may be used to
+ *  prioritise fetching the data for a page.
+ *
+ * \param doc The document.
+ * \param page_number The page to get the range of.
+ * \param offset_out The byte offset of the start of the page objects.
+ * \param length_out The length of the page objects.
+ * \return NSPDFERROR_OK and outputs updated on success,
+ *         NSPDFERROR_NOTFOUND if the document has no page offset hints or
+ *         NSPDFERROR_RANGE if the page number is out of range.
+ */
+nspdferror nspdf_get_page_byte_range(struct nspdf_doc *doc, unsigned int page_number, uint64_t *offset_out, uint64_t *length_out);
+
 #endif /* NSPDF_META_H_ */
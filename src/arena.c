@@ -0,0 +1,309 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nspdf/errors.h>
+
+#include "arena.h"
+
+/** alignment of every allocation */
+#define ARENA_ALIGN 8
+
+/**
+ * block of memory allocations are made from
+ */
+struct arena_block {
+    struct arena_block *next; /**< previously filled block */
+    size_t size; /**< size of data area */
+    size_t used; /**< bytes of data area allocated */
+    uint8_t data[]; /**< data area */
+};
+
+/**
+ * resource owned by a region
+ */
+struct arena_adopted {
+    struct arena_adopted *next;
+    void *ptr;
+    nspdf_arena_release_fn *release;
+};
+
+/**
+ * counted reference held by a region
+ */
+struct arena_reference {
+    void *ptr; /**< resource or NULL if the slot is empty */
+    nspdf_arena_release_fn *release;
+};
+
+/** initial number of slots in the reference set */
+#define ARENA_REFERENCES_INITIAL 64
+
+/**
+ * release function for adopted heap allocations
+ */
+static void release_free(void *ptr)
+{
+    free(ptr);
+}
+
+/* exported interface documented in arena.h */
+nspdferror nspdf__arena_create(struct nspdf_arena **arena_out)
+{
+    struct nspdf_arena *arena;
+
+    arena = calloc(1, sizeof(struct nspdf_arena));
+    if (arena == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+
+    *arena_out = arena;
+
+    return NSPDFERROR_OK;
+}
+
+/* exported interface documented in arena.h */
+nspdferror nspdf__arena_destroy(struct nspdf_arena *arena)
+{
+    struct arena_adopted *adopted;
+    struct arena_block *block;
+    struct arena_reference *reference;
+    uint32_t idx;
+
+    /* adoption records are allocated within the blocks */
+    for (adopted = arena->adopted; adopted != NULL; adopted = adopted->next) {
+        adopted->release(adopted->ptr);
+    }
+
+    for (idx = 0; idx < arena->reference_alloc; idx++) {
+        reference = &arena->references[idx];
+        if (reference->ptr != NULL) {
+            reference->release(reference->ptr);
+        }
+    }
+    free(arena->references);
+
+    while (arena->block != NULL) {
+        block = arena->block;
+        arena->block = block->next;
+        free(block);
+    }
+    free(arena);
+
+    return NSPDFERROR_OK;
+}
+
+/* exported interface documented in arena.h */
+void *nspdf__arena_alloc(struct nspdf_arena *arena, size_t size)
+{
+    struct arena_block *block;
+    uint8_t *ptr;
+
+    size = (size + (ARENA_ALIGN - 1)) & ~((size_t)ARENA_ALIGN - 1);
+
+    block = arena->block;
+    if ((block == NULL) || (size > (block->size - block->used))) {
+        size_t block_size = ARENA_BLOCK_SIZE;
+
+        if (size > (block_size / 4)) {
+            /* large allocations get their own block so the remainder of the
+             * current block is not wasted
+             */
+            block_size = size;
+        }
+
+        block = malloc(sizeof(struct arena_block) + block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->size = block_size;
+        block->used = 0;
+
+        if ((arena->block != NULL) &&
+            (block_size == size) &&
+            ((arena->block->size - arena->block->used) > 0)) {
+            /* keep allocating from the current block */
+            block->next = arena->block->next;
+            arena->block->next = block;
+        } else {
+            block->next = arena->block;
+            arena->block = block;
+        }
+        arena->blocks++;
+    }
+
+    ptr = block->data + block->used;
+    block->used += size;
+    memset(ptr, 0, size);
+
+    arena->last = ptr;
+    arena->last_size = size;
+    arena->allocs++;
+    arena->bytes += size;
+
+    return ptr;
+}
+
+/* exported interface documented in arena.h */
+void *
+nspdf__arena_realloc(struct nspdf_arena *arena,
+                     void *ptr,
+                     size_t old_size,
+                     size_t size)
+{
+    struct arena_block *block;
+    uint8_t *nptr;
+
+    if (ptr == NULL) {
+        return nspdf__arena_alloc(arena, size);
+    }
+
+    block = arena->block;
+    if ((ptr == arena->last) &&
+        (block != NULL) &&
+        ((uint8_t *)ptr >= block->data) &&
+        ((uint8_t *)ptr < (block->data + block->used))) {
+        size_t aligned;
+
+        aligned = (size + (ARENA_ALIGN - 1)) & ~((size_t)ARENA_ALIGN - 1);
+        if (aligned <= (block->size - ((uint8_t *)ptr - block->data))) {
+            /* extend the most recent allocation in place */
+            block->used = ((uint8_t *)ptr - block->data) + aligned;
+            arena->bytes += aligned - arena->last_size;
+            arena->last_size = aligned;
+            return ptr;
+        }
+    }
+
+    nptr = nspdf__arena_alloc(arena, size);
+    if (nptr == NULL) {
+        return NULL;
+    }
+    memcpy(nptr, ptr, (old_size < size) ? old_size : size);
+
+    return nptr;
+}
+
+/* exported interface documented in arena.h */
+char *nspdf__arena_strdup(struct nspdf_arena *arena, const char *str)
+{
+    size_t len;
+    char *dup;
+
+    len = strlen(str) + 1;
+    dup = nspdf__arena_alloc(arena, len);
+    if (dup != NULL) {
+        memcpy(dup, str, len);
+    }
+    return dup;
+}
+
+/* exported interface documented in arena.h */
+nspdferror nspdf__arena_adopt(struct nspdf_arena *arena, void *ptr)
+{
+    return nspdf__arena_adopt_release(arena, ptr, release_free);
+}
+
+/* exported interface documented in arena.h */
+nspdferror
+nspdf__arena_adopt_release(struct nspdf_arena *arena,
+                           void *ptr,
+                           nspdf_arena_release_fn *release)
+{
+    struct arena_adopted *adopted;
+
+    adopted = nspdf__arena_alloc(arena, sizeof(struct arena_adopted));
+    if (adopted == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+    adopted->ptr = ptr;
+    adopted->release = release;
+    adopted->next = arena->adopted;
+    arena->adopted = adopted;
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * find the slot for a resource in the reference set
+ *
+ * \return The slot holding the resource or the empty slot it would occupy.
+ */
+static struct arena_reference *
+reference_slot(struct nspdf_arena *arena, void *ptr)
+{
+    uint32_t mask;
+    uint32_t idx;
+
+    mask = arena->reference_alloc - 1;
+    idx = ((uint32_t)((uintptr_t)ptr >> 4) * 0x9e3779b1U) & mask;
+    while ((arena->references[idx].ptr != NULL) &&
+           (arena->references[idx].ptr != ptr)) {
+        idx = (idx + 1) & mask;
+    }
+
+    return &arena->references[idx];
+}
+
+/* exported interface documented in arena.h */
+nspdferror
+nspdf__arena_adopt_reference(struct nspdf_arena *arena,
+                             void *ptr,
+                             nspdf_arena_release_fn *release)
+{
+    struct arena_reference *references; /* the set before it is grown */
+    struct arena_reference *slot;
+    uint32_t alloc; /* the size of the set before it is grown */
+    uint32_t idx;
+
+    if (arena->reference_alloc != 0) {
+        slot = reference_slot(arena, ptr);
+        if (slot->ptr != NULL) {
+            /* the region already holds a reference */
+            release(ptr);
+            return NSPDFERROR_OK;
+        }
+    }
+
+    /* the set is doubled in size when it becomes half full */
+    if ((arena->reference_count * 2) >= arena->reference_alloc) {
+        references = arena->references;
+        alloc = arena->reference_alloc;
+
+        arena->reference_alloc = (alloc == 0) ?
+            ARENA_REFERENCES_INITIAL : alloc * 2;
+        arena->references = calloc(arena->reference_alloc,
+                                   sizeof(struct arena_reference));
+        if (arena->references == NULL) {
+            arena->references = references;
+            arena->reference_alloc = alloc;
+            return NSPDFERROR_NOMEM;
+        }
+
+        for (idx = 0; idx < alloc; idx++) {
+            if (references[idx].ptr != NULL) {
+                *reference_slot(arena, references[idx].ptr) = references[idx];
+            }
+        }
+        free(references);
+    }
+
+    slot = reference_slot(arena, ptr);
+    slot->ptr = ptr;
+    slot->release = release;
+    arena->reference_count++;
+
+    return NSPDFERROR_OK;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/**
+ * \file
+ * NetSurf PDF library region allocator
+ *
+ * Objects parsed from a document are allocated from blocks owned by the
+ *  document and released together when the document is destroyed instead of
+ *  being freed individually.
+ */
+
+#ifndef NSPDF__ARENA_H_
+#define NSPDF__ARENA_H_
+
+/** size of the blocks allocations are made from */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+struct arena_block;
+struct arena_adopted;
+struct arena_reference;
+
+/**
+ * function called on an adopted pointer when its region is destroyed
+ */
+typedef void (nspdf_arena_release_fn)(void *ptr);
+
+/**
+ * region allocator
+ */
+struct nspdf_arena {
+    struct arena_block *block; /**< current block, heads list of all blocks */
+    struct arena_adopted *adopted; /**< resources released with arena */
+
+    uint32_t reference_count; /**< number of held references */
+    uint32_t reference_alloc; /**< number of reference slots, a power of two */
+    struct arena_reference *references; /**< set of held references */
+
+    uint8_t *last; /**< most recent allocation, may be extended in place */
+    size_t last_size; /**< size of most recent allocation */
+
+    uint64_t allocs; /**< number of allocations */
+    uint64_t bytes; /**< number of bytes allocated */
+    uint64_t blocks; /**< number of blocks allocated from the heap */
+};
+
+/**
+ * create a region allocator
+ */
+nspdferror nspdf__arena_create(struct nspdf_arena **arena_out);
+
+/**
+ * destroy a region allocator releasing all its allocations
+ */
+nspdferror nspdf__arena_destroy(struct nspdf_arena *arena);
+
+/**
+ * allocate zeroed memory from a region
+ *
+ * \return The allocation or NULL on memory exhaustion.
+ */
+void *nspdf__arena_alloc(struct nspdf_arena *arena, size_t size);
+
+/**
+ * change the size of a region allocation
+ *
+ * The most recent allocation is extended in place if there is space in its
+ *  block otherwise a new allocation is made and the contents copied. The
+ *  previous allocation is not reclaimed until the region is destroyed. Any
+ *  extension is not zeroed.
+ *
+ * \param arena The region.
+ * \param ptr The allocation to resize or NULL to make a new allocation.
+ * \param old_size The current size of the allocation.
+ * \param size The new size of the allocation.
+ * \return The resized allocation or NULL on memory exhaustion.
+ */
+void *nspdf__arena_realloc(struct nspdf_arena *arena, void *ptr, size_t old_size, size_t size);
+
+/**
+ * duplicate a string into a region
+ */
+char *nspdf__arena_strdup(struct nspdf_arena *arena, const char *str);
+
+/**
+ * transfer ownership of a heap allocation to a region
+ *
+ * The allocation is freed when the region is destroyed.
+ */
+nspdferror nspdf__arena_adopt(struct nspdf_arena *arena, void *ptr);
+
+/**
+ * transfer ownership of a resource to a region
+ *
+ * The release function is called on the resource when the region is
+ *  destroyed.
+ */
+nspdferror nspdf__arena_adopt_release(struct nspdf_arena *arena, void *ptr, nspdf_arena_release_fn *release);
+
+/**
+ * transfer a counted reference to a resource to a region
+ *
+ * A region holds at most one reference to each resource. If it already holds
+ *  one the passed reference is released straight away, otherwise the release
+ *  function is called on it when the region is destroyed. Either way the
+ *  resource remains valid for the lifetime of the region.
+ */
+nspdferror nspdf__arena_adopt_reference(struct nspdf_arena *arena, void *ptr, nspdf_arena_release_fn *release);
+
+#endif
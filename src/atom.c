@@ -0,0 +1,76 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <nspdf/errors.h>
+
+#include "atom.h"
+
+#define NSPDF_ATOM_DEFINE(NAME) lwc_string *nspdf__atom_##NAME;
+NSPDF_ATOMS(NSPDF_ATOM_DEFINE)
+#undef NSPDF_ATOM_DEFINE
+
+/** number of outstanding nspdf__atom_init() calls */
+static unsigned int atom_users;
+
+/**
+ * release all interned atoms
+ */
+static void atom_release(void)
+{
+#define NSPDF_ATOM_RELEASE(NAME)                \
+    if (nspdf__atom_##NAME != NULL) {           \
+        lwc_string_unref(nspdf__atom_##NAME);   \
+        nspdf__atom_##NAME = NULL;              \
+    }
+    NSPDF_ATOMS(NSPDF_ATOM_RELEASE)
+#undef NSPDF_ATOM_RELEASE
+}
+
+/* exported interface documented in atom.h */
+nspdferror nspdf__atom_init(void)
+{
+    lwc_error ret;
+
+    if (atom_users++ > 0) {
+        return NSPDFERROR_OK;
+    }
+
+#define NSPDF_ATOM_INTERN(NAME)                                         \
+    ret = lwc_intern_string(#NAME, strlen(#NAME), &nspdf__atom_##NAME); \
+    if (ret != lwc_error_ok) {                                          \
+        goto atom_init_error;                                           \
+    }
+    NSPDF_ATOMS(NSPDF_ATOM_INTERN)
+#undef NSPDF_ATOM_INTERN
+
+    return NSPDFERROR_OK;
+
+atom_init_error:
+    atom_release();
+    atom_users--;
+
+    return nspdf__lwc_error(ret);
+}
+
+/* exported interface documented in atom.h */
+nspdferror nspdf__atom_fini(void)
+{
+    if (atom_users == 0) {
+        return NSPDFERROR_OK;
+    }
+
+    if (--atom_users == 0) {
+        atom_release();
+    }
+
+    return NSPDFERROR_OK;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/**
+ * \file
+ * NetSurf PDF library interned name atoms
+ *
+ * Name objects are interned so names may be compared by pointer. Atoms for
+ *  the names the library looks up are interned once for the process while
+ *  any document exists.
+ */
+
+#ifndef NSPDF__ATOM_H_
+#define NSPDF__ATOM_H_
+
+#include <libwapcaplet/libwapcaplet.h>
+
+#include <nspdf/errors.h>
+
+/**
+ * list of predefined atoms
+ */
+#define NSPDF_ATOMS(ATOM)                       \
+    ATOM(ArtBox)                                \
+    ATOM(BleedBox)                              \
+    ATOM(Catalog)                               \
+    ATOM(Columns)                               \
+    ATOM(Contents)                              \
+    ATOM(Count)                                 \
+    ATOM(CropBox)                               \
+    ATOM(DecodeParms)                           \
+    ATOM(DeviceCMYK)                            \
+    ATOM(DeviceGray)                            \
+    ATOM(DeviceRGB)                             \
+    ATOM(E)                                     \
+    ATOM(Encrypt)                               \
+    ATOM(Filter)                                \
+    ATOM(First)                                 \
+    ATOM(FlateDecode)                           \
+    ATOM(H)                                     \
+    ATOM(ID)                                    \
+    ATOM(Index)                                 \
+    ATOM(Info)                                  \
+    ATOM(Kids)                                  \
+    ATOM(L)                                     \
+    ATOM(Length)                                \
+    ATOM(Linearized)                            \
+    ATOM(MediaBox)                              \
+    ATOM(N)                                     \
+    ATOM(O)                                     \
+    ATOM(ObjStm)                                \
+    ATOM(Page)                                  \
+    ATOM(Pages)                                 \
+    ATOM(Predictor)                             \
+    ATOM(Prev)                                  \
+    ATOM(Resources)                             \
+    ATOM(Root)                                  \
+    ATOM(Size)                                  \
+    ATOM(Title)                                 \
+    ATOM(TrimBox)                               \
+    ATOM(Type)                                  \
+    ATOM(W)                                     \
+    ATOM(XRef)                                  \
+    ATOM(XRefStm)
+
+#define NSPDF_ATOM_DECLARE(NAME) extern lwc_string *nspdf__atom_##NAME;
+NSPDF_ATOMS(NSPDF_ATOM_DECLARE)
+#undef NSPDF_ATOM_DECLARE
+
+/**
+ * intern the predefined atoms
+ *
+ * Calls are counted and the atoms are only interned on the first.
+ */
+nspdferror nspdf__atom_init(void);
+
+/**
+ * release the predefined atoms
+ *
+ * The atoms are released when there is a matching call for every call to
+ *  nspdf__atom_init()
+ */
+nspdferror nspdf__atom_fini(void);
+
+/**
+ * convert a libwapcaplet error into a library error
+ */
+static inline nspdferror nspdf__lwc_error(lwc_error ret)
+{
+    nspdferror res;
+
+    switch (ret) {
+    case lwc_error_ok:
+        res = NSPDFERROR_OK;
+        break;
+
+    case lwc_error_oom:
+        res = NSPDFERROR_NOMEM;
+        break;
+
+    case lwc_error_range:
+        res = NSPDFERROR_RANGE;
+        break;
+
+    default:
+        res = NSPDFERROR_NOTFOUND;
+        break;
+    }
+    return res;
+}
+
+#endif
@@ -24,6 +24,41 @@
 #define BC_DELM (1<<5) /* character is a delimiter */
 #define BC_CMNT (1<<6) /* character is a comment */
 
-const uint8_t *bclass;
+/**
+ * kind of token started by a byte
+ *
+ * The object and content stream lexers both dispatch on this so each token
+ *  goes straight to its scanner.
+ */
+enum bc_token {
+    BC_TOK_NONE = 0, /* byte cannot start a token */
+    BC_TOK_NUMBER, /* integer or real */
+    BC_TOK_STRING, /* literal string */
+    BC_TOK_NAME, /* name */
+    BC_TOK_ANGLE, /* hex string or dictionary */
+    BC_TOK_LIST, /* array */
+    BC_TOK_BOOLEAN, /* true or false, also content operators */
+    BC_TOK_NULL, /* null, also content operators */
+    BC_TOK_KEYWORD, /* any other regular byte such as content operators */
+};
+
+/** shift of the token kind within a byte class table entry */
+#define BC_TOKEN_SHIFT 8
+
+/**
+ * byte class table
+ *
+ * Each entry holds the BC_ classification of the byte in the low bits and the
+ *  kind of token it starts above BC_TOKEN_SHIFT.
+ */
+extern const uint16_t bclass[256];
+
+/**
+ * kind of token started by a byte
+ */
+static inline enum bc_token bclass_token(uint8_t c)
+{
+    return (enum bc_token)(bclass[c] >> BC_TOKEN_SHIFT);
+}
 
 #endif
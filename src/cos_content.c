@@ -14,11 +14,119 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <libwapcaplet/libwapcaplet.h>
+
 #include <nspdf/errors.h>
 
 #include "cos_object.h"
 #include "cos_content.h"
 #include "pdf_doc.h"
+#include "scratch.h"
+
+/**
+ * content stream operators
+ *
+ * Each operator is listed with the up to three bytes of its name, unused
+ *  bytes are zero.
+ */
+#define CONTENT_OPERATORS(OP)                  \
+    OP(CONTENT_OP_b, 'b', 0, 0)                \
+    OP(CONTENT_OP_B, 'B', 0, 0)                \
+    OP(CONTENT_OP_b_, 'b', '*', 0)             \
+    OP(CONTENT_OP_B_, 'B', '*', 0)             \
+    OP(CONTENT_OP_BDC, 'B', 'D', 'C')          \
+    OP(CONTENT_OP_BI, 'B', 'I', 0)             \
+    OP(CONTENT_OP_BMC, 'B', 'M', 'C')          \
+    OP(CONTENT_OP_BT, 'B', 'T', 0)             \
+    OP(CONTENT_OP_BX, 'B', 'X', 0)             \
+    OP(CONTENT_OP_c, 'c', 0, 0)                \
+    OP(CONTENT_OP_cm, 'c', 'm', 0)             \
+    OP(CONTENT_OP_CS, 'C', 'S', 0)             \
+    OP(CONTENT_OP_cs, 'c', 's', 0)             \
+    OP(CONTENT_OP_d, 'd', 0, 0)                \
+    OP(CONTENT_OP_d0, 'd', '0', 0)             \
+    OP(CONTENT_OP_d1, 'd', '1', 0)             \
+    OP(CONTENT_OP_Do, 'D', 'o', 0)             \
+    OP(CONTENT_OP_DP, 'D', 'P', 0)             \
+    OP(CONTENT_OP_EI, 'E', 'I', 0)             \
+    OP(CONTENT_OP_EMC, 'E', 'M', 'C')          \
+    OP(CONTENT_OP_ET, 'E', 'T', 0)             \
+    OP(CONTENT_OP_EX, 'E', 'X', 0)             \
+    OP(CONTENT_OP_f, 'f', 0, 0)                \
+    OP(CONTENT_OP_F, 'F', 0, 0)                \
+    OP(CONTENT_OP_f_, 'f', '*', 0)             \
+    OP(CONTENT_OP_G, 'G', 0, 0)                \
+    OP(CONTENT_OP_g, 'g', 0, 0)                \
+    OP(CONTENT_OP_gs, 'g', 's', 0)             \
+    OP(CONTENT_OP_h, 'h', 0, 0)                \
+    OP(CONTENT_OP_i, 'i', 0, 0)                \
+    OP(CONTENT_OP_ID, 'I', 'D', 0)             \
+    OP(CONTENT_OP_j, 'j', 0, 0)                \
+    OP(CONTENT_OP_J, 'J', 0, 0)                \
+    OP(CONTENT_OP_K, 'K', 0, 0)                \
+    OP(CONTENT_OP_k, 'k', 0, 0)                \
+    OP(CONTENT_OP_l, 'l', 0, 0)                \
+    OP(CONTENT_OP_m, 'm', 0, 0)                \
+    OP(CONTENT_OP_M, 'M', 0, 0)                \
+    OP(CONTENT_OP_MP, 'M', 'P', 0)             \
+    OP(CONTENT_OP_n, 'n', 0, 0)                \
+    OP(CONTENT_OP_q, 'q', 0, 0)                \
+    OP(CONTENT_OP_Q, 'Q', 0, 0)                \
+    OP(CONTENT_OP_re, 'r', 'e', 0)             \
+    OP(CONTENT_OP_RG, 'R', 'G', 0)             \
+    OP(CONTENT_OP_rg, 'r', 'g', 0)             \
+    OP(CONTENT_OP_ri, 'r', 'i', 0)             \
+    OP(CONTENT_OP_s, 's', 0, 0)                \
+    OP(CONTENT_OP_S, 'S', 0, 0)                \
+    OP(CONTENT_OP_SC, 'S', 'C', 0)             \
+    OP(CONTENT_OP_sc, 's', 'c', 0)             \
+    OP(CONTENT_OP_SCN, 'S', 'C', 'N')          \
+    OP(CONTENT_OP_scn, 's', 'c', 'n')          \
+    OP(CONTENT_OP_sh, 's', 'h', 0)             \
+    OP(CONTENT_OP_T_, 'T', '*', 0)             \
+    OP(CONTENT_OP_Tc, 'T', 'c', 0)             \
+    OP(CONTENT_OP_Td, 'T', 'd', 0)             \
+    OP(CONTENT_OP_TD, 'T', 'D', 0)             \
+    OP(CONTENT_OP_Tf, 'T', 'f', 0)             \
+    OP(CONTENT_OP_Tj, 'T', 'j', 0)             \
+    OP(CONTENT_OP_TJ, 'T', 'J', 0)             \
+    OP(CONTENT_OP_TL, 'T', 'L', 0)             \
+    OP(CONTENT_OP_Tm, 'T', 'm', 0)             \
+    OP(CONTENT_OP_Tr, 'T', 'r', 0)             \
+    OP(CONTENT_OP_Ts, 'T', 's', 0)             \
+    OP(CONTENT_OP_Tw, 'T', 'w', 0)             \
+    OP(CONTENT_OP_Tz, 'T', 'z', 0)             \
+    OP(CONTENT_OP_v, 'v', 0, 0)                \
+    OP(CONTENT_OP_w, 'w', 0, 0)                \
+    OP(CONTENT_OP_W, 'W', 0, 0)                \
+    OP(CONTENT_OP_W_, 'W', '*', 0)             \
+    OP(CONTENT_OP_y, 'y', 0, 0)                \
+    OP(CONTENT_OP__, '\'', 0, 0)               \
+    OP(CONTENT_OP___, '"', 0, 0)
+
+/**
+ * lookup key of an operator name
+ */
+#define CONTENT_OPERATOR_KEY(a, b, c)                                   \
+    (((b) == 0) ? (uint32_t)(a) :                                       \
+     ((c) == 0) ? (((uint32_t)(a) << 8) | (uint32_t)(b)) :              \
+     (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c)))
+
+/**
+ * operator hash table entry
+ *
+ * Operators sharing a slot would initialise the same entry twice which the
+ *  compiler warns of.
+ */
+#define CONTENT_OPERATOR_ENTRY(operator, a, b, c)                       \
+    [CONTENT_OPERATOR_HASH(CONTENT_OPERATOR_KEY(a, b, c))] =            \
+        (CONTENT_OPERATOR_KEY(a, b, c) |                                \
+         ((uint32_t)(operator) << CONTENT_OPERATOR_SHIFT)),
+
+/* exported interface documented in cos_content.h */
+const uint32_t nspdf__content_operators[CONTENT_OPERATOR_SLOTS] = {
+    CONTENT_OPERATORS(CONTENT_OPERATOR_ENTRY)
+};
 
 const char*
 nspdf__cos_content_operator_name(enum content_operator operator)
@@ -93,7 +201,7 @@ nspdf__cos_content_operator_name(enum content_operator operator)
     case CONTENT_OP_v: return "v";
     case CONTENT_OP_w: return "w";
     case CONTENT_OP_W: return "W";
-    case CONTENT_OP_W_: return "W_";
+    case CONTENT_OP_W_: return "W*";
     case CONTENT_OP_y: return "y";
     case CONTENT_OP__: return "\'";
     case CONTENT_OP___: return "\"";
@@ -103,351 +211,30 @@ nspdf__cos_content_operator_name(enum content_operator operator)
 
 
 /**
- * move number operands from list into operation
- *
- * This ensures all operands are correctly handled not just the wanted ones
- *
- * \param wanted The number of wanted operands to place in the operation
- * \param operands The array of operands from the parse
- * \param operand_idx The number of operands from the parse
- * \param operation_out The operation to place numbers in
+ * format operands are packed in
  */
-static nspdferror
-copy_numbers(unsigned int wanted,
-             struct cos_object **operands,
-             unsigned int *operand_idx,
-             struct content_operation *operation_out)
-{
-    nspdferror res;
-    unsigned int index = 0;
-
-    while ((index < (*operand_idx)) &&
-           (index < wanted)) {
-        /* process wanted operands */
-        res = cos_get_number(NULL,
-                             *(operands + index),
-                             &operation_out->u.number[index]);
-        if (res != NSPDFERROR_OK) {
-            printf("operand %d could not be set in operation (code %d)\n",
-                   index, res);
-        }
-        cos_free_object(*(operands + index));
-        index++;
-    }
-    if ((*operand_idx) > index) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), wanted, *operand_idx);
-        while (index < (*operand_idx)) {
-            cos_free_object(*(operands + index));
-            index++;
-        }
-    } else if ((*operand_idx) < index) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), wanted, *operand_idx);
-    }
-
-    *operand_idx = 0; /* all operands freed */
-
-    return NSPDFERROR_OK;
-}
-
-static nspdferror
-copy_integers(unsigned int wanted,
-             struct cos_object **operands,
-             unsigned int *operand_idx,
-             struct content_operation *operation_out)
-{
-    nspdferror res;
-    unsigned int index = 0;
-
-    while ((index < (*operand_idx)) &&
-           (index < wanted)) {
-        /* process wanted operands */
-        res = cos_get_int(NULL,
-                             *(operands + index),
-                             &operation_out->u.i[index]);
-        if (res != NSPDFERROR_OK) {
-            printf("operand %d could not be set in operation (code %d)\n",
-                   index, res);
-        }
-        cos_free_object(*(operands + index));
-        index++;
-    }
-    if ((*operand_idx) > index) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), wanted, *operand_idx);
-        while (index < (*operand_idx)) {
-            cos_free_object(*(operands + index));
-            index++;
-        }
-    } else if ((*operand_idx) < index) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), wanted, *operand_idx);
-    }
-
-    *operand_idx = 0; /* all operands freed */
-
-    return NSPDFERROR_OK;
-}
+enum content_format {
+    CONTENT_FORMAT_NUMBERS, /**< a count of floats */
+    CONTENT_FORMAT_INTEGERS, /**< a count of 64 bit integers */
+    CONTENT_FORMAT_STRING, /**< 32 bit length followed by string bytes */
+    CONTENT_FORMAT_ARRAY, /**< array object */
+    CONTENT_FORMAT_NAME, /**< interned name */
+    CONTENT_FORMAT_NAME_NUMBER, /**< interned name and float */
+    CONTENT_FORMAT_ARRAY_INT, /**< array object and 64 bit integer */
+};
 
-static nspdferror
-copy_string(struct cos_object **operands,
-             unsigned int *operand_idx,
-             struct content_operation *operation_out)
-{
-    nspdferror res;
-    unsigned int index = 0;
-    struct cos_string *string;
-
-    if ((*operand_idx) == 0) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 1, *operand_idx);
-        operation_out->u.string.length = 0;
-        return NSPDFERROR_OK;
-    }
-
-    /* process wanted operands */
-    res = cos_get_string(NULL, *operands, &string);
-    if (res != NSPDFERROR_OK) {
-        printf("string could not be set in operation (code %d)\n", res);
-        operation_out->u.string.length = 0;
-    } else {
-        operation_out->u.string.length = string->length;
-        if (string->length > content_string_intrnl_lngth) {
-            /* steal the string from the object */
-            operation_out->u.string.u.pdata = string->data;
-            string->alloc = 0;
-            string->length = 0;
-            /*printf("external string \"%.*s\"\n",
-              operation_out->u.string.length,
-              operation_out->u.string.u.pdata);*/
-        } else {
-            memcpy(operation_out->u.string.u.cdata,
-                   string->data,
-                   string->length);
-            /*printf("internal string \"%.*s\"\n",
-              operation_out->u.string.length,
-              operation_out->u.string.u.cdata);*/
-        }
-    }
-
-    if ((*operand_idx) > 1) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 1, *operand_idx);
-    }
-
-    /* free all operands */
-    while (index < (*operand_idx)) {
-        cos_free_object(*(operands + index));
-        index++;
-    }
-    *operand_idx = 0;
-
-    return NSPDFERROR_OK;
-}
-
-static nspdferror
-copy_array(struct cos_object **operands,
-             unsigned int *operand_idx,
-             struct content_operation *operation_out)
-{
-    unsigned int index = 0;
-
-    if ((*operand_idx) == 0) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 1, *operand_idx);
-        operation_out->u.array.length = 0;
-        return NSPDFERROR_OK;
-    }
-
-    /* process wanted operands */
-    if ((*operands)->type != COS_TYPE_ARRAY) {
-        printf("operand was not an array\n");
-        operation_out->u.array.length = 0;
-    } else {
-        operation_out->u.array.length = (*operands)->u.array->length;
-        /* steal the values from the array object */
-        operation_out->u.array.values = (*operands)->u.array->values;
-        (*operands)->u.array->alloc = 0;
-        (*operands)->u.array->length = 0;
-    }
-
-    if ((*operand_idx) > 1) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 1, *operand_idx);
-    }
-
-    /* free all operands */
-    while (index < (*operand_idx)) {
-        cos_free_object(*(operands + index));
-        index++;
-    }
-    *operand_idx = 0;
-
-    return NSPDFERROR_OK;
-}
-
-
-static nspdferror
-copy_name(struct cos_object **operands,
-          unsigned int *operand_idx,
-          struct content_operation *operation_out)
-{
-    unsigned int index = 0;
 
-    if ((*operand_idx) == 0) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 1, *operand_idx);
-        operation_out->u.name = NULL;
-        return NSPDFERROR_OK;
-    }
-
-    /* process wanted operands */
-    if ((*operands)->type != COS_TYPE_NAME) {
-        printf("operand was not a name\n");
-        operation_out->u.name = NULL;
-    } else {
-        /* steal the name from the name object */
-        operation_out->u.name = (*operands)->u.name;
-        (*operands)->u.name = NULL;
-    }
-
-    if ((*operand_idx) > 1) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 1, *operand_idx);
-    }
-
-    /* free all operands */
-    while (index < (*operand_idx)) {
-        cos_free_object(*(operands + index));
-        index++;
-    }
-    *operand_idx = 0;
-
-    return NSPDFERROR_OK;
-}
-
-static nspdferror
-copy_name_number(struct cos_object **operands,
-             unsigned int *operand_idx,
-             struct content_operation *operation_out)
-{
-    unsigned int index = 0;
-
-    if ((*operand_idx) == 0) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 2, *operand_idx);
-        operation_out->u.namenumber.name = NULL;
-        return NSPDFERROR_OK;
-    }
-
-    /* process wanted operands */
-    if ((*operands)->type != COS_TYPE_NAME) {
-        printf("operand was not a name\n");
-        operation_out->u.namenumber.name = NULL;
-    } else {
-        /* steal the name from the name object */
-        operation_out->u.namenumber.name = (*operands)->u.name;
-        (*operands)->u.name = NULL;
-
-        operation_out->u.namenumber.number = 0;
-        /* get the number */
-        if ((*operand_idx) > 1) {
-            nspdferror res;
-            res = cos_get_number(NULL,
-                                 *(operands + 1),
-                                 &operation_out->u.namenumber.number);
-            if (res != NSPDFERROR_OK) {
-                printf("operand 1 could not be set in operation (code %d)\n", res);
-            }
-        } else {
-            printf("operator %s that takes %d operands passed %d\n",
-                   nspdf__cos_content_operator_name(operation_out->operator), 2, *operand_idx);
-        }
-    }
-
-    if ((*operand_idx) > 2) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 2, *operand_idx);
-    }
-
-    /* free all operands */
-    while (index < (*operand_idx)) {
-        cos_free_object(*(operands + index));
-        index++;
-    }
-    *operand_idx = 0;
-
-    return NSPDFERROR_OK;
-}
-
-
-static nspdferror
-copy_array_int(struct cos_object **operands,
-             unsigned int *operand_idx,
-             struct content_operation *operation_out)
-{
-    unsigned int index = 0;
-
-    if ((*operand_idx) == 0) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 2, *operand_idx);
-        operation_out->u.namenumber.name = NULL;
-        return NSPDFERROR_OK;
-    }
-
-    /* process wanted operands */
-    if ((*operands)->type != COS_TYPE_ARRAY) {
-        printf("operand was not an array\n");
-        operation_out->u.arrayint.length = 0;
-        operation_out->u.arrayint.values = NULL;
-        operation_out->u.arrayint.i = 0;
-    } else {
-        operation_out->u.arrayint.length = (*operands)->u.array->length;
-        /* steal the values from the array object */
-        operation_out->u.arrayint.values = (*operands)->u.array->values;
-        (*operands)->u.array->alloc = 0;
-        (*operands)->u.array->length = 0;
-
-        operation_out->u.arrayint.i = 0;
-        /* get the int */
-        if ((*operand_idx) > 1) {
-            nspdferror res;
-            res = cos_get_int(NULL, *(operands + 1), &operation_out->u.arrayint.i);
-            if (res != NSPDFERROR_OK) {
-                printf("operand 1 could not be set in operation (code %d)\n", res);
-            }
-        } else {
-            printf("operator %s that takes %d operands passed %d\n",
-                   nspdf__cos_content_operator_name(operation_out->operator), 2, *operand_idx);
-        }
-    }
-
-    if ((*operand_idx) > 2) {
-        printf("operator %s that takes %d operands passed %d\n",
-               nspdf__cos_content_operator_name(operation_out->operator), 2, *operand_idx);
-    }
-
-    /* free all operands */
-    while (index < (*operand_idx)) {
-        cos_free_object(*(operands + index));
-        index++;
-    }
-    *operand_idx = 0;
-
-    return NSPDFERROR_OK;
-}
-
-/* exported interface documented in cos_content.h */
-nspdferror
-nspdf__cos_content_convert(enum content_operator operator,
-                           struct cos_object **operands,
-                           unsigned int *operand_idx,
-                           struct content_operation *operation_out)
+/**
+ * get the format the operands of an operator are packed in
+ *
+ * \param operator The operator
+ * \param count_out The number of numbers or integers for those formats
+ * \return The operand format
+ */
+static enum content_format
+content_operator_format(enum content_operator operator, unsigned int *count_out)
 {
-    nspdferror res;
-
-    operation_out->operator = operator;
+    *count_out = 0;
 
     switch (operator) {
     case CONTENT_OP_b:
@@ -475,7 +262,6 @@ nspdf__cos_content_convert(enum content_operator operator,
     case CONTENT_OP_W:
     case CONTENT_OP_W_:
         /* no operands */
-        res = copy_numbers(0, operands, operand_idx, operation_out);
         break;
 
     case CONTENT_OP_G:
@@ -489,7 +275,7 @@ nspdf__cos_content_convert(enum content_operator operator,
     case CONTENT_OP_Tz:
     case CONTENT_OP_w:
         /* one number */
-        res = copy_numbers(1, operands, operand_idx, operation_out);
+        *count_out = 1;
         break;
 
     case CONTENT_OP_d0:
@@ -498,13 +284,13 @@ nspdf__cos_content_convert(enum content_operator operator,
     case CONTENT_OP_Td:
     case CONTENT_OP_TD:
         /* two numbers */
-        res = copy_numbers(2, operands, operand_idx, operation_out);
+        *count_out = 2;
         break;
 
     case CONTENT_OP_RG:
     case CONTENT_OP_rg:
         /* three numbers */
-        res = copy_numbers(3, operands, operand_idx, operation_out);
+        *count_out = 3;
         break;
 
     case CONTENT_OP_K:
@@ -513,7 +299,7 @@ nspdf__cos_content_convert(enum content_operator operator,
     case CONTENT_OP_v:
     case CONTENT_OP_y:
         /* four numbers */
-        res = copy_numbers(4, operands, operand_idx, operation_out);
+        *count_out = 4;
         break;
 
     case CONTENT_OP_c:
@@ -521,24 +307,21 @@ nspdf__cos_content_convert(enum content_operator operator,
     case CONTENT_OP_d1:
     case CONTENT_OP_Tm:
         /* six numbers */
-        res = copy_numbers(6, operands, operand_idx, operation_out);
+        *count_out = 6;
         break;
 
     case CONTENT_OP_Tj:
     case CONTENT_OP__:
         /* single string */
-        res = copy_string(operands, operand_idx, operation_out);
-        break;
+        return CONTENT_FORMAT_STRING;
 
     case CONTENT_OP_TJ:
         /* single array */
-        res = copy_array(operands, operand_idx, operation_out);
-        break;
+        return CONTENT_FORMAT_ARRAY;
 
     case CONTENT_OP_Tf:
         /* name and number */
-        res = copy_name_number(operands, operand_idx, operation_out);
-        break;
+        return CONTENT_FORMAT_NAME_NUMBER;
 
     case CONTENT_OP_gs:
     case CONTENT_OP_Do:
@@ -549,20 +332,18 @@ nspdf__cos_content_convert(enum content_operator operator,
     case CONTENT_OP_MP:
     case CONTENT_OP_BMC:
         /* name */
-        res = copy_name(operands, operand_idx, operation_out);
-        break;
+        return CONTENT_FORMAT_NAME;
 
     case CONTENT_OP_j:
     case CONTENT_OP_J:
     case CONTENT_OP_Tr:
         /* one integer */
-        res = copy_integers(1, operands, operand_idx, operation_out);
-        break;
+        *count_out = 1;
+        return CONTENT_FORMAT_INTEGERS;
 
     case CONTENT_OP_d:
         /* array and int */
-        res = copy_array_int(operands, operand_idx, operation_out);
-        break;
+        return CONTENT_FORMAT_ARRAY_INT;
 
     case CONTENT_OP_BDC:
     case CONTENT_OP_DP:
@@ -571,9 +352,456 @@ nspdf__cos_content_convert(enum content_operator operator,
     case CONTENT_OP_SCN:
     case CONTENT_OP_scn:
     case CONTENT_OP___:
-        res = copy_numbers(0, operands, operand_idx, operation_out);
         break;
     }
 
+    return CONTENT_FORMAT_NUMBERS;
+}
+
+
+/**
+ * get the size of the packed operands of an operation
+ *
+ * \param format The format of the operands
+ * \param count The number of numbers or integers for those formats
+ * \param data The packed operands
+ */
+static size_t
+content_operands_size(enum content_format format,
+                      unsigned int count,
+                      const uint8_t *data)
+{
+    uint32_t length;
+
+    switch (format) {
+    case CONTENT_FORMAT_NUMBERS:
+        return count * sizeof(float);
+
+    case CONTENT_FORMAT_INTEGERS:
+        return count * sizeof(int64_t);
+
+    case CONTENT_FORMAT_STRING:
+        memcpy(&length, data, sizeof(length));
+        return sizeof(length) + length;
+
+    case CONTENT_FORMAT_ARRAY:
+        return sizeof(struct cos_object);
+
+    case CONTENT_FORMAT_NAME:
+        return sizeof(lwc_string *);
+
+    case CONTENT_FORMAT_NAME_NUMBER:
+        return sizeof(lwc_string *) + sizeof(float);
+
+    case CONTENT_FORMAT_ARRAY_INT:
+        return sizeof(struct cos_object) + sizeof(int64_t);
+    }
+    return 0;
+}
+
+
+/**
+ * report operators given the wrong number of operands
+ */
+static void
+check_operand_count(enum content_operator operator,
+                    unsigned int wanted,
+                    unsigned int operand_idx)
+{
+    if (operand_idx != wanted) {
+        printf("operator %s that takes %d operands passed %d\n",
+               nspdf__cos_content_operator_name(operator),
+               wanted,
+               operand_idx);
+    }
+}
+
+
+/**
+ * pack number operands
+ *
+ * Missing operands are packed as zero so every operation of an operator has
+ *  the same size.
+ *
+ * \param wanted The number of wanted operands to pack
+ * \param operands The array of operands from the parse
+ * \param operand_idx The number of operands from the parse
+ * \param scratch The scratch stack the operation is packed onto
+ */
+static nspdferror
+pack_numbers(unsigned int wanted,
+             struct cos_object *operands,
+             unsigned int operand_idx,
+             struct nspdf_scratch *scratch)
+{
+    nspdferror res;
+    unsigned int index;
+    float number;
+
+    for (index = 0; index < wanted; index++) {
+        number = 0;
+        if (index < operand_idx) {
+            res = cos_get_number(NULL, operands + index, &number);
+            if (res != NSPDFERROR_OK) {
+                printf("operand %d could not be set in operation (code %d)\n",
+                       index, res);
+            }
+        }
+        res = nspdf__scratch_push(scratch, &number, sizeof(number));
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+    }
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * pack integer operands
+ */
+static nspdferror
+pack_integers(unsigned int wanted,
+              struct cos_object *operands,
+              unsigned int operand_idx,
+              struct nspdf_scratch *scratch)
+{
+    nspdferror res;
+    unsigned int index;
+    int64_t integer;
+
+    for (index = 0; index < wanted; index++) {
+        integer = 0;
+        if (index < operand_idx) {
+            res = cos_get_int(NULL, operands + index, &integer);
+            if (res != NSPDFERROR_OK) {
+                printf("operand %d could not be set in operation (code %d)\n",
+                       index, res);
+            }
+        }
+        res = nspdf__scratch_push(scratch, &integer, sizeof(integer));
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+    }
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * pack a string operand inline
+ */
+static nspdferror
+pack_string(struct cos_object *operands,
+            unsigned int operand_idx,
+            struct nspdf_scratch *scratch)
+{
+    nspdferror res;
+    struct cos_string *string;
+    uint32_t length = 0;
+
+    if (operand_idx > 0) {
+        res = cos_get_string(NULL, operands, &string);
+        if (res != NSPDFERROR_OK) {
+            printf("string could not be set in operation (code %d)\n", res);
+        } else {
+            length = string->length;
+        }
+    }
+
+    res = nspdf__scratch_push(scratch, &length, sizeof(length));
+    if ((res != NSPDFERROR_OK) || (length == 0)) {
+        return res;
+    }
+    return nspdf__scratch_push(scratch, string->data, length);
+}
+
+
+/**
+ * pack an array operand
+ *
+ * The array object is taken from the operand and held by the content.
+ */
+static nspdferror
+pack_array(struct cos_object *operands,
+           unsigned int operand_idx,
+           struct nspdf_scratch *scratch)
+{
+    nspdferror res;
+    struct cos_object array;
+
+    array.type = COS_TYPE_NULL;
+    array.arena = false;
+
+    if (operand_idx > 0) {
+        if (operands->type != COS_TYPE_ARRAY) {
+            printf("operand was not an array\n");
+        } else {
+            array = *operands;
+            operands->type = COS_TYPE_NULL;
+        }
+    }
+
+    res = nspdf__scratch_push(scratch, &array, sizeof(array));
+    if (res != NSPDFERROR_OK) {
+        cos_free_value(&array);
+    }
+    return res;
+}
+
+
+/**
+ * pack a name operand
+ *
+ * The content holds its own reference to the name.
+ */
+static nspdferror
+pack_name(struct cos_object *operands,
+          unsigned int operand_idx,
+          struct nspdf_scratch *scratch)
+{
+    nspdferror res;
+    lwc_string *name = NULL;
+
+    if (operand_idx > 0) {
+        if (operands->type != COS_TYPE_NAME) {
+            printf("operand was not a name\n");
+        } else {
+            name = lwc_string_ref(operands->u.name);
+        }
+    }
+
+    res = nspdf__scratch_push(scratch, &name, sizeof(name));
+    if ((res != NSPDFERROR_OK) && (name != NULL)) {
+        lwc_string_unref(name);
+    }
     return res;
 }
+
+
+/* exported interface documented in cos_content.h */
+nspdferror
+nspdf__cos_content_convert(enum content_operator operator,
+                           struct cos_object *operands,
+                           unsigned int *operand_idx,
+                           struct nspdf_scratch *scratch)
+{
+    nspdferror res;
+    enum content_format format;
+    unsigned int count;
+    unsigned int index;
+    uint8_t code;
+
+    code = operator;
+    res = nspdf__scratch_push_byte(scratch, code);
+    if (res != NSPDFERROR_OK) {
+        goto cos_content_convert_done;
+    }
+
+    format = content_operator_format(operator, &count);
+    switch (format) {
+    case CONTENT_FORMAT_NUMBERS:
+        check_operand_count(operator, count, *operand_idx);
+        res = pack_numbers(count, operands, *operand_idx, scratch);
+        break;
+
+    case CONTENT_FORMAT_INTEGERS:
+        check_operand_count(operator, count, *operand_idx);
+        res = pack_integers(count, operands, *operand_idx, scratch);
+        break;
+
+    case CONTENT_FORMAT_STRING:
+        check_operand_count(operator, 1, *operand_idx);
+        res = pack_string(operands, *operand_idx, scratch);
+        break;
+
+    case CONTENT_FORMAT_ARRAY:
+        check_operand_count(operator, 1, *operand_idx);
+        res = pack_array(operands, *operand_idx, scratch);
+        break;
+
+    case CONTENT_FORMAT_NAME:
+        check_operand_count(operator, 1, *operand_idx);
+        res = pack_name(operands, *operand_idx, scratch);
+        break;
+
+    case CONTENT_FORMAT_NAME_NUMBER:
+        check_operand_count(operator, 2, *operand_idx);
+        res = pack_name(operands, *operand_idx, scratch);
+        if (res == NSPDFERROR_OK) {
+            res = pack_numbers(1,
+                               operands + 1,
+                               (*operand_idx > 1) ? 1 : 0,
+                               scratch);
+        }
+        break;
+
+    case CONTENT_FORMAT_ARRAY_INT:
+        check_operand_count(operator, 2, *operand_idx);
+        res = pack_array(operands, *operand_idx, scratch);
+        if (res == NSPDFERROR_OK) {
+            res = pack_integers(1,
+                                operands + 1,
+                                (*operand_idx > 1) ? 1 : 0,
+                                scratch);
+        }
+        break;
+    }
+
+cos_content_convert_done:
+    /* free all operands */
+    for (index = 0; index < *operand_idx; index++) {
+        cos_free_value(operands + index);
+    }
+    *operand_idx = 0;
+
+    return res;
+}
+
+
+/**
+ * get the array a packed array operand holds
+ */
+static inline void
+unpack_array(const uint8_t *data,
+             unsigned int *length_out,
+             struct cos_object **values_out)
+{
+    struct cos_object array;
+
+    memcpy(&array, data, sizeof(array));
+    if (array.type == COS_TYPE_ARRAY) {
+        *length_out = array.u.array->length;
+        *values_out = array.u.array->values;
+    } else {
+        *length_out = 0;
+        *values_out = NULL;
+    }
+}
+
+
+/* exported interface documented in cos_content.h */
+nspdferror
+nspdf__cos_content_next(const struct cos_content *content,
+                        size_t *offset,
+                        struct content_operation *operation_out)
+{
+    const uint8_t *data;
+    enum content_format format;
+    unsigned int count;
+    uint32_t length;
+
+    if (*offset >= content->size) {
+        return NSPDFERROR_NOTFOUND;
+    }
+    data = content->operations + *offset;
+
+    operation_out->operator = (enum content_operator)*data;
+    data++;
+
+    format = content_operator_format(operation_out->operator, &count);
+    switch (format) {
+    case CONTENT_FORMAT_NUMBERS:
+        memcpy(operation_out->u.number, data, count * sizeof(float));
+        break;
+
+    case CONTENT_FORMAT_INTEGERS:
+        memcpy(operation_out->u.i, data, count * sizeof(int64_t));
+        break;
+
+    case CONTENT_FORMAT_STRING:
+        memcpy(&length, data, sizeof(length));
+        operation_out->u.string.length = length;
+        if (length > content_string_intrnl_lngth) {
+            operation_out->u.string.u.pdata = (uint8_t *)data + sizeof(length);
+        } else {
+            memcpy(operation_out->u.string.u.cdata,
+                   data + sizeof(length),
+                   length);
+        }
+        break;
+
+    case CONTENT_FORMAT_ARRAY:
+        unpack_array(data,
+                     &operation_out->u.array.length,
+                     &operation_out->u.array.values);
+        break;
+
+    case CONTENT_FORMAT_NAME:
+        memcpy(&operation_out->u.name, data, sizeof(lwc_string *));
+        break;
+
+    case CONTENT_FORMAT_NAME_NUMBER:
+        memcpy(&operation_out->u.namenumber.name, data, sizeof(lwc_string *));
+        memcpy(&operation_out->u.namenumber.number,
+               data + sizeof(lwc_string *),
+               sizeof(float));
+        break;
+
+    case CONTENT_FORMAT_ARRAY_INT:
+        unpack_array(data,
+                     &operation_out->u.arrayint.length,
+                     &operation_out->u.arrayint.values);
+        memcpy(&operation_out->u.arrayint.i,
+               data + sizeof(struct cos_object),
+               sizeof(int64_t));
+        break;
+    }
+
+    data += content_operands_size(format, count, data);
+    *offset = data - content->operations;
+
+    return NSPDFERROR_OK;
+}
+
+
+/* exported interface documented in cos_content.h */
+void nspdf__cos_content_release(const uint8_t *operations, size_t size)
+{
+    const uint8_t *data;
+    const uint8_t *end;
+    enum content_format format;
+    unsigned int count;
+    struct cos_object array;
+    lwc_string *name;
+
+    data = operations;
+    end = data + size;
+    while (data < end) {
+        format = content_operator_format((enum content_operator)*data,
+                                         &count);
+        data++;
+
+        switch (format) {
+        case CONTENT_FORMAT_NAME:
+        case CONTENT_FORMAT_NAME_NUMBER:
+            memcpy(&name, data, sizeof(name));
+            if (name != NULL) {
+                lwc_string_unref(name);
+            }
+            break;
+
+        case CONTENT_FORMAT_ARRAY:
+        case CONTENT_FORMAT_ARRAY_INT:
+            memcpy(&array, data, sizeof(array));
+            cos_free_value(&array);
+            break;
+
+        default:
+            break;
+        }
+
+        data += content_operands_size(format, count, data);
+    }
+}
+
+
+/* exported interface documented in cos_content.h */
+void nspdf__cos_content_free(struct cos_content *content)
+{
+    nspdf__cos_content_release(content->operations, content->size);
+
+    free(content->operations);
+    free(content);
+}
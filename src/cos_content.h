@@ -192,14 +192,23 @@ enum content_operator {
  */
 #define content_string_intrnl_lngth ((sizeof(float) * content_number_size) - sizeof(uint8_t *))
 
+struct lwc_string_s;
+struct nspdf_scratch;
 
+/**
+ * decoded content operation
+ *
+ * Operations are held packed in parsed content and decoded into this form
+ *  one at a time by nspdf__cos_content_next(). Strings and arrays refer to
+ *  storage owned by the content.
+ */
 struct content_operation {
     enum content_operator operator;
 
     union {
         float number[content_number_size];
 
-        char *name;
+        struct lwc_string_s *name;
 
         int64_t i[3];
 
@@ -213,17 +222,17 @@ struct content_operation {
 
         struct {
             unsigned int length;
-            struct cos_object **values;
+            struct cos_object *values;
         } array;
 
         struct {
-            char *name;
+            struct lwc_string_s *name;
             float number;
         } namenumber;
 
         struct {
             unsigned int length;
-            struct cos_object **values;
+            struct cos_object *values;
             int64_t i;
         } arrayint;
 
@@ -232,11 +241,17 @@ struct content_operation {
 
 /**
  * Synthetic parsed content object.
+ *
+ * Each operation is packed as its operator in a single byte followed by the
+ *  operands that operator takes, so operations without operands occupy one
+ *  byte. Numbers are held as floats, strings are held inline after their
+ *  length and names and arrays are held by reference. Operands are not
+ *  aligned.
  */
 struct cos_content {
     unsigned int length; /**< number of content operations */
-    unsigned int alloc; /**< number of allocated operations */
-    struct content_operation *operations;
+    size_t size; /**< size of packed operations in bytes */
+    uint8_t *operations; /**< packed operations */
 };
 
 
@@ -244,9 +259,89 @@ const char* nspdf__cos_content_operator_name(enum content_operator operator);
 
 
 /**
- * convert an operator and operand list into an operation
+ * number of slots in the operator hash table
+ */
+#define CONTENT_OPERATOR_SLOTS 256
+
+/**
+ * operator hash of a lookup key
+ *
+ * The multiplier was searched for so every operator has a slot to itself.
+ */
+#define CONTENT_OPERATOR_HASH(key) \
+    ((uint32_t)((uint32_t)(key) * 0x86469fb5U) >> 24)
+
+/**
+ * shift of the operator within an operator hash table entry
+ *
+ * The lookup key of the operator is held below this.
+ */
+#define CONTENT_OPERATOR_SHIFT 24
+
+/**
+ * operator perfect hash table
+ */
+extern const uint32_t nspdf__content_operators[CONTENT_OPERATOR_SLOTS];
+
+/**
+ * look up a content operator
+ *
+ * \param key The up to three bytes of the operator name packed most
+ *             significant first.
+ * \param operator_out The operator with that name.
+ * \return NSPDFERROR_OK and operator_out updated or NSPDFERROR_NOTFOUND if the
+ *          key is not an operator.
+ */
+static inline nspdferror
+nspdf__cos_content_operator(uint32_t key, enum content_operator *operator_out)
+{
+    uint32_t entry;
+
+    entry = nspdf__content_operators[CONTENT_OPERATOR_HASH(key)];
+    if ((entry & ((1U << CONTENT_OPERATOR_SHIFT) - 1)) != key) {
+        return NSPDFERROR_NOTFOUND;
+    }
+    *operator_out = (enum content_operator)(entry >> CONTENT_OPERATOR_SHIFT);
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * convert an operator and operand list into a packed operation
+ *
+ * The packed operation is pushed onto the scratch stack and all the operands
+ *  are consumed.
+ */
+nspdferror nspdf__cos_content_convert(enum content_operator operator, struct cos_object *operands, unsigned int *operand_idx, struct nspdf_scratch *scratch);
+
+
+/**
+ * decode the next operation from parsed content
+ *
+ * \param content The parsed content.
+ * \param offset The offset of the packed operation to decode which starts at
+ *               zero and is updated to the following operation.
+ * \param operation_out The decoded operation.
+ * \return NSPDFERROR_OK and operation_out updated or NSPDFERROR_NOTFOUND when
+ *          there are no further operations.
+ */
+nspdferror nspdf__cos_content_next(const struct cos_content *content, size_t *offset, struct content_operation *operation_out);
+
+
+/**
+ * release the operands held by packed operations
+ *
+ * \param operations The packed operations.
+ * \param size The size of the packed operations in bytes.
+ */
+void nspdf__cos_content_release(const uint8_t *operations, size_t size);
+
+
+/**
+ * free parsed content and the operands it holds
  */
-nspdferror nspdf__cos_content_convert(enum content_operator operator, struct cos_object **operands, unsigned int *operand_idx, struct content_operation *operation_out);
+void nspdf__cos_content_free(struct cos_content *content);
 
 
 #endif
@@ -14,9 +14,12 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <libwapcaplet/libwapcaplet.h>
+
 #include <nspdf/errors.h>
 
 #include "xref.h"
+#include "arena.h"
 #include "cos_content.h"
 #include "cos_object.h"
 #include "cos_parse.h"
@@ -36,10 +39,10 @@ static nspdferror cos_dump_object(const char *fmt, struct cos_object *cos_obj)
 
     case COS_TYPE_REFERENCE:
         printf("  type = COS_TYPE_REFERENCE\n"
-               "  u.reference->id = %lu\n"
-               "  u.reference->generation = %lu\n",
-               cos_obj->u.reference->id,
-               cos_obj->u.reference->generation);
+               "  u.reference.id = %u\n"
+               "  u.reference.generation = %u\n",
+               cos_obj->u.reference.id,
+               cos_obj->u.reference.generation);
         break;
 
     case COS_TYPE_NULL:
@@ -49,10 +52,10 @@ static nspdferror cos_dump_object(const char *fmt, struct cos_object *cos_obj)
     case COS_TYPE_CONTENT:
         printf("  type = COS_TYPE_CONTENT\n"
                "  u.content->length = %d\n"
-               "  u.content->alloc = %d\n"
+               "  u.content->size = %zu\n"
                "  u.content->operations = %p\n",
                cos_obj->u.content->length,
-               cos_obj->u.content->alloc,
+               cos_obj->u.content->size,
                cos_obj->u.content->operations);
         break;
 
@@ -70,7 +73,8 @@ static nspdferror cos_dump_object(const char *fmt, struct cos_object *cos_obj)
         break;
 
     case COS_TYPE_NAME:
-        printf("  type = COS_TYPE_NAME\n  u.name = %s\n", cos_obj->u.name);
+        printf("  type = COS_TYPE_NAME\n  u.name = %s\n",
+               lwc_string_data(cos_obj->u.name));
         break;
 
     case COS_TYPE_STRING:
@@ -122,14 +126,31 @@ static nspdferror cos_dump_object(const char *fmt, struct cos_object *cos_obj)
     return NSPDFERROR_OK;
 }
 
-nspdferror cos_free_object(struct cos_object *cos_obj)
+/**
+ * arena release function for parsed content
+ */
+static void release_content(void *content)
+{
+    nspdf__cos_content_free((struct cos_content *)content);
+}
+
+/* exported interface documented in cos_object.h */
+nspdferror cos_free_value(struct cos_object *cos_obj)
 {
-    struct cos_dictionary_entry *dentry;
+    struct cos_dictionary *dict;
     unsigned int aentry;
 
+    if (cos_obj->arena) {
+        /* contents are released with the document arena */
+        cos_obj->type = COS_TYPE_NULL;
+        return NSPDFERROR_OK;
+    }
+
     switch (cos_obj->type) {
     case COS_TYPE_NAME:
-        free(cos_obj->u.name);
+        if (cos_obj->u.name != NULL) {
+            lwc_string_unref(cos_obj->u.name);
+        }
         break;
 
     case COS_TYPE_STRING:
@@ -138,40 +159,141 @@ nspdferror cos_free_object(struct cos_object *cos_obj)
         break;
 
     case COS_TYPE_DICTIONARY:
-        dentry = cos_obj->u.dictionary;
-        while (dentry != NULL) {
-            struct cos_dictionary_entry *odentry;
-
-            cos_free_object(dentry->key);
-            cos_free_object(dentry->value);
-
-            odentry = dentry;
-            dentry = dentry->next;
-            free(odentry);
+        dict = cos_obj->u.dictionary;
+        if (dict == NULL) {
+            break;
+        }
+        for (aentry = 0; aentry < dict->length; aentry++) {
+            if (dict->entries[aentry].key != NULL) {
+                lwc_string_unref(dict->entries[aentry].key);
+                cos_free_value(&dict->entries[aentry].value);
+            }
         }
+        free(dict->entries);
+        free(dict->index);
+        free(dict);
         break;
 
     case COS_TYPE_ARRAY:
-        if (cos_obj->u.array->alloc > 0) {
-            for (aentry = 0; aentry < cos_obj->u.array->length; aentry++) {
-                cos_free_object(*(cos_obj->u.array->values + aentry));
-            }
-            free(cos_obj->u.array->values);
+        if (cos_obj->u.array == NULL) {
+            break;
+        }
+        for (aentry = 0; aentry < cos_obj->u.array->length; aentry++) {
+            cos_free_value(&cos_obj->u.array->values[aentry]);
         }
+        free(cos_obj->u.array->values);
         free(cos_obj->u.array);
         break;
 
     case COS_TYPE_STREAM:
+        if (cos_obj->u.stream->alloc != 0) {
+            /* stream data was allocated when read or filtered */
+            free((void *)cos_obj->u.stream->data);
+        }
         free(cos_obj->u.stream);
         break;
 
+    case COS_TYPE_CONTENT:
+        if (cos_obj->u.content != NULL) {
+            nspdf__cos_content_free(cos_obj->u.content);
+        }
+        break;
+
     }
+    cos_obj->type = COS_TYPE_NULL;
+
+    return NSPDFERROR_OK;
+}
+
+/* exported interface documented in cos_object.h */
+nspdferror cos_free_object(struct cos_object *cos_obj)
+{
+    if (cos_obj->arena) {
+        /* released with the document arena */
+        return NSPDFERROR_OK;
+    }
+
+    cos_free_value(cos_obj);
     free(cos_obj);
 
     return NSPDFERROR_OK;
 }
 
 
+/**
+ * first index slot for a key
+ *
+ * Keys are interned so the name pointer is hashed.
+ */
+static inline unsigned int
+dictionary_slot(const struct cos_dictionary *dict, const lwc_string *key)
+{
+    uint64_t hash;
+
+    hash = (uintptr_t)key;
+    hash = (hash ^ (hash >> 29)) * 0x9e3779b97f4a7c15ULL;
+
+    return (unsigned int)(hash >> 32) & (dict->index_size - 1);
+}
+
+/* exported interface documented in cos_object.h */
+void cos_dictionary_index(struct cos_dictionary *dict)
+{
+    unsigned int entry;
+    unsigned int slot;
+
+    memset(dict->index, 0, dict->index_size * sizeof(unsigned int));
+
+    for (entry = 0; entry < dict->length; entry++) {
+        if (dict->entries[entry].key == NULL) {
+            /* extracted entry */
+            continue;
+        }
+        slot = dictionary_slot(dict, dict->entries[entry].key);
+        while (dict->index[slot] != 0) {
+            if (dict->entries[dict->index[slot] - 1].key ==
+                dict->entries[entry].key) {
+                /* repeated key, the later entry replaces it */
+                break;
+            }
+            slot = (slot + 1) & (dict->index_size - 1);
+        }
+        dict->index[slot] = entry + 1;
+    }
+}
+
+/**
+ * find the entry for a key in a dictionary
+ *
+ * \return The entry number or -1 if the key is not present.
+ */
+static int
+dictionary_find(const struct cos_dictionary *dict, const lwc_string *key)
+{
+    unsigned int slot;
+    int entry;
+
+    if (dict->index_size == 0) {
+        /* search from the end so the last repeated key is found */
+        for (entry = dict->length - 1; entry >= 0; entry--) {
+            if (dict->entries[entry].key == key) {
+                return entry;
+            }
+        }
+        return -1;
+    }
+
+    slot = dictionary_slot(dict, key);
+    while (dict->index[slot] != 0) {
+        entry = dict->index[slot] - 1;
+        if (dict->entries[entry].key == key) {
+            return entry;
+        }
+        slot = (slot + 1) & (dict->index_size - 1);
+    }
+    return -1;
+}
+
 /*
  * extracts a value for a key in a dictionary.
  *
@@ -180,7 +302,7 @@ nspdferror cos_free_object(struct cos_object *cos_obj)
 nspdferror
 cos_extract_dictionary_value(struct nspdf_doc *doc,
                              struct cos_object *dict,
-                             const char *key,
+                             lwc_string *key,
                              struct cos_object **value_out)
 {
     nspdferror res;
@@ -191,24 +313,35 @@ cos_extract_dictionary_value(struct nspdf_doc *doc,
             res = NSPDFERROR_TYPE;
 
         } else {
-            struct cos_dictionary_entry **prev;
-            struct cos_dictionary_entry *entry;
-
-            res = NSPDFERROR_NOTFOUND;
-
-            prev = &dict->u.dictionary;
-            entry = *prev;
-            while (entry != NULL) {
-                if (strcmp(entry->key->u.name, key) == 0) {
-                    *value_out = entry->value;
-                    *prev = entry->next;
-                    cos_free_object(entry->key);
-                    free(entry);
-                    res = NSPDFERROR_OK;
-                    break;
+            struct cos_dictionary *dictionary = dict->u.dictionary;
+            int entry;
+
+            struct cos_object *value;
+
+            entry = dictionary_find(dictionary, key);
+            if (entry < 0) {
+                res = NSPDFERROR_NOTFOUND;
+            } else {
+                value = &dictionary->entries[entry].value;
+                if (!dict->arena) {
+                    /* values are held in the entry so the caller gets a
+                     * copy it can free
+                     */
+                    value = malloc(sizeof(struct cos_object));
+                    if (value == NULL) {
+                        return NSPDFERROR_NOMEM;
+                    }
+                    *value = dictionary->entries[entry].value;
+                    dictionary->entries[entry].value.type = COS_TYPE_NULL;
+                    lwc_string_unref(dictionary->entries[entry].key);
+                }
+                *value_out = value;
+
+                /* the emptied entry is skipped by lookups */
+                dictionary->entries[entry].key = NULL;
+                if (dictionary->index_size != 0) {
+                    cos_dictionary_index(dictionary);
                 }
-                prev = &entry->next;
-                entry = *prev;
             }
         }
     }
@@ -223,27 +356,22 @@ cos_extract_dictionary_value(struct nspdf_doc *doc,
 nspdferror
 cos_get_dictionary_value(struct nspdf_doc *doc,
                          struct cos_object *dict,
-                         const char *key,
+                         lwc_string *key,
                          struct cos_object **value_out)
 {
     nspdferror res;
-    struct cos_dictionary_entry *entry;
+    int entry;
 
     res = nspdf__xref_get_referenced(doc, &dict);
     if (res == NSPDFERROR_OK) {
         if (dict->type != COS_TYPE_DICTIONARY) {
             res = NSPDFERROR_TYPE;
         } else {
-            res = NSPDFERROR_NOTFOUND;
-
-            entry = dict->u.dictionary;
-            while (entry != NULL) {
-                if (strcmp(entry->key->u.name, key) == 0) {
-                    *value_out = entry->value;
-                    res = NSPDFERROR_OK;
-                    break;
-                }
-                entry = entry->next;
+            entry = dictionary_find(dict->u.dictionary, key);
+            if (entry < 0) {
+                res = NSPDFERROR_NOTFOUND;
+            } else {
+                *value_out = &dict->u.dictionary->entries[entry].value;
             }
         }
     }
@@ -253,7 +381,7 @@ cos_get_dictionary_value(struct nspdf_doc *doc,
 nspdferror
 cos_get_dictionary_int(struct nspdf_doc *doc,
                        struct cos_object *dict,
-                       const char *key,
+                       lwc_string *key,
                        int64_t *value_out)
 {
     nspdferror res;
@@ -269,8 +397,8 @@ cos_get_dictionary_int(struct nspdf_doc *doc,
 nspdferror
 cos_get_dictionary_name(struct nspdf_doc *doc,
                         struct cos_object *dict,
-                        const char *key,
-                        const char **value_out)
+                        lwc_string *key,
+                        lwc_string **value_out)
 {
     nspdferror res;
     struct cos_object *dict_value;
@@ -285,7 +413,7 @@ cos_get_dictionary_name(struct nspdf_doc *doc,
 nspdferror
 cos_get_dictionary_string(struct nspdf_doc *doc,
                           struct cos_object *dict,
-                          const char *key,
+                          lwc_string *key,
                           struct cos_string **string_out)
 {
     nspdferror res;
@@ -301,7 +429,7 @@ cos_get_dictionary_string(struct nspdf_doc *doc,
 nspdferror
 cos_get_dictionary_dictionary(struct nspdf_doc *doc,
                               struct cos_object *dict,
-                              const char *key,
+                              lwc_string *key,
                               struct cos_object **value_out)
 {
     nspdferror res;
@@ -317,7 +445,7 @@ cos_get_dictionary_dictionary(struct nspdf_doc *doc,
 nspdferror
 cos_heritable_dictionary_dictionary(struct nspdf_doc *doc,
                                     struct cos_object *dict,
-                                    const char *key,
+                                    lwc_string *key,
                                     struct cos_object **value_out)
 {
     nspdferror res;
@@ -337,7 +465,7 @@ cos_heritable_dictionary_dictionary(struct nspdf_doc *doc,
 nspdferror
 cos_get_dictionary_array(struct nspdf_doc *doc,
                          struct cos_object *dict,
-                         const char *key,
+                         lwc_string *key,
                          struct cos_object **value_out)
 {
     nspdferror res;
@@ -353,7 +481,7 @@ cos_get_dictionary_array(struct nspdf_doc *doc,
 nspdferror
 cos_heritable_dictionary_array(struct nspdf_doc *doc,
                                struct cos_object *dict,
-                               const char *key,
+                               lwc_string *key,
                                struct cos_object **value_out)
 {
     nspdferror res;
@@ -410,7 +538,7 @@ cos_get_number(struct nspdf_doc *doc,
 nspdferror
 cos_get_name(struct nspdf_doc *doc,
              struct cos_object *cobj,
-             const char **value_out)
+             lwc_string **value_out)
 {
     nspdferror res;
 
@@ -534,13 +662,13 @@ cos_get_rectangle(struct nspdf_doc *doc,
             (cobj->u.array->length != 4)) {
             res = NSPDFERROR_TYPE;
         } else {
-            res = cos_get_number(doc, cobj->u.array->values[0], &rect.llx);
+            res = cos_get_number(doc, &cobj->u.array->values[0], &rect.llx);
             if (res == NSPDFERROR_OK) {
-                res = cos_get_number(doc, cobj->u.array->values[1], &rect.lly);
+                res = cos_get_number(doc, &cobj->u.array->values[1], &rect.lly);
                 if (res == NSPDFERROR_OK) {
-                    res = cos_get_number(doc, cobj->u.array->values[2], &rect.urx);
+                    res = cos_get_number(doc, &cobj->u.array->values[2], &rect.urx);
                     if (res == NSPDFERROR_OK) {
-                        res = cos_get_number(doc, cobj->u.array->values[3], &rect.ury);
+                        res = cos_get_number(doc, &cobj->u.array->values[3], &rect.ury);
                         if (res == NSPDFERROR_OK) {
                             *rect_out = rect;
                         }
@@ -608,7 +736,9 @@ cos_get_content(struct nspdf_doc *doc,
         if (references == NULL) {
             return NSPDFERROR_NOMEM;
         }
-        memcpy(references, cobj->u.array->values, reference_count * sizeof(struct cos_object *));
+        for (index = 0; index < reference_count ; index++) {
+            *(references + index) = &cobj->u.array->values[index];
+        }
         /* check all objects in array are references */
         for (index = 0; index < reference_count ; index++) {
             if ((*(references + index))->type != COS_TYPE_REFERENCE) {
@@ -646,21 +776,37 @@ cos_get_content(struct nspdf_doc *doc,
     }
 
     res = cos_parse_content_streams(doc, streams, reference_count, &content_obj);
+    free(references);
+    free(streams);
     if (res != NSPDFERROR_OK) {
-        free(references);
-        free(streams);
         return res;
     }
 
+    if (cobj->arena) {
+        /* the content replaces a value released with the arena */
+        res = nspdf__arena_adopt_release(doc->arena,
+                                         content_obj->u.content,
+                                         release_content);
+        if (res != NSPDFERROR_OK) {
+            cos_free_object(content_obj);
+            return res;
+        }
+    }
+
     /* replace passed object with parsed content operations object */
     tmpobj = *cobj;
     *cobj = *content_obj;
-    *content_obj = tmpobj;
+    cobj->arena = tmpobj.arena; /* object memory has not moved */
 
     //cos_dump_object("content object", cobj);
-    //cos_dump_object("free object", content_obj);
 
-    cos_free_object(content_obj);
+    if (tmpobj.arena) {
+        /* previous value is released with the arena */
+        free(content_obj);
+    } else {
+        *content_obj = tmpobj;
+        cos_free_object(content_obj);
+    }
 
     /** \todo call nspdf__xref_free_referenced(doc, *(references + index)); to free up storage associated with already parsed streams */
 
@@ -689,7 +835,7 @@ cos_get_array_value(struct nspdf_doc *doc,
             if (index >= array->u.array->length) {
                 res = NSPDFERROR_RANGE;
             } else {
-                *value_out = *(array->u.array->values + index);
+                *value_out = &array->u.array->values[index];
             }
         }
     }
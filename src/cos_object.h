@@ -18,6 +18,7 @@
 #include "cos_stream.h"
 
 struct nspdf_doc;
+struct lwc_string_s;
 struct content_operation;
 struct cos_content;
 struct cos_object;
@@ -42,36 +43,6 @@ enum cos_type {
 };
 
 
-/**
- * list of COS dictionary entries.
- */
-struct cos_dictionary_entry {
-    /** next key/value in dictionary */
-    struct cos_dictionary_entry *next;
-
-    /** key (name) */
-    struct cos_object *key;
-
-    /** value */
-    struct cos_object *value;
-};
-
-
-/**
- * array of COS objects
- */
-struct cos_array {
-    /** number of values */
-    unsigned int length;
-
-    /** number of allocated values */
-    unsigned int alloc;
-
-    /** array of object pointers */
-    struct cos_object **values;
-};
-
-
 /**
  * COS string data
  */
@@ -86,8 +57,8 @@ struct cos_string {
  * reference to COS object
  */
 struct cos_reference {
-    uint64_t id; /**< id of indirect object */
-    uint64_t generation; /**< generation of indirect object */
+    uint32_t id; /**< id of indirect object */
+    uint32_t generation; /**< generation of indirect object */
 };
 
 
@@ -103,9 +74,20 @@ struct cos_rectangle {
 
 /**
  * Carosel object
+ *
+ * Scalar values and references are held within the object, other types
+ *  point to their contents. Arrays and dictionaries hold their values as
+ *  objects directly instead of pointers to allocated objects.
  */
 struct cos_object {
     enum cos_type type;
+
+    /**
+     * object and everything it references is allocated from the document
+     *  arena and is released with it instead of by cos_free_object()
+     */
+    bool arena;
+
     union {
         /** boolean */
         bool b;
@@ -116,8 +98,8 @@ struct cos_object {
         /** real */
         float real;
 
-        /** name */
-        char *name;
+        /** interned name */
+        struct lwc_string_s *name;
 
         /** string */
         struct cos_string *s;
@@ -126,22 +108,100 @@ struct cos_object {
         struct cos_stream *stream;
 
         /** dictionary */
-        struct cos_dictionary_entry *dictionary;
+        struct cos_dictionary *dictionary;
 
         /** array */
         struct cos_array *array;
 
         /** reference */
-        struct cos_reference *reference;
+        struct cos_reference reference;
 
         /** parsed content stream */
         struct cos_content *content;
     } u;
 };
 
+
+
+/**
+ * dictionaries with at least this many entries have a hash index
+ */
+#define COS_DICTIONARY_INDEX_MIN 12
+
+/**
+ * COS dictionary entry.
+ */
+struct cos_dictionary_entry {
+    /** interned key name */
+    struct lwc_string_s *key;
+
+    /** value */
+    struct cos_object value;
+};
+
+/**
+ * COS dictionary
+ *
+ * Entries are held contiguously in the order they were parsed. Small
+ *  dictionaries are searched linearly, larger ones have an open addressed
+ *  hash index. Where a key is repeated the last entry is found.
+ */
+struct cos_dictionary {
+    /** number of entries */
+    unsigned int length;
+
+    /** number of allocated entries */
+    unsigned int alloc;
+
+    /** array of entries */
+    struct cos_dictionary_entry *entries;
+
+    /** number of index slots, a power of two or zero if not indexed */
+    unsigned int index_size;
+
+    /** index slots holding an entry number plus one or zero if empty */
+    unsigned int *index;
+};
+
+
+/**
+ * array of COS objects
+ */
+struct cos_array {
+    /** number of values */
+    unsigned int length;
+
+    /** number of allocated values */
+    unsigned int alloc;
+
+    /** array of values */
+    struct cos_object *values;
+};
+
+
+/**
+ * free an allocated object and its contents
+ */
 nspdferror cos_free_object(struct cos_object *cos_obj);
 
 
+/**
+ * release the contents of an object leaving it a null object
+ *
+ * Used for objects held within arrays and dictionaries which are not
+ *  allocated individually.
+ */
+nspdferror cos_free_value(struct cos_object *cos_obj);
+
+
+/**
+ * build the hash index of a dictionary
+ *
+ * The index slots must already be allocated.
+ */
+void cos_dictionary_index(struct cos_dictionary *dictionary);
+
+
 /**
  * extract a value object for a key from a dictionary
  *
@@ -161,7 +221,7 @@ nspdferror cos_free_object(struct cos_object *cos_obj);
  *         NSPDFERROR_TYPE if the object passed in \p dict is not a dictionary.
  *         NSPDFERROR_NOTFOUND if the key is not present in the dictionary.
  */
-nspdferror cos_extract_dictionary_value(struct nspdf_doc *doc, struct cos_object *dict, const char *key, struct cos_object **value_out);
+nspdferror cos_extract_dictionary_value(struct nspdf_doc *doc, struct cos_object *dict, struct lwc_string_s *key, struct cos_object **value_out);
 
 
 /**
@@ -179,7 +239,7 @@ nspdferror cos_extract_dictionary_value(struct nspdf_doc *doc, struct cos_object
  *         NSPDFERROR_TYPE if the object passed in \p dict is not a dictionary.
  *         NSPDFERROR_NOTFOUND if the key is not present in the dictionary.
  */
-nspdferror cos_get_dictionary_value(struct nspdf_doc *doc, struct cos_object *dict, const char *key, struct cos_object **value_out);
+nspdferror cos_get_dictionary_value(struct nspdf_doc *doc, struct cos_object *dict, struct lwc_string_s *key, struct cos_object **value_out);
 
 
 /**
@@ -198,25 +258,25 @@ nspdferror cos_get_dictionary_value(struct nspdf_doc *doc, struct cos_object *di
  *           or the value of the key is not an integer.
  *         NSPDFERROR_NOTFOUND if the key is not present in the dictionary.
  */
-nspdferror cos_get_dictionary_int(struct nspdf_doc *doc, struct cos_object *dict, const char *key, int64_t *int_out);
+nspdferror cos_get_dictionary_int(struct nspdf_doc *doc, struct cos_object *dict, struct lwc_string_s *key, int64_t *int_out);
 
 
-nspdferror cos_get_dictionary_name(struct nspdf_doc *doc, struct cos_object *dict, const char *key, const char **value_out);
+nspdferror cos_get_dictionary_name(struct nspdf_doc *doc, struct cos_object *dict, struct lwc_string_s *key, struct lwc_string_s **value_out);
 
 
-nspdferror cos_get_dictionary_string(struct nspdf_doc *doc, struct cos_object *dict, const char *key, struct cos_string **string_out);
+nspdferror cos_get_dictionary_string(struct nspdf_doc *doc, struct cos_object *dict, struct lwc_string_s *key, struct cos_string **string_out);
 
 
-nspdferror cos_get_dictionary_dictionary(struct nspdf_doc *doc, struct cos_object *dict, const char *key, struct cos_object **value_out);
+nspdferror cos_get_dictionary_dictionary(struct nspdf_doc *doc, struct cos_object *dict, struct lwc_string_s *key, struct cos_object **value_out);
 
 
-nspdferror cos_heritable_dictionary_dictionary(struct nspdf_doc *doc, struct cos_object *dict, const char *key, struct cos_object **value_out);
+nspdferror cos_heritable_dictionary_dictionary(struct nspdf_doc *doc, struct cos_object *dict, struct lwc_string_s *key, struct cos_object **value_out);
 
 
-nspdferror cos_get_dictionary_array(struct nspdf_doc *doc, struct cos_object *dict, const char *key, struct cos_object **value_out);
+nspdferror cos_get_dictionary_array(struct nspdf_doc *doc, struct cos_object *dict, struct lwc_string_s *key, struct cos_object **value_out);
 
 
-nspdferror cos_heritable_dictionary_array(struct nspdf_doc *doc, struct cos_object *dict, const char *key, struct cos_object **value_out);
+nspdferror cos_heritable_dictionary_array(struct nspdf_doc *doc, struct cos_object *dict, struct lwc_string_s *key, struct cos_object **value_out);
 
 
 nspdferror cos_get_array_size(struct nspdf_doc *doc, struct cos_object *cobj, unsigned int *size_out);
@@ -272,7 +332,7 @@ nspdferror cos_get_number(struct nspdf_doc *doc, struct cos_object *cobj, float
  * \return NSERROR_OK and \p value_out updated,
  *         NSERROR_TYPE if the \p cobj is not a name
  */
-nspdferror cos_get_name(struct nspdf_doc *doc, struct cos_object *cobj, const char **name_out);
+nspdferror cos_get_name(struct nspdf_doc *doc, struct cos_object *cobj, struct lwc_string_s **name_out);
 
 
 /**
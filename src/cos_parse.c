@@ -8,12 +8,16 @@
  */
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <stddef.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <libwapcaplet/libwapcaplet.h>
+
 #include <nspdf/errors.h>
 
 #include "cos_parse.h"
@@ -21,28 +25,146 @@
 #include "cos_object.h"
 #include "cos_content.h"
 #include "pdf_doc.h"
-
-/** increments in which cos string allocations are extended */
-#define COS_STRING_ALLOC 32
+#include "source.h"
+#include "arena.h"
+#include "atom.h"
+#include "scratch.h"
 
 /** Maximum length of cos name */
 #define NAME_MAX_LENGTH 127
 
+/** Limit on the number of decimal places in a number */
+#define NUMBER_MAX_DIGITS 21
+
+/** Maximum hex digits decoded into the scratch stack by each bulk decode */
+#define HEX_RUN_LENGTH 4096
+
+/**
+ * type reals are calculated in before being stored
+ *
+ * Defining NSPDF_DOUBLE_REALS calculates in double precision so the stored
+ *  value is rounded only once. Otherwise the mantissa is rounded to single
+ *  precision before it is scaled.
+ */
+#if defined(NSPDF_DOUBLE_REALS)
+typedef double cos_real_calc_t;
+#else
+typedef float cos_real_calc_t;
+#endif
+
+#define SLEN(x) (sizeof((x)) - 1)
+
+#define STREAM_TOK "stream"
+#define ENDSTREAM_TOK "endstream"
+
+
+/**
+ * allocate zeroed memory for part of an object parsed from a stream
+ */
+static inline void *cos_alloc(struct cos_stream *stream, size_t size)
+{
+    if (stream->arena != NULL) {
+        return nspdf__arena_alloc(stream->arena, size);
+    }
+    return calloc(1, size);
+}
 
+/**
+ * allocate memory for part of an object parsed from a stream and copy the
+ *  contents of the scratch stack since a mark into it
+ *
+ * The copied contents are released from the scratch stack.
+ *
+ * \param doc The document whose scratch stack is used.
+ * \param stream The stream the object is parsed from.
+ * \param mark The scratch stack mark the contents start from.
+ * \param data_out The allocation or NULL if there were no contents.
+ */
 static nspdferror
-cos_string_append(struct cos_string *s, uint8_t c)
+cos_alloc_scratch(struct nspdf_doc *doc,
+                  struct cos_stream *stream,
+                  size_t mark,
+                  void **data_out)
 {
-    //printf("appending 0x%x to %p len %d alloc %d\n", c, s->data, s->length, s->alloc);
-    if (s->length == s->alloc) {
-        uint8_t *ns;
-        ns = realloc(s->data, s->alloc + COS_STRING_ALLOC);
-        if (ns == NULL) {
+    size_t size;
+    void *data = NULL;
+
+    size = nspdf__scratch_size(doc->scratch, mark);
+    if (size > 0) {
+        if (stream->arena != NULL) {
+            data = nspdf__arena_alloc(stream->arena, size);
+        } else {
+            data = malloc(size);
+        }
+        if (data == NULL) {
             return NSPDFERROR_NOMEM;
         }
-        s->data = ns;
-        s->alloc += COS_STRING_ALLOC;
+        memcpy(data, nspdf__scratch_at(doc->scratch, mark), size);
+    }
+    nspdf__scratch_release(doc->scratch, mark);
+
+    *data_out = data;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * allocate an object parsed from a stream
+ */
+static inline struct cos_object *
+cos_alloc_object(struct cos_stream *stream, enum cos_type type)
+{
+    struct cos_object *cosobj;
+
+    cosobj = cos_alloc(stream, sizeof(struct cos_object));
+    if (cosobj != NULL) {
+        cosobj->type = type;
+        cosobj->arena = (stream->arena != NULL);
+    }
+    return cosobj;
+}
+
+/**
+ * complete a string object from the bytes on the scratch stack since a mark
+ */
+static nspdferror
+cos_string_from_scratch(struct nspdf_doc *doc,
+                        struct cos_stream *stream,
+                        size_t mark,
+                        struct cos_object *cosobj)
+{
+    nspdferror res;
+    struct cos_string *cstring;
+    size_t length;
+    void *data;
+
+    length = nspdf__scratch_size(doc->scratch, mark);
+    if (length > UINT_MAX) {
+        nspdf__scratch_release(doc->scratch, mark);
+        return NSPDFERROR_RANGE;
+    }
+
+    cstring = cos_alloc(stream, sizeof(*cstring));
+    if (cstring == NULL) {
+        nspdf__scratch_release(doc->scratch, mark);
+        return NSPDFERROR_NOMEM;
+    }
+
+    res = cos_alloc_scratch(doc, stream, mark, &data);
+    if (res != NSPDFERROR_OK) {
+        if (stream->arena == NULL) {
+            free(cstring);
+        }
+        nspdf__scratch_release(doc->scratch, mark);
+        return res;
     }
-    s->data[s->length++] = c;
+    cstring->data = data;
+    cstring->length = length;
+    cstring->alloc = length;
+
+    cosobj->type = COS_TYPE_STRING;
+    cosobj->u.s = cstring;
+
     return NSPDFERROR_OK;
 }
 
@@ -58,21 +180,34 @@ static uint8_t xtoi(uint8_t x)
     return x;
 }
 
+/**
+ * powers of ten used to scale the fractional part of reals
+ *
+ * A number has fewer than NUMBER_MAX_DIGITS decimal places so at most
+ *  NUMBER_MAX_DIGITS - 1 follow the point.
+ */
+static const cos_real_calc_t pow10_table[NUMBER_MAX_DIGITS] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20
+};
+
 /**
  * parse a number
+ *
+ * The value is accumulated in a single pass with the number of decimal
+ *  places after the point counted to scale reals.
  */
 static nspdferror
 cos_parse_number(struct cos_stream *stream,
                  strmoff_t *offset_out,
-                 struct cos_object **cosobj_out)
+                 struct cos_object *cosobj)
 {
     nspdferror res;
-    struct cos_object *cosobj;
     uint8_t c; /* current byte from source data */
-    unsigned int len; /* number of decimal places in number */
-    uint8_t num[21]; /* temporary buffer for decimal values */
     strmoff_t offset; /* current offset of source data */
-    unsigned int point;
+    uint64_t result = 0; /* accumulated value of all decimal places */
+    unsigned int len = 0; /* number of decimal places in number */
+    unsigned int point = 0; /* number of decimal places before the point */
     bool real = false;
     bool neg = false;
 
@@ -82,13 +217,16 @@ cos_parse_number(struct cos_stream *stream,
     if (c == '-') {
         neg = true;
         offset++;
+        c = stream_byte(stream, offset);
     } else if (c == '+') {
-        neg = false;
         offset++;
+        c = stream_byte(stream, offset);
     }
 
-    for (len = 0; len < sizeof(num); len++) {
-        c = stream_byte(stream, offset);
+    for (;;) {
+        if (len == NUMBER_MAX_DIGITS) {
+            return NSPDFERROR_RANGE; /* number too long */
+        }
 
         if (c == '.') {
             real = true;
@@ -98,62 +236,47 @@ cos_parse_number(struct cos_stream *stream,
         }
 
         if ((bclass[c] & BC_DCML) != BC_DCML) {
-            int64_t result = 0; /* parsed result */
-            uint64_t tens;
-
-            if (len == 0) {
-                 /* parse error no decimals in input */
-                return NSPDFERROR_SYNTAX;
-            }
-
-            point = len - point;
-
-            /* sum value from each place */
-            for (tens = 1; len > 0; tens = tens * 10, len--) {
-                result += (num[len - 1] * tens);
-            }
-
-            res = nspdf__stream_skip_ws(stream, &offset);
-            if (res != NSPDFERROR_OK) {
-                return res;
-            }
+            break;
+        }
 
-            cosobj = calloc(1, sizeof(struct cos_object));
-            if (cosobj == NULL) {
-                return NSPDFERROR_NOMEM;
-            }
+        result = (result * 10) + (c - '0');
+        len++;
+        offset++;
+        c = stream_byte(stream, offset);
+    }
 
-            if (real) {
-                unsigned int div = 1;
-                for (; point > 0;point--) {
-                    div = div * 10;
-                }
-                cosobj->type = COS_TYPE_REAL;
-                if (neg) {
-                    cosobj->u.real = -((float)result / div);
-                } else {
-                    cosobj->u.real = (float)result / div;
-                }
-                //printf("real %d %f\n", result, cosobj->u.real);
-            } else {
-                cosobj->type = COS_TYPE_INT;
-                if (neg) {
-                    cosobj->u.i = -result;
-                } else {
-                    cosobj->u.i = result;
-                }
-            }
+    if (len == 0) {
+        /* parse error no decimals in input */
+        return NSPDFERROR_SYNTAX;
+    }
 
-            *cosobj_out = cosobj;
+    res = nspdf__stream_skip_ws(stream, &offset);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
 
-            *offset_out = offset;
+    if (real) {
+        cos_real_calc_t value;
 
-            return NSPDFERROR_OK;
+        value = (cos_real_calc_t)(int64_t)result / pow10_table[len - point];
+        cosobj->type = COS_TYPE_REAL;
+        if (neg) {
+            cosobj->u.real = -value;
+        } else {
+            cosobj->u.real = value;
+        }
+    } else {
+        cosobj->type = COS_TYPE_INT;
+        if (neg) {
+            cosobj->u.i = -(int64_t)result;
+        } else {
+            cosobj->u.i = result;
         }
-        num[len] = c - '0';
-        offset++;
     }
-    return NSPDFERROR_RANGE; /* number too long */
+
+    *offset_out = offset;
+
+    return NSPDFERROR_OK;
 }
 
 
@@ -162,15 +285,17 @@ cos_parse_number(struct cos_stream *stream,
  *
  */
 static nspdferror
-cos_parse_string(struct cos_stream *stream,
-                  strmoff_t *offset_out,
-                  struct cos_object **cosobj_out)
+cos_parse_string(struct nspdf_doc *doc,
+                 struct cos_stream *stream,
+                 strmoff_t *offset_out,
+                 struct cos_object *cosobj)
 {
+    nspdferror res;
     strmoff_t offset;
-    struct cos_object *cosobj;
     uint8_t c;
     unsigned int pdepth = 1; /* depth of open parens */
-    struct cos_string *cstring;
+    size_t mark;
+    size_t run;
 
     offset = *offset_out;
 
@@ -179,19 +304,26 @@ cos_parse_string(struct cos_stream *stream,
         return NSPDFERROR_SYNTAX;
     }
 
-    cstring = calloc(1, sizeof(*cstring));
-    if (cstring == NULL) {
-        return NSPDFERROR_NOMEM;
-    }
-
-    cosobj = calloc(1, sizeof(*cosobj));
-    if (cosobj == NULL) {
-        return NSPDFERROR_NOMEM;
-    }
-    cosobj->type = COS_TYPE_STRING;
-    cosobj->u.s = cstring;
+    /* the string is built on the scratch stack */
+    mark = nspdf__scratch_mark(doc->scratch);
 
     while (pdepth > 0) {
+        if ((stream->source == NULL) && (offset < stream->length)) {
+            /* runs of bytes which need no translation are copied whole */
+            run = nspdf__literal_run(stream->data + offset,
+                                     stream->length - offset);
+            if (run > 0) {
+                res = nspdf__scratch_push(doc->scratch,
+                                          stream->data + offset,
+                                          run);
+                if (res != NSPDFERROR_OK) {
+                    nspdf__scratch_release(doc->scratch, mark);
+                    return res;
+                }
+                offset += run;
+            }
+        }
+
         c = stream_byte(stream, offset++);
 
         if (c == ')') {
@@ -203,8 +335,12 @@ cos_parse_string(struct cos_stream *stream,
             pdepth++;
         } else if ((bclass[c] & BC_EOLM ) != 0) {
             /* unescaped end of line characters are translated to a single
-             * newline
+             * newline. The stream padding starts with an end of line so
+             * this is where an unterminated string is detected.
              */
+            if (offset > stream->length) {
+                break;
+            }
             c = stream_byte(stream, offset);
             while ((bclass[c] & BC_EOLM) != 0) {
                 offset++;
@@ -251,6 +387,10 @@ cos_parse_string(struct cos_stream *stream,
 
                 if ((bclass[c] & BC_EOLM) != 0) {
                     /* escaped end of line, swallow it */
+                    if (offset > stream->length) {
+                        pdepth = 0;
+                        break;
+                    }
                     c = stream_byte(stream, offset++);
                     while ((bclass[c] & BC_EOLM) != 0) {
                         c = stream_byte(stream, offset++);
@@ -276,12 +416,70 @@ cos_parse_string(struct cos_stream *stream,
         }
 
         /* c contains the character to add to the string */
-        cos_string_append(cstring, c);
+        res = nspdf__scratch_push_byte(doc->scratch, c);
+        if (res != NSPDFERROR_OK) {
+            nspdf__scratch_release(doc->scratch, mark);
+            return res;
+        }
+    }
+
+    if (offset > stream->length) {
+        /* string was not terminated before the end of the stream */
+        nspdf__scratch_release(doc->scratch, mark);
+        return NSPDFERROR_SYNTAX;
+    }
+
+    res = cos_string_from_scratch(doc, stream, mark, cosobj);
+    if (res != NSPDFERROR_OK) {
+        return res;
     }
 
     nspdf__stream_skip_ws(stream, &offset);
 
-    *cosobj_out = cosobj;
+    *offset_out = offset;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * decode a run of hex digit pairs from an in memory stream onto the scratch
+ *  stack
+ *
+ * \param doc The document whose scratch stack is used.
+ * \param stream The in memory stream to decode from.
+ * \param offset_out The offset to decode from, updated past the decoded run.
+ */
+static nspdferror
+cos_decode_hex_run(struct nspdf_doc *doc,
+                   struct cos_stream *stream,
+                   strmoff_t *offset_out)
+{
+    nspdferror res;
+    strmoff_t offset;
+    size_t length;
+    size_t decoded;
+    uint8_t *out;
+
+    offset = *offset_out;
+
+    do {
+        if (offset >= stream->length) {
+            break;
+        }
+        length = stream->length - offset;
+        if (length > HEX_RUN_LENGTH) {
+            length = HEX_RUN_LENGTH;
+        }
+
+        res = nspdf__scratch_reserve(doc->scratch, length / 2, &out);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+        decoded = nspdf__hex_decode(stream->data + offset, length, out);
+        nspdf__scratch_commit(doc->scratch, decoded / 2);
+        offset += decoded;
+    } while (decoded == HEX_RUN_LENGTH);
+
     *offset_out = offset;
 
     return NSPDFERROR_OK;
@@ -291,16 +489,17 @@ cos_parse_string(struct cos_stream *stream,
  * decode hex encoded string
  */
 static nspdferror
-cos_parse_hex_string(struct cos_stream *stream,
+cos_parse_hex_string(struct nspdf_doc *doc,
+                     struct cos_stream *stream,
                      strmoff_t *offset_out,
-                     struct cos_object **cosobj_out)
+                     struct cos_object *cosobj)
 {
+    nspdferror res;
     strmoff_t offset;
-    struct cos_object *cosobj;
     uint8_t c;
     uint8_t value = 0;
-    struct cos_string *cstring;
     bool first = true;
+    size_t mark;
 
     offset = *offset_out;
 
@@ -309,28 +508,44 @@ cos_parse_hex_string(struct cos_stream *stream,
         return NSPDFERROR_SYNTAX;
     }
 
-    cstring = calloc(1, sizeof(*cstring));
-    if (cstring == NULL) {
-        return NSPDFERROR_NOMEM;
-    }
+    /* the decoded string is built on the scratch stack */
+    mark = nspdf__scratch_mark(doc->scratch);
 
-    cosobj = calloc(1, sizeof(*cosobj));
-    if (cosobj == NULL) {
-        return NSPDFERROR_NOMEM;
-    }
-    cosobj->type = COS_TYPE_STRING;
-    cosobj->u.s = cstring;
+    /* the stream padding sentinel is not a hex digit or whitespace so
+     * terminates the loop.
+     */
+    for (;; offset++) {
+        if (first && (stream->source == NULL)) {
+            /* whole digit pairs are decoded in bulk */
+            res = cos_decode_hex_run(doc, stream, &offset);
+            if (res != NSPDFERROR_OK) {
+                nspdf__scratch_release(doc->scratch, mark);
+                return res;
+            }
+        }
 
-    for (; offset < stream->length; offset++) {
         c = stream_byte(stream, offset);
         if (c == '>') {
+            if (offset >= stream->length) {
+                break; /* not terminated before end of stream */
+            }
             if (first == false) {
-                cos_string_append(cstring, value);
+                /* odd number of digits, the last is followed by zero */
+                res = nspdf__scratch_push_byte(doc->scratch, value);
+                if (res != NSPDFERROR_OK) {
+                    nspdf__scratch_release(doc->scratch, mark);
+                    return res;
+                }
             }
+
+            res = cos_string_from_scratch(doc, stream, mark, cosobj);
+            if (res != NSPDFERROR_OK) {
+                return res;
+            }
+
             offset++;
             nspdf__stream_skip_ws(stream, &offset);
 
-            *cosobj_out = cosobj;
             *offset_out = offset;
 
             return NSPDFERROR_OK;
@@ -341,184 +556,133 @@ cos_parse_hex_string(struct cos_stream *stream,
             } else {
                 value |= xtoi(c);
                 first = true;
-                cos_string_append(cstring, value);
+                res = nspdf__scratch_push_byte(doc->scratch, value);
+                if (res != NSPDFERROR_OK) {
+                    nspdf__scratch_release(doc->scratch, mark);
+                    return res;
+                }
             }
         } else if ((bclass[c] & BC_WSPC) == 0) {
             break; /* unknown byte value in string */
         }
     }
+    nspdf__scratch_release(doc->scratch, mark);
+
     return NSPDFERROR_SYNTAX;
 }
 
 /**
- * parse a COS dictionary
+ * complete a dictionary from the entries on the scratch stack since a mark
+ *
+ * Large dictionaries are indexed at no more than half load. On error the
+ *  entries are left on the scratch stack.
  */
 static nspdferror
-cos_parse_dictionary(struct nspdf_doc *doc,
+cos_build_dictionary(struct nspdf_doc *doc,
                      struct cos_stream *stream,
-                     strmoff_t *offset_out,
-                     struct cos_object **cosobj_out)
+                     size_t mark,
+                     unsigned int length,
+                     struct cos_object *cosobj)
 {
     nspdferror res;
-    strmoff_t offset;
-    struct cos_object *cosobj;
-    struct cos_dictionary_entry *entry;
-    struct cos_object *key;
-    struct cos_object *value;
-
-    offset = *offset_out;
-
-    if ((stream_byte(stream, offset    ) != '<') ||
-        (stream_byte(stream, offset + 1) != '<')) {
-        return NSPDFERROR_SYNTAX; /* syntax error */
-    }
-    offset += 2;
-    nspdf__stream_skip_ws(stream, &offset);
+    struct cos_dictionary *dict;
+    unsigned int *index = NULL;
+    unsigned int index_size = 0;
+    void *data;
 
-    //printf("found a dictionary\n");
-
-    cosobj = calloc(1, sizeof(struct cos_object));
-    if (cosobj == NULL) {
+    dict = cos_alloc(stream, sizeof(struct cos_dictionary));
+    if (dict == NULL) {
         return NSPDFERROR_NOMEM;
     }
-    cosobj->type = COS_TYPE_DICTIONARY;
-
-    while ((stream_byte(stream, offset    ) != '>') &&
-           (stream_byte(stream, offset + 1) != '>')) {
-
-        res = cos_parse_object(doc, stream, &offset, &key);
-        if (res != NSPDFERROR_OK) {
-            printf("key object decode failed\n");
-            goto cos_parse_dictionary_error;
-        }
-        if (key->type != COS_TYPE_NAME) {
-            /* key value pairs without a name */
-            printf("key was %d not a name %d\n", key->type, COS_TYPE_NAME);
 
-            cos_free_object(key);
-            res = NSPDFERROR_SYNTAX;
-            goto cos_parse_dictionary_error;
+    if (length >= COS_DICTIONARY_INDEX_MIN) {
+        index_size = 32;
+        while (index_size < (length * 2)) {
+            index_size = index_size * 2;
         }
-
-        res = cos_parse_object(doc, stream, &offset, &value);
-        if (res != NSPDFERROR_OK) {
-            printf("Unable to decode value object in dictionary\n");
-            cos_free_object(key);
-            goto cos_parse_dictionary_error;
-        }
-
-        /* add dictionary entry */
-        entry = calloc(1, sizeof(struct cos_dictionary_entry));
-        if (entry == NULL) {
-            cos_free_object(key);
-            cos_free_object(value);
+        index = cos_alloc(stream, index_size * sizeof(unsigned int));
+        if (index == NULL) {
             res = NSPDFERROR_NOMEM;
-            goto cos_parse_dictionary_error;
+            goto cos_build_dictionary_error;
         }
-        //printf("key:%s value(type):%d\n", key->u.n, value->type);
-
-        entry->key = key;
-        entry->value = value;
-        entry->next = cosobj->u.dictionary;
-
-        cosobj->u.dictionary = entry;
+    }
 
+    res = cos_alloc_scratch(doc, stream, mark, &data);
+    if (res != NSPDFERROR_OK) {
+        goto cos_build_dictionary_error;
+    }
+    dict->entries = data;
+    dict->length = length;
+    dict->alloc = length;
+    dict->index = index;
+    dict->index_size = index_size;
+    if (index != NULL) {
+        cos_dictionary_index(dict);
     }
-    offset += 2; /* skip closing >> */
-    nspdf__stream_skip_ws(stream, &offset);
 
-    *cosobj_out = cosobj;
-    *offset_out = offset;
+    cosobj->type = COS_TYPE_DICTIONARY;
+    cosobj->u.dictionary = dict;
 
     return NSPDFERROR_OK;
 
-cos_parse_dictionary_error:
-    cos_free_object(cosobj);
-
+cos_build_dictionary_error:
+    if (stream->arena == NULL) {
+        free(index);
+        free(dict);
+    }
     return res;
 }
 
 
 /**
- * parse a COS list
+ * complete an array from the values on the scratch stack since a mark
+ *
+ * The values are held directly in the array so lists of scalars such as
+ *  widths or rectangles need no further allocation. On error the values are
+ *  left on the scratch stack.
  */
 static nspdferror
-cos_parse_list(struct nspdf_doc *doc,
-               struct cos_stream *stream,
-               strmoff_t *offset_out,
-               struct cos_object **cosobj_out)
+cos_build_array(struct nspdf_doc *doc,
+                struct cos_stream *stream,
+                size_t mark,
+                unsigned int length,
+                struct cos_object *cosobj)
 {
-    strmoff_t offset;
-    struct cos_object *cosobj;
-    struct cos_array *array;
-    struct cos_object *value;
     nspdferror res;
+    struct cos_array *array;
+    void *data;
 
-    offset = *offset_out;
-
-    /* sanity check first token is list open */
-    if (stream_byte(stream, offset++) != '[') {
-        printf("list does not start with a [\n");
-        return NSPDFERROR_SYNTAX;
+    array = cos_alloc(stream, sizeof(struct cos_array));
+    if (array == NULL) {
+        return NSPDFERROR_NOMEM;
     }
 
-    /* advance offset to next token */
-    res = nspdf__stream_skip_ws(stream, &offset);
+    res = cos_alloc_scratch(doc, stream, mark, &data);
     if (res != NSPDFERROR_OK) {
+        if (stream->arena == NULL) {
+            free(array);
+        }
         return res;
     }
+    array->values = data;
+    array->length = length;
+    array->alloc = length;
 
-    //printf("found a list\n");
-    /* setup array object */
-    cosobj = calloc(1, sizeof(struct cos_object));
-    if (cosobj == NULL) {
-        return NSPDFERROR_NOMEM;
-    }
     cosobj->type = COS_TYPE_ARRAY;
-
-    array = calloc(1, sizeof(struct cos_array));
-    if (array == NULL) {
-        cos_free_object(cosobj);
-        return NSPDFERROR_NOMEM;
-    }
     cosobj->u.array = array;
 
-    while (stream_byte(stream, offset) != ']') {
-
-        res = cos_parse_object(doc, stream, &offset, &value);
-        if (res != NSPDFERROR_OK) {
-            cos_free_object(cosobj);
-            printf("Unable to decode value object in list\n");
-            return res;
-        }
-
-        /* ensure there is enough space allocated for object pointers */
-        if (array->alloc < (array->length + 1)) {
-            struct cos_object **nvalues;
-            nvalues = realloc(array->values,
-                            sizeof(struct cos_object *) * (array->alloc + 32));
-            if (nvalues == NULL) {
-                cos_free_object(cosobj);
-                return NSPDFERROR_NOMEM;
-            }
-            array->values = nvalues;
-            array->alloc += 32;
-        }
+    return NSPDFERROR_OK;
+}
 
-        *(array->values + array->length) = value;
-        array->length++;
-    }
-    offset++; /* skip closing ] */
 
-    nspdf__stream_skip_ws(stream, &offset);
-
-    *cosobj_out = cosobj;
-    *offset_out = offset;
-
-    return NSPDFERROR_OK;
+/**
+ * arena release function for interned names
+ */
+static void release_name(void *name)
+{
+    lwc_string_unref((lwc_string *)name);
 }
 
-
 /**
  * decode a name object
  *
@@ -527,13 +691,14 @@ cos_parse_list(struct nspdf_doc *doc,
 static nspdferror
 cos_parse_name(struct cos_stream *stream,
                strmoff_t *offset_out,
-               struct cos_object **cosobj_out)
+               struct cos_object *cosobj)
 {
     strmoff_t offset;
-    struct cos_object *cosobj;
+    lwc_string *name_str;
     uint8_t c;
     char name[NAME_MAX_LENGTH + 1];
     int idx = 0;
+    nspdferror res;
 
     offset = *offset_out;
 
@@ -557,21 +722,27 @@ cos_parse_name(struct cos_stream *stream,
         /* name length exceeded implementation limit */
         return NSPDFERROR_RANGE;
     }
-    name[idx] = 0;
-
-    //printf("name: %s\n", name);
 
     nspdf__stream_skip_ws(stream, &offset);
 
-    cosobj = calloc(1, sizeof(struct cos_object));
-    if (cosobj == NULL) {
-        return NSPDFERROR_NOMEM; /* memory error */
+    res = nspdf__lwc_error(lwc_intern_string(name, idx, &name_str));
+    if (res != NSPDFERROR_OK) {
+        return res;
     }
 
-    cosobj->type = COS_TYPE_NAME;
-    cosobj->u.name = strdup(name);
+    if (stream->arena != NULL) {
+        /* one reference to each distinct name is dropped with the arena */
+        res = nspdf__arena_adopt_reference(stream->arena,
+                                           name_str,
+                                           release_name);
+        if (res != NSPDFERROR_OK) {
+            lwc_string_unref(name_str);
+            return res;
+        }
+    }
 
-    *cosobj_out = cosobj;
+    cosobj->type = COS_TYPE_NAME;
+    cosobj->u.name = name_str;
 
     *offset_out = offset;
 
@@ -585,10 +756,9 @@ cos_parse_name(struct cos_stream *stream,
 static nspdferror
 cos_parse_boolean(struct cos_stream *stream,
                   strmoff_t *offset_out,
-                  struct cos_object **cosobj_out)
+                  struct cos_object *cosobj)
 {
     strmoff_t offset;
-    struct cos_object *cosobj;
     uint8_t c;
     bool value;
 
@@ -645,16 +815,9 @@ cos_parse_boolean(struct cos_stream *stream,
 
     nspdf__stream_skip_ws(stream, &offset);
 
-    cosobj = calloc(1, sizeof(struct cos_object));
-    if (cosobj == NULL) {
-        return NSPDFERROR_NOMEM; /* memory error */
-    }
-
     cosobj->type = COS_TYPE_BOOL;
     cosobj->u.b = value;
 
-    *cosobj_out = cosobj;
-
     *offset_out = offset;
 
     return NSPDFERROR_OK;
@@ -667,10 +830,9 @@ cos_parse_boolean(struct cos_stream *stream,
 static nspdferror
 cos_parse_null(struct cos_stream *stream,
                strmoff_t *offset_out,
-               struct cos_object **cosobj_out)
+               struct cos_object *cosobj)
 {
     strmoff_t offset;
-    struct cos_object *cosobj;
     uint8_t c;
 
     offset = *offset_out;
@@ -697,284 +859,696 @@ cos_parse_null(struct cos_stream *stream,
 
     nspdf__stream_skip_ws(stream, &offset);
 
-    cosobj = calloc(1, sizeof(struct cos_object));
-    if (cosobj == NULL) {
-        return NSPDFERROR_NOMEM;
-    }
-
     cosobj->type = COS_TYPE_NULL;
 
-    *cosobj_out = cosobj;
-
     *offset_out = offset;
 
     return NSPDFERROR_OK;
 }
 
-/**
- * parse a stream object
- */
-static nspdferror
-cos_parse_stream(struct nspdf_doc *doc,
-                 struct cos_stream *stream_in,
-                 strmoff_t *offset_out,
-                 struct cos_object **cosobj_out)
+/* exported interface documented in cos_parse.h */
+nspdferror
+cos_parse_stream_extent(struct nspdf_doc *doc,
+                        struct cos_stream *stream_in,
+                        strmoff_t *offset_out,
+                        struct cos_object *stream_dict,
+                        strmoff_t *data_offset_out,
+                        strmoff_t *length_out)
 {
-    struct cos_object *cosobj;
     nspdferror res;
-    struct cos_object *stream_dict;
     strmoff_t offset;
-    struct cos_object *stream_filter;
-    struct cos_stream *stream;
+    strmoff_t data_offset; /* offset of stream data */
     int64_t stream_length;
 
     offset = *offset_out;
-    stream_dict = *cosobj_out;
 
     if (stream_dict->type != COS_TYPE_DICTIONARY) {
         /* cannot be a stream if indirect object is not a dict */
         return NSPDFERROR_NOTFOUND;
     }
 
-    if ((stream_byte(stream_in, offset    ) != 's') ||
-        (stream_byte(stream_in, offset + 1) != 't') ||
-        (stream_byte(stream_in, offset + 2) != 'r') ||
-        (stream_byte(stream_in, offset + 3) != 'e') ||
-        (stream_byte(stream_in, offset + 4) != 'a') ||
-        (stream_byte(stream_in, offset + 5) != 'm')) {
+    res = nspdf__stream_find(stream_in,
+                             offset,
+                             offset + SLEN(STREAM_TOK),
+                             STREAM_TOK,
+                             SLEN(STREAM_TOK),
+                             &offset);
+    if (res != NSPDFERROR_OK) {
         /* no stream marker */
         return NSPDFERROR_NOTFOUND;
     }
-    offset += 6;
+    offset += SLEN(STREAM_TOK);
     //printf("detected stream\n");
 
-    /* parsed object was a dictionary and there is a stream marker */
+    /* parsed object was a dictionary and there is a stream marker which is
+     * followed by a single end of line. Skipping any more whitespace would
+     * consume leading bytes of binary stream data.
+     */
+    if (stream_byte(stream_in, offset) == '\r') {
+        offset++;
+    }
+    if (stream_byte(stream_in, offset) == '\n') {
+        offset++;
+    }
+    data_offset = offset;
+
+    res = cos_get_dictionary_int(doc,
+                                 stream_dict,
+                                 nspdf__atom_Length,
+                                 &stream_length);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    /* the stream data should be followed by the endstream marker */
+    res = NSPDFERROR_NOTFOUND;
+    if ((stream_length >= 0) &&
+        (data_offset <= stream_in->length) &&
+        ((uint64_t)stream_length <= (stream_in->length - data_offset))) {
+        offset = data_offset + stream_length;
+
+        /* possible whitespace after stream data */
+        nspdf__stream_skip_ws(stream_in, &offset);
+
+        res = nspdf__stream_find(stream_in,
+                                 offset,
+                                 offset + SLEN(ENDSTREAM_TOK),
+                                 ENDSTREAM_TOK,
+                                 SLEN(ENDSTREAM_TOK),
+                                 &offset);
+    }
+    if (res != NSPDFERROR_OK) {
+        /* the length is wrong, recover by searching for the marker */
+        res = nspdf__stream_find(stream_in,
+                                 data_offset,
+                                 stream_in->length,
+                                 ENDSTREAM_TOK,
+                                 SLEN(ENDSTREAM_TOK),
+                                 &offset);
+        if (res != NSPDFERROR_OK) {
+            /* no endstream marker */
+            return NSPDFERROR_SYNTAX;
+        }
+
+        /* the data is followed by an end of line before the marker */
+        stream_length = offset - data_offset;
+        if ((stream_length > 0) &&
+            (stream_byte(stream_in, data_offset + stream_length - 1) == '\n')) {
+            stream_length--;
+        }
+        if ((stream_length > 0) &&
+            (stream_byte(stream_in, data_offset + stream_length - 1) == '\r')) {
+            stream_length--;
+        }
+    }
+    offset += SLEN(ENDSTREAM_TOK);
+    //printf("detected endstream\n");
+
     res = nspdf__stream_skip_ws(stream_in, &offset);
     if (res != NSPDFERROR_OK) {
         return res;
     }
 
+    *offset_out = offset;
+    *data_offset_out = data_offset;
+    *length_out = stream_length;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * parse a stream object
+ *
+ * The stream dictionary in \p stream_dict is replaced by the stream object.
+ */
+static nspdferror
+cos_parse_stream(struct nspdf_doc *doc,
+                 struct cos_stream *stream_in,
+                 strmoff_t *offset_out,
+                 struct cos_object *stream_dict)
+{
+    nspdferror res;
+    strmoff_t offset;
+    strmoff_t data_offset; /* offset of stream data */
+    strmoff_t stream_length;
+    struct cos_object *stream_filter;
+    struct cos_stream *stream;
+
+    offset = *offset_out;
+
+    res = cos_parse_stream_extent(doc,
+                                  stream_in,
+                                  &offset,
+                                  stream_dict,
+                                  &data_offset,
+                                  &stream_length);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
     stream = calloc(1, sizeof(struct cos_stream));
     if (stream == NULL) {
         return NSPDFERROR_NOMEM;
     }
+    stream->length = stream_length;
+
+    //printf("stream length %d\n", stream_length);
+    if (stream_in->source != NULL) {
+        /* stream data is not in memory so must be read from the source */
+        uint8_t *data;
+
+        res = nspdf__source_read(stream_in->source,
+                                 data_offset,
+                                 stream->length,
+                                 &data);
+        if (res != NSPDFERROR_OK) {
+            free(stream);
+            return res;
+        }
+        stream->data = data;
+        stream->alloc = stream->length + STREAM_PADDING;
+    } else {
+        /* stream is pointing at non malloced data, it is followed by the
+         * remainder of the input stream and its padding
+         */
+        stream->data = stream_in->data + data_offset;
+        stream->alloc = 0;
+    }
+
+    //printf("returning with offset at %d\n", offset);
+    /* optional filter */
+    res = cos_get_dictionary_value(doc,
+                                   stream_dict,
+                                   nspdf__atom_Filter,
+                                   &stream_filter);
+    if (res == NSPDFERROR_OK) {
+        lwc_string *filter_name;
+        res = cos_get_name(doc, stream_filter, &filter_name);
+        if (res == NSPDFERROR_OK) {
+            res = nspdf__cos_stream_filter(doc, filter_name, &stream);
+            if (res != NSPDFERROR_OK) {
+                /* the unfiltered stream is left in place on failure */
+                if (stream->alloc != 0) {
+                    free((void *)stream->data);
+                }
+                free(stream);
+                return res;
+            }
+        } else {
+            /** \todo array of filter stream */
+        }
+    }
+
+    if (stream_in->arena != NULL) {
+        /* the stream is released with the arena instead of the object */
+        if (stream->alloc != 0) {
+            res = nspdf__arena_adopt(stream_in->arena, (void *)stream->data);
+            if (res != NSPDFERROR_OK) {
+                free((void *)stream->data);
+                free(stream);
+                return res;
+            }
+        }
+        res = nspdf__arena_adopt(stream_in->arena, stream);
+        if (res != NSPDFERROR_OK) {
+            free(stream);
+            return res;
+        }
+    }
+
+    /* the dictionary is no longer required */
+    cos_free_value(stream_dict);
+    stream_dict->type = COS_TYPE_STREAM;
+    stream_dict->u.stream = stream;
+
+    *offset_out = offset;
+
+    return NSPDFERROR_OK;
+}
 
-    res = cos_get_dictionary_int(doc, stream_dict, "Length", &stream_length);
+/**
+ * attempt to decode input data into a reference or the start of an indirect
+ *  object
+ *
+ * The input data already had a positive integer decoded from it:
+ * - if another positive integer follows and a R character after that it is a
+ *     reference,
+ *
+ * - if another positive integer follows and 'obj' after that it is the start
+ *     of an indirect object whose body is the next value.
+ *
+ * \param stream the stream being parsed
+ * \param offset_out offset of current cursor in input data
+ * \param cosobj the object to return into, on input contains the first
+ * integer
+ * \param indirect_out set true if an indirect object was started
+ */
+static nspdferror
+cos_attempt_parse_reference(struct cos_stream *stream,
+                            strmoff_t *offset_out,
+                            struct cos_object *cosobj,
+                            bool *indirect_out)
+{
+    nspdferror res;
+    strmoff_t offset;
+    uint8_t c;
+    struct cos_object generation; /* generation object */
+
+    offset = *offset_out;
+
+    res = cos_parse_number(stream, &offset, &generation);
+    if (res != NSPDFERROR_OK) {
+        /* no error if next token could not be decoded as a number */
+        return NSPDFERROR_OK;
+    }
+
+    if (generation.type != COS_TYPE_INT) {
+        /* next object was not an integer so not a reference */
+        return NSPDFERROR_OK;
+    }
+
+    if ((generation.u.i < 0) ||
+        (generation.u.i > UINT32_MAX) ||
+        (cosobj->u.i > UINT32_MAX)) {
+        /* integer was negative so not a reference (generations must be
+         * non-negative) or was too large to be an object identifier
+         */
+        return NSPDFERROR_OK;
+    }
+
+    /* two int in a row, look for the R */
+    c = stream_byte(stream, offset);
+    if (c == 'R') {
+        uint32_t id;
+
+        //printf("found object reference\n");
+        offset ++;
+
+        nspdf__stream_skip_ws(stream, &offset);
+
+        /* overwrite input object for output (it has to be an int which has no
+         * allocation to free)
+         */
+        id = (uint32_t)cosobj->u.i;
+        cosobj->type = COS_TYPE_REFERENCE;
+        cosobj->u.reference.id = id;
+        cosobj->u.reference.generation = (uint32_t)generation.u.i;
+
+        *offset_out = offset;
+
+    } else if ((c == 'o') &&
+               (stream_byte(stream, offset + 1) == 'b') &&
+               (stream_byte(stream, offset + 2) == 'j')) {
+        //printf("indirect\n");
+        offset += 3;
+
+        res = nspdf__stream_skip_ws(stream, &offset);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+
+        /* the object number is an integer which has no allocation and is
+         * replaced by the body once it is parsed
+         */
+        *indirect_out = true;
+        *offset_out = offset;
+    }
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * complete an indirect object once its body has been parsed
+ *
+ * A dictionary body followed by stream data is replaced by the stream object.
+ *  The body is freed on error.
+ */
+static nspdferror
+cos_parse_indirect_end(struct nspdf_doc *doc,
+                       struct cos_stream *stream,
+                       strmoff_t *offset_out,
+                       struct cos_object *indirect)
+{
+    nspdferror res;
+    strmoff_t offset;
+
+    offset = *offset_out;
+
+    /* attempt to parse input as a stream */
+    res = cos_parse_stream(doc, stream, &offset, indirect);
+    if ((res != NSPDFERROR_OK) &&
+        (res != NSPDFERROR_NOTFOUND)) {
+        cos_free_value(indirect);
+        return res;
+    }
+
+    if ((stream_byte(stream, offset    ) != 'e') ||
+        (stream_byte(stream, offset + 1) != 'n') ||
+        (stream_byte(stream, offset + 2) != 'd') ||
+        (stream_byte(stream, offset + 3) != 'o') ||
+        (stream_byte(stream, offset + 4) != 'b') ||
+        (stream_byte(stream, offset + 5) != 'j')) {
+        cos_free_value(indirect);
+        return NSPDFERROR_SYNTAX;
+    }
+    offset += 6;
+    //printf("endobj\n");
+
+    res = nspdf__stream_skip_ws(stream, &offset);
     if (res != NSPDFERROR_OK) {
+        cos_free_value(indirect);
         return res;
     }
-    if (stream_length < 0) {
+
+    *offset_out = offset;
+
+    return NSPDFERROR_OK;
+}
+
+
+/** frame mark used when there is no enclosing frame */
+#define COS_NO_FRAME SIZE_MAX
+
+/**
+ * kind of container a parse frame collects
+ */
+enum cos_frame_type {
+    COS_FRAME_NONE, /**< no container, the value is complete */
+    COS_FRAME_LIST, /**< values of an array */
+    COS_FRAME_DICTIONARY, /**< entries of a dictionary */
+    COS_FRAME_INDIRECT, /**< body of an indirect object */
+};
+
+/**
+ * container being parsed
+ *
+ * Each frame is pushed on the scratch stack directly below the values it
+ *  collects. Nested containers push their frame above the values of their
+ *  parent and release it once they are complete.
+ */
+struct cos_parse_frame {
+    size_t parent; /**< mark of the enclosing frame or COS_NO_FRAME */
+    size_t values; /**< mark of the first collected value */
+    enum cos_frame_type type;
+    unsigned int length; /**< number of collected values */
+    lwc_string *key; /**< dictionary key awaiting its value */
+};
+
+/**
+ * open a frame on the scratch stack
+ *
+ * \param doc The document whose scratch stack is used.
+ * \param type The kind of container opened.
+ * \param top The mark of the innermost frame, updated to the new frame.
+ * \param depth The number of open frames, checked against the document limit.
+ */
+static nspdferror
+cos_push_frame(struct nspdf_doc *doc,
+               enum cos_frame_type type,
+               size_t *top,
+               unsigned int *depth)
+{
+    nspdferror res;
+    struct cos_parse_frame frame;
+    struct cos_parse_frame *pushed;
+    size_t mark;
+
+    if (*depth >= doc->max_depth) {
         return NSPDFERROR_RANGE;
     }
-    stream->length = stream_length;
-
-    //printf("stream length %d\n", stream_length);
-    stream->data = stream_in->data + offset;
-    stream->alloc = 0; /* stream is pointing at non malloced data */
 
-    offset += stream->length;
+    frame.parent = *top;
+    frame.values = 0;
+    frame.type = type;
+    frame.length = 0;
+    frame.key = NULL;
+
+    mark = nspdf__scratch_mark(doc->scratch);
+    res = nspdf__scratch_push(doc->scratch, &frame, sizeof(frame));
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    pushed = nspdf__scratch_at(doc->scratch, mark);
+    pushed->values = nspdf__scratch_mark(doc->scratch);
+
+    *top = mark;
+    (*depth)++;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * close the innermost frame
+ */
+static inline void
+cos_pop_frame(struct nspdf_doc *doc, size_t *top, unsigned int *depth)
+{
+    struct cos_parse_frame *frame;
+    size_t parent;
+
+    frame = nspdf__scratch_at(doc->scratch, *top);
+    parent = frame->parent;
+    nspdf__scratch_release(doc->scratch, *top);
+
+    *top = parent;
+    (*depth)--;
+}
+
+/**
+ * check for the end of the container a frame collects
+ *
+ * \return true with the offset moved past the end of the container if it is
+ *         complete else false.
+ */
+static inline bool
+cos_frame_closed(struct cos_stream *stream,
+                 strmoff_t *offset_out,
+                 struct cos_parse_frame *frame)
+{
+    strmoff_t offset;
+
+    offset = *offset_out;
+
+    if (frame->type == COS_FRAME_LIST) {
+        if (stream_byte(stream, offset) != ']') {
+            return false;
+        }
+        offset++;
+    } else if ((frame->type == COS_FRAME_DICTIONARY) &&
+               (frame->key == NULL)) {
+        if ((stream_byte(stream, offset    ) != '>') &&
+            (stream_byte(stream, offset + 1) != '>')) {
+            return false;
+        }
+        offset += 2;
+    } else {
+        return false;
+    }
+
+    nspdf__stream_skip_ws(stream, &offset);
+
+    *offset_out = offset;
+
+    return true;
+}
+
+/**
+ * build the container a frame has collected into an object
+ *
+ * On error the collected values are left with the frame.
+ */
+static nspdferror
+cos_frame_build(struct nspdf_doc *doc,
+                struct cos_stream *stream,
+                size_t top,
+                struct cos_object *cosobj)
+{
+    struct cos_parse_frame *frame;
+
+    frame = nspdf__scratch_at(doc->scratch, top);
+    if (frame->type == COS_FRAME_LIST) {
+        return cos_build_array(doc,
+                               stream,
+                               frame->values,
+                               frame->length,
+                               cosobj);
+    }
+    return cos_build_dictionary(doc,
+                                stream,
+                                frame->values,
+                                frame->length,
+                                cosobj);
+}
+
+/**
+ * add a complete value to the container a frame collects
+ *
+ * Dictionary values are paired with the key awaiting them. On error the
+ *  value is not added and remains owned by the caller.
+ *
+ * \param doc The document whose scratch stack is used.
+ * \param top The mark of the frame.
+ * \param frame The frame which is invalidated if the stack moves.
+ * \param value The value to add.
+ */
+static inline nspdferror
+cos_frame_add(struct nspdf_doc *doc,
+              size_t top,
+              struct cos_parse_frame *frame,
+              struct cos_object *value)
+{
+    nspdferror res;
+    struct cos_dictionary_entry entry;
 
-    /* possible whitespace after stream data */
-    res = nspdf__stream_skip_ws(stream_in, &offset);
+    if (frame->type == COS_FRAME_LIST) {
+        res = nspdf__scratch_push(doc->scratch, value, sizeof(*value));
+    } else {
+        /* the entry takes the reference to the key name */
+        entry.key = frame->key;
+        entry.value = *value;
+        res = nspdf__scratch_push(doc->scratch, &entry, sizeof(entry));
+    }
     if (res != NSPDFERROR_OK) {
         return res;
     }
 
-    if ((stream_byte(stream_in, offset    ) != 'e') ||
-        (stream_byte(stream_in, offset + 1) != 'n') ||
-        (stream_byte(stream_in, offset + 2) != 'd') ||
-        (stream_byte(stream_in, offset + 3) != 's') ||
-        (stream_byte(stream_in, offset + 4) != 't') ||
-        (stream_byte(stream_in, offset + 5) != 'r') ||
-        (stream_byte(stream_in, offset + 6) != 'e') ||
-        (stream_byte(stream_in, offset + 7) != 'a') ||
-        (stream_byte(stream_in, offset + 8) != 'm')) {
-        /* no endstream marker */
-        return NSPDFERROR_SYNTAX;
-    }
-    offset += 9;
-    //printf("detected endstream\n");
+    /* the push may have moved the stack */
+    frame = nspdf__scratch_at(doc->scratch, top);
+    frame->key = NULL;
+    frame->length++;
 
-    res = nspdf__stream_skip_ws(stream_in, &offset);
-    if (res != NSPDFERROR_OK) {
-        return res;
-    }
+    return NSPDFERROR_OK;
+}
 
-    //printf("returning with offset at %d\n", offset);
-    /* optional filter */
-    res = cos_get_dictionary_value(doc, stream_dict, "Filter", &stream_filter);
-    if (res == NSPDFERROR_OK) {
-        const char *filter_name;
-        res = cos_get_name(doc, stream_filter, &filter_name);
-        if (res == NSPDFERROR_OK) {
-            res = nspdf__cos_stream_filter(doc, filter_name, &stream);
-            if (res != NSPDFERROR_OK) {
-                return res;
+/**
+ * release every open frame along with the values they have collected
+ */
+static void
+cos_unwind_frames(struct nspdf_doc *doc, struct cos_stream *stream, size_t top)
+{
+    struct cos_parse_frame *frame;
+    struct cos_object *values;
+    struct cos_dictionary_entry *entries;
+    unsigned int idx;
+
+    while (top != COS_NO_FRAME) {
+        frame = nspdf__scratch_at(doc->scratch, top);
+
+        if (frame->type == COS_FRAME_LIST) {
+            values = nspdf__scratch_at(doc->scratch, frame->values);
+            for (idx = 0; idx < frame->length; idx++) {
+                cos_free_value(&values[idx]);
+            }
+        } else if (frame->type == COS_FRAME_DICTIONARY) {
+            /* names from streams with an arena are released with it */
+            entries = nspdf__scratch_at(doc->scratch, frame->values);
+            for (idx = 0; idx < frame->length; idx++) {
+                if (stream->arena == NULL) {
+                    lwc_string_unref(entries[idx].key);
+                }
+                cos_free_value(&entries[idx].value);
+            }
+            if ((frame->key != NULL) && (stream->arena == NULL)) {
+                lwc_string_unref(frame->key);
             }
-        } else {
-            /** \todo array of filter stream */
         }
-    }
 
-    /* allocate stream object */
-    cosobj = calloc(1, sizeof(struct cos_object));
-    if (cosobj == NULL) {
-        free(stream);
-        return NSPDFERROR_NOMEM;
+        nspdf__scratch_release(doc->scratch, top);
+        top = frame->parent;
     }
-    cosobj->type = COS_TYPE_STREAM;
-    cosobj->u.stream = stream;
-
-    *cosobj_out = cosobj;
-    *offset_out = offset;
-
-    return NSPDFERROR_OK;
 }
 
+
 /**
- * attempt to decode input data into a reference, indirect or stream object
- *
- * The input data already had a positive integer decoded from it:
- * - if another positive integer follows and a R character after that it is a
- *     reference,
- *
- * - if another positive integer follows and 'obj' after that:
- *     - a direct object followed by 'endobj' it is an indirect object.
- *
- *     - a direct dictionary object followed by 'stream', then stream data,
- *       then 'endstream' then 'endobj' it is a stream object
+ * parse a scalar value or the start of a container
  *
  * \param doc the pdf document
+ * \param stream the stream being parsed
  * \param offset_out offset of current cursor in input data
- * \param cosobj_out the object to return into, on input contains the first
- * integer
+ * \param cosobj the object a scalar value is parsed into
+ * \param open_out the kind of container started or COS_FRAME_NONE if a
+ *                  complete value was parsed
  */
 static nspdferror
-cos_attempt_parse_reference(struct nspdf_doc *doc,
-                            struct cos_stream *stream,
-                            strmoff_t *offset_out,
-                            struct cos_object **cosobj_out)
+cos_parse_token(struct nspdf_doc *doc,
+                struct cos_stream *stream,
+                strmoff_t *offset_out,
+                struct cos_object *cosobj,
+                enum cos_frame_type *open_out)
 {
-    nspdferror res;
     strmoff_t offset;
-    uint8_t c;
-    struct cos_object *generation; /* generation object */
+    nspdferror res;
+    bool indirect = false;
 
     offset = *offset_out;
 
-    res = cos_parse_number(stream, &offset, &generation);
-    if (res != NSPDFERROR_OK) {
-        /* no error if next token could not be decoded as a number */
-        return NSPDFERROR_OK;
-    }
-
-    if (generation->type != COS_TYPE_INT) {
-        /* next object was not an integer so not a reference */
-        cos_free_object(generation);
-        return NSPDFERROR_OK;
-    }
+    *open_out = COS_FRAME_NONE;
 
-    if (generation->u.i < 0) {
-        /* integer was negative so not a reference (generations must be
-         * non-negative
-         */
-        cos_free_object(generation);
-        return NSPDFERROR_OK;
+    if (offset >= stream->length) {
+        return NSPDFERROR_RANGE;
     }
 
-    /* two int in a row, look for the R */
-    c = stream_byte(stream, offset);
-    if (c == 'R') {
-        struct cos_reference *nref; /* new reference */
-
-        //printf("found object reference\n");
-        offset ++;
-
-        nspdf__stream_skip_ws(stream, &offset);
+    /* object could be any type use first char to try and select */
+    switch (bclass_token(stream_byte(stream, offset))) {
 
-        nref = calloc(1, sizeof(struct cos_reference));
-        if (nref == NULL) {
-            cos_free_object(generation);
-            return NSPDFERROR_NOMEM; /* memory error */
+    case BC_TOK_NUMBER:
+        res = cos_parse_number(stream, &offset, cosobj);
+        /* if type is positive integer try to check for reference */
+        if ((res == NSPDFERROR_OK) &&
+            (cosobj->type == COS_TYPE_INT) &&
+            (cosobj->u.i > 0)) {
+            res = cos_attempt_parse_reference(stream,
+                                              &offset,
+                                              cosobj,
+                                              &indirect);
+            if (indirect) {
+                *open_out = COS_FRAME_INDIRECT;
+            }
         }
+        break;
 
-        nref->id = (*cosobj_out)->u.i;
-        nref->generation = generation->u.i;
-
-        /* overwrite input object for output (it has to be an int which has no
-         * allocation to free)
-         */
-        (*cosobj_out)->type = COS_TYPE_REFERENCE;
-        (*cosobj_out)->u.reference = nref;
-
-        *offset_out = offset;
-
-    } else if ((c == 'o') &&
-               (stream_byte(stream, offset + 1) == 'b') &&
-               (stream_byte(stream, offset + 2) == 'j')) {
-        struct cos_object *indirect; /* indirect object */
-        //printf("indirect\n");
-        offset += 3;
+    case BC_TOK_BOOLEAN:
+        res = cos_parse_boolean(stream, &offset, cosobj);
+        break;
 
-        res = nspdf__stream_skip_ws(stream, &offset);
-        if (res != NSPDFERROR_OK) {
-            cos_free_object(generation);
-            return res;
-        }
-        //printf("decoding\n");
+    case BC_TOK_NULL:
+        res = cos_parse_null(stream, &offset, cosobj);
+        break;
 
-        res = cos_parse_object(doc, stream, &offset, &indirect);
-        if (res != NSPDFERROR_OK) {
-            cos_free_object(generation);
-            return res;
-        }
+    case BC_TOK_STRING:
+        res = cos_parse_string(doc, stream, &offset, cosobj);
+        break;
 
-        /* attempt to parse input as a stream */
-        res = cos_parse_stream(doc, stream, &offset, &indirect);
-        if ((res != NSPDFERROR_OK) &&
-            (res != NSPDFERROR_NOTFOUND)) {
-            cos_free_object(indirect);
-            cos_free_object(generation);
-            return res;
-        }
+    case BC_TOK_NAME:
+        res = cos_parse_name(stream, &offset, cosobj);
+        break;
 
-        /*printf("parsed indirect object num:%d gen:%d type %d\n",
-               (*cosobj_out)->u.i,
-               generation->u.i,
-               indirect->type);
-        */
-
-        if ((stream_byte(stream, offset    ) != 'e') ||
-            (stream_byte(stream, offset + 1) != 'n') ||
-            (stream_byte(stream, offset + 2) != 'd') ||
-            (stream_byte(stream, offset + 3) != 'o') ||
-            (stream_byte(stream, offset + 4) != 'b') ||
-            (stream_byte(stream, offset + 5) != 'j')) {
-            cos_free_object(indirect);
-            cos_free_object(generation);
-            return NSPDFERROR_SYNTAX;
+    case BC_TOK_ANGLE:
+        if (stream_byte(stream, offset + 1) == '<') {
+            offset += 2;
+            res = nspdf__stream_skip_ws(stream, &offset);
+            *open_out = COS_FRAME_DICTIONARY;
+        } else {
+            res = cos_parse_hex_string(doc, stream, &offset, cosobj);
         }
-        offset += 6;
-        //printf("endobj\n");
+        break;
 
+    case BC_TOK_LIST:
+        offset++;
         res = nspdf__stream_skip_ws(stream, &offset);
-        if (res != NSPDFERROR_OK) {
-            cos_free_object(indirect);
-            cos_free_object(generation);
-            return res;
-        }
-
-        cos_free_object(*cosobj_out);
+        *open_out = COS_FRAME_LIST;
+        break;
 
-        *cosobj_out = indirect;
+    default:
+        res = NSPDFERROR_SYNTAX; /* syntax error */
+    }
 
+    if (res == NSPDFERROR_OK) {
         *offset_out = offset;
-
-        //printf("returning object\n");
     }
 
-    cos_free_object(generation);
-    return NSPDFERROR_OK;
+    return res;
 }
 
 
@@ -1029,76 +1603,132 @@ cos_attempt_parse_reference(struct nspdf_doc *doc,
  *   |
  *  TOK_UINT TOK_UINT 'obj' dictionary 'stream' streamdata 'endstream' 'endobj'
  *   ;
+ *
+ * Containers are parsed iteratively with a frame for each open list,
+ *  dictionary or indirect object held on the scratch stack below the values
+ *  it has collected. Nesting is bounded by the document depth limit instead
+ *  of the C stack.
  */
-nspdferror
-cos_parse_object(struct nspdf_doc *doc,
-                 struct cos_stream *stream,
-                 strmoff_t *offset_out,
-                 struct cos_object **cosobj_out)
+static nspdferror
+cos_parse_value(struct nspdf_doc *doc,
+                struct cos_stream *stream,
+                strmoff_t *offset_out,
+                struct cos_object *value)
 {
-    strmoff_t offset;
     nspdferror res;
-    struct cos_object *cosobj;
+    strmoff_t offset;
+    struct cos_parse_frame *frame;
+    struct cos_object cosobj;
+    enum cos_frame_type open;
+    size_t top = COS_NO_FRAME; /* mark of the innermost open frame */
+    unsigned int depth = 0; /* number of open frames */
 
     offset = *offset_out;
 
-    if (offset >= stream->length) {
-        return NSPDFERROR_RANGE;
-    }
+    for (;;) {
+        cosobj.type = COS_TYPE_NULL;
+        cosobj.arena = (stream->arena != NULL);
 
-    /* object could be any type use first char to try and select */
-    switch (stream_byte(stream, offset)) {
+        frame = NULL;
+        if (top != COS_NO_FRAME) {
+            frame = nspdf__scratch_at(doc->scratch, top);
+        }
 
-    case '-': case '+': case '.': case '0': case '1': case '2': case '3':
-    case '4': case '5': case '6': case '7': case '8': case '9':
-        res = cos_parse_number(stream, &offset, &cosobj);
-        /* if type is positive integer try to check for reference */
-        if ((res == NSPDFERROR_OK) &&
-            (cosobj->type == COS_TYPE_INT) &&
-            (cosobj->u.i > 0)) {
-            res = cos_attempt_parse_reference(doc, stream, &offset, &cosobj);
+        if ((frame != NULL) && cos_frame_closed(stream, &offset, frame)) {
+            res = cos_frame_build(doc, stream, top, &cosobj);
+            if (res != NSPDFERROR_OK) {
+                goto cos_parse_value_error;
+            }
+            cos_pop_frame(doc, &top, &depth);
+        } else if ((frame != NULL) &&
+                   (frame->type == COS_FRAME_DICTIONARY) &&
+                   (frame->key == NULL)) {
+            /* each dictionary value is preceded by a name key */
+            if (offset >= stream->length) {
+                res = NSPDFERROR_RANGE;
+                goto cos_parse_value_error;
+            }
+            res = cos_parse_name(stream, &offset, &cosobj);
+            if (res != NSPDFERROR_OK) {
+                printf("dictionary key decode failed\n");
+                goto cos_parse_value_error;
+            }
+            frame->key = cosobj.u.name;
+            continue;
+        } else {
+            res = cos_parse_token(doc, stream, &offset, &cosobj, &open);
+            if (res != NSPDFERROR_OK) {
+                goto cos_parse_value_error;
+            }
+            if (open != COS_FRAME_NONE) {
+                res = cos_push_frame(doc, open, &top, &depth);
+                if (res != NSPDFERROR_OK) {
+                    goto cos_parse_value_error;
+                }
+                continue;
+            }
         }
-        break;
 
-    case 't':
-    case 'f':
-        res = cos_parse_boolean(stream, &offset, &cosobj);
-        break;
+        /* an indirect object is complete once its body is */
+        while (top != COS_NO_FRAME) {
+            frame = nspdf__scratch_at(doc->scratch, top);
+            if (frame->type != COS_FRAME_INDIRECT) {
+                break;
+            }
+            res = cos_parse_indirect_end(doc, stream, &offset, &cosobj);
+            if (res != NSPDFERROR_OK) {
+                goto cos_parse_value_error;
+            }
+            cos_pop_frame(doc, &top, &depth);
+        }
 
-    case 'n':
-        res = cos_parse_null(stream, &offset, &cosobj);
-        break;
+        if (top == COS_NO_FRAME) {
+            break;
+        }
 
-    case '(':
-        res = cos_parse_string(stream, &offset, &cosobj);
-        break;
+        res = cos_frame_add(doc, top, frame, &cosobj);
+        if (res != NSPDFERROR_OK) {
+            cos_free_value(&cosobj);
+            goto cos_parse_value_error;
+        }
+    }
 
-    case '/':
-        res = cos_parse_name(stream, &offset, &cosobj);
-        break;
+    *value = cosobj;
+    *offset_out = offset;
 
-    case '<':
-        if (stream_byte(stream, offset + 1) == '<') {
-            res = cos_parse_dictionary(doc, stream, &offset, &cosobj);
-        } else {
-            res = cos_parse_hex_string(stream, &offset, &cosobj);
-        }
-        break;
+    return NSPDFERROR_OK;
 
-    case '[':
-        res = cos_parse_list(doc, stream, &offset, &cosobj);
-        break;
+cos_parse_value_error:
+    cos_unwind_frames(doc, stream, top);
 
-    default:
-        res = NSPDFERROR_SYNTAX; /* syntax error */
+    return res;
+}
+
+
+/* exported interface documented in cos_parse.h */
+nspdferror
+cos_parse_object(struct nspdf_doc *doc,
+                 struct cos_stream *stream,
+                 strmoff_t *offset_out,
+                 struct cos_object **cosobj_out)
+{
+    nspdferror res;
+    struct cos_object *cosobj;
+
+    cosobj = cos_alloc_object(stream, COS_TYPE_NULL);
+    if (cosobj == NULL) {
+        return NSPDFERROR_NOMEM;
     }
 
-    if (res == NSPDFERROR_OK) {
-        *cosobj_out = cosobj;
-        *offset_out = offset;
+    res = cos_parse_value(doc, stream, offset_out, cosobj);
+    if (res != NSPDFERROR_OK) {
+        cos_free_object(cosobj);
+        return res;
     }
 
-    return res;
+    *cosobj_out = cosobj;
+
+    return NSPDFERROR_OK;
 }
 
 
@@ -1111,7 +1741,7 @@ parse_operator(struct cos_stream *stream,
     strmoff_t offset;
     enum content_operator operator;
     uint8_t c;
-    unsigned int lookup;
+    uint32_t lookup;
 
     offset = *offset_out;
 
@@ -1149,94 +1779,14 @@ parse_operator(struct cos_stream *stream,
         }
     }
 
-    res = nspdf__stream_skip_ws(stream, &offset);
+    res = nspdf__cos_content_operator(lookup, &operator);
     if (res != NSPDFERROR_OK) {
-        return res;
+        return NSPDFERROR_SYNTAX;
     }
 
-    switch (lookup) {
-    case '"': operator = CONTENT_OP___;
-    case '\'': operator = CONTENT_OP__; break;
-    case 'B': operator = CONTENT_OP_B; break;
-    case 'F': operator = CONTENT_OP_F; break;
-    case 'G': operator = CONTENT_OP_G; break;
-    case 'J': operator = CONTENT_OP_J; break;
-    case 'K': operator = CONTENT_OP_K; break;
-    case 'M': operator = CONTENT_OP_M; break;
-    case 'Q': operator = CONTENT_OP_Q; break;
-    case 'S': operator = CONTENT_OP_S; break;
-    case 'W': operator = CONTENT_OP_W; break;
-    case 'b': operator = CONTENT_OP_b; break;
-    case 'c': operator = CONTENT_OP_c; break;
-    case 'd': operator = CONTENT_OP_d; break;
-    case 'f': operator = CONTENT_OP_f; break;
-    case 'g': operator = CONTENT_OP_g; break;
-    case 'h': operator = CONTENT_OP_h; break;
-    case 'i': operator = CONTENT_OP_i; break;
-    case 'j': operator = CONTENT_OP_j; break;
-    case 'k': operator = CONTENT_OP_k; break;
-    case 'l': operator = CONTENT_OP_l; break;
-    case 'm': operator = CONTENT_OP_m; break;
-    case 'n': operator = CONTENT_OP_n; break;
-    case 'q': operator = CONTENT_OP_q; break;
-    case 's': operator = CONTENT_OP_s; break;
-    case 'v': operator = CONTENT_OP_v; break;
-    case 'w': operator = CONTENT_OP_w; break;
-    case 'y': operator = CONTENT_OP_y; break;
-
-    case (('B' << 8) | '*'): operator = CONTENT_OP_B_; break;
-    case (('T' << 8) | '*'): operator = CONTENT_OP_T_; break;
-    case (('W' << 8) | '*'): operator = CONTENT_OP_W_; break;
-
-    case (('B' << 8) | 'I'): operator = CONTENT_OP_BI; break;
-    case (('B' << 8) | 'T'): operator = CONTENT_OP_BT; break;
-    case (('B' << 8) | 'X'): operator = CONTENT_OP_BX; break;
-    case (('C' << 8) | 'S'): operator = CONTENT_OP_CS; break;
-    case (('D' << 8) | 'P'): operator = CONTENT_OP_DP; break;
-    case (('E' << 8) | 'I'): operator = CONTENT_OP_EI; break;
-    case (('E' << 8) | 'T'): operator = CONTENT_OP_ET; break;
-    case (('E' << 8) | 'X'): operator = CONTENT_OP_EX; break;
-    case (('I' << 8) | 'D'): operator = CONTENT_OP_ID; break;
-    case (('M' << 8) | 'P'): operator = CONTENT_OP_MP; break;
-    case (('R' << 8) | 'G'): operator = CONTENT_OP_RG; break;
-    case (('S' << 8) | 'S'): operator = CONTENT_OP_SC; break;
-    case (('T' << 8) | 'D'): operator = CONTENT_OP_TD; break;
-    case (('T' << 8) | 'J'): operator = CONTENT_OP_TJ; break;
-    case (('T' << 8) | 'L'): operator = CONTENT_OP_TL; break;
-
-    case (('D' << 8) | 'o'): operator = CONTENT_OP_Do; break;
-    case (('T' << 8) | 'c'): operator = CONTENT_OP_Tc; break;
-    case (('T' << 8) | 'd'): operator = CONTENT_OP_Td; break;
-    case (('T' << 8) | 'f'): operator = CONTENT_OP_Tf; break;
-    case (('T' << 8) | 'j'): operator = CONTENT_OP_Tj; break;
-    case (('T' << 8) | 'm'): operator = CONTENT_OP_Tm; break;
-    case (('T' << 8) | 'r'): operator = CONTENT_OP_Tr; break;
-    case (('T' << 8) | 's'): operator = CONTENT_OP_Ts; break;
-    case (('T' << 8) | 'w'): operator = CONTENT_OP_Tw; break;
-    case (('T' << 8) | 'z'): operator = CONTENT_OP_Tz; break;
-
-    case (('b' << 8) | '*'): operator = CONTENT_OP_b_; break;
-    case (('f' << 8) | '*'): operator = CONTENT_OP_f_; break;
-    case (('d' << 8) | '0'): operator = CONTENT_OP_d0; break;
-    case (('d' << 8) | '1'): operator = CONTENT_OP_d1; break;
-
-    case (('c' << 8) | 'm'): operator = CONTENT_OP_cm; break;
-    case (('c' << 8) | 's'): operator = CONTENT_OP_cs; break;
-    case (('g' << 8) | 's'): operator = CONTENT_OP_gs; break;
-    case (('r' << 8) | 'e'): operator = CONTENT_OP_re; break;
-    case (('r' << 8) | 'g'): operator = CONTENT_OP_rg; break;
-    case (('r' << 8) | 'i'): operator = CONTENT_OP_ri; break;
-    case (('s' << 8) | 'c'): operator = CONTENT_OP_sc; break;
-    case (('s' << 8) | 'h'): operator = CONTENT_OP_sh; break;
-
-    case (('B' << 16) | (('D' << 8) | 'C')): operator = CONTENT_OP_BDC; break;
-    case (('B' << 16) | (('M' << 8) | 'C')): operator = CONTENT_OP_BMC; break;
-    case (('E' << 16) | (('M' << 8) | 'C')): operator = CONTENT_OP_EMC; break;
-    case (('S' << 16) | (('C' << 8) | 'N')): operator = CONTENT_OP_SCN; break;
-    case (('s' << 16) | (('c' << 8) | 'n')): operator = CONTENT_OP_scn; break;
-
-    default:
-        return NSPDFERROR_SYNTAX;
+    res = nspdf__stream_skip_ws(stream, &offset);
+    if (res != NSPDFERROR_OK) {
+        return res;
     }
 
     *operator_out = operator;
@@ -1254,82 +1804,124 @@ parse_operator(struct cos_stream *stream,
  */
 #define MAX_OPERAND_COUNT 32
 
+/**
+ * release the values of operands which were not consumed by an operator
+ */
+static void
+free_content_operands(struct cos_object *operands, unsigned int *operand_idx)
+{
+    unsigned int index;
+
+    for (index = 0; index < *operand_idx; index++) {
+        cos_free_value(operands + index);
+    }
+    *operand_idx = 0;
+}
+
+/**
+ * parse operands and an operator from a content stream into an operation
+ *
+ * Operands are parsed directly into the caller's operand buffer so scalar
+ *  operands need no allocation. Operands preceding the end of the stream
+ *  remain in the buffer and are used by the next operator parsed.
+ *
+ * The operation is packed onto the document scratch stack.
+ */
 static inline nspdferror
 parse_content_operation(struct nspdf_doc *doc,
                         struct cos_stream *stream,
                         strmoff_t *offset_out,
-                        struct cos_object **operands,
-                        unsigned int *operand_idx,
-                        struct content_operation *operation_out)
+                        struct cos_object *operands,
+                        unsigned int *operand_idx)
 {
     strmoff_t offset;
     nspdferror res;
     enum content_operator operator;
+    struct cos_object *operand;
+    enum bc_token token;
+    size_t top;
 
     offset = *offset_out;
 
-    res = parse_operator(stream, &offset, &operator);
-    while (res == NSPDFERROR_SYNTAX) {
+    /* operand parsing may leave alignment on the scratch stack */
+    top = nspdf__scratch_top(doc->scratch);
+
+    for (;;) {
+        token = BC_TOK_NONE;
+        if (offset < stream->length) {
+            token = bclass_token(stream_byte(stream, offset));
+        }
+
+        /* only keywords may be operators */
+        if ((token == BC_TOK_KEYWORD) ||
+            (token == BC_TOK_BOOLEAN) ||
+            (token == BC_TOK_NULL)) {
+            res = parse_operator(stream, &offset, &operator);
+            if (res == NSPDFERROR_OK) {
+                break;
+            }
+            if (res != NSPDFERROR_SYNTAX) {
+                return res;
+            }
+        }
+
         /* was not an operator so check for what else it could have been */
         if (*operand_idx >= MAX_OPERAND_COUNT) {
-            /** \todo free any stacked operands */
             printf("too many operands\n");
             return NSPDFERROR_SYNTAX;
         }
 
         if (offset >= stream->length) {
+            nspdf__scratch_release(doc->scratch, top);
             *offset_out = offset;
             return NSPDFERROR_INCOMPLETE;
         }
 
-        switch (stream_byte(stream, offset)) {
+        operand = operands + *operand_idx;
+        operand->type = COS_TYPE_NULL;
+        operand->arena = (stream->arena != NULL);
+
+        switch (token) {
 
-        case '-': case '+': case '.': case '0': case '1': case '2': case '3':
-        case '4': case '5': case '6': case '7': case '8': case '9':
-            res = cos_parse_number(stream, &offset, &operands[*operand_idx]);
+        case BC_TOK_NUMBER:
+            res = cos_parse_number(stream, &offset, operand);
             break;
 
-        case 't':
-        case 'f':
-            res = cos_parse_boolean(stream, &offset, &operands[*operand_idx]);
+        case BC_TOK_BOOLEAN:
+            res = cos_parse_boolean(stream, &offset, operand);
             break;
 
-        case 'n':
-            res = cos_parse_null(stream, &offset, &operands[*operand_idx]);
+        case BC_TOK_NULL:
+            res = cos_parse_null(stream, &offset, operand);
             break;
 
-        case '(':
-            res = cos_parse_string(stream, &offset, &operands[*operand_idx]);
+        case BC_TOK_STRING:
+            res = cos_parse_string(doc, stream, &offset, operand);
             break;
 
-        case '/':
-            res = cos_parse_name(stream, &offset, &operands[*operand_idx]);
+        case BC_TOK_NAME:
+            res = cos_parse_name(stream, &offset, operand);
             break;
 
-        case '[':
-            res = cos_parse_list(doc, stream, &offset, &operands[*operand_idx]);
+        case BC_TOK_LIST:
+            res = cos_parse_value(doc, stream, &offset, operand);
             break;
 
-        case '<':
+        case BC_TOK_ANGLE:
             if (stream_byte(stream, offset + 1) == '<') {
-                res = cos_parse_dictionary(doc,
-                                           stream,
-                                           &offset,
-                                           &operands[*operand_idx]);
+                res = cos_parse_value(doc, stream, &offset, operand);
             } else {
-                res = cos_parse_hex_string(stream,
-                                           &offset,
-                                           &operands[*operand_idx]);
+                res = cos_parse_hex_string(doc, stream, &offset, operand);
             }
             break;
 
         default:
-            printf("unknown operand with %d operands %d to %d of %d\n>>>%.*s<<<\n",
+            printf("unknown operand with %d operands %" PRIu64 " to %" PRIu64 " of %" PRIu64 "\n>>>%.*s<<<\n",
                    *operand_idx,
                    (*offset_out),
                    offset,
                    stream->length,
-                   (offset + 1) - (*offset_out),
+                   (int)((offset + 1) - (*offset_out)),
                    stream->data + (*offset_out));
 
             res = NSPDFERROR_SYNTAX; /* syntax error */
@@ -1337,16 +1929,14 @@ parse_content_operation(struct nspdf_doc *doc,
 
         if (res != NSPDFERROR_OK) {
             /* parse error */
-            /** \todo free any stacked operands */
             printf("operand parse failed at %c\n",
                    stream_byte(stream, offset));
+            cos_free_value(operand);
             return res;
         }
 
         /* move to next operand */
         (*operand_idx)++;
-
-        res = parse_operator(stream, &offset, &operator);
     }
 
     /*
@@ -1360,14 +1950,13 @@ parse_content_operation(struct nspdf_doc *doc,
            stream->data + (*offset_out));
     */
 
+    nspdf__scratch_release(doc->scratch, top);
+
     res = nspdf__cos_content_convert(operator,
                                      operands,
                                      operand_idx,
-                                     operation_out);
+                                     doc->scratch);
     if (res == NSPDFERROR_OK) {
-
-        *operand_idx = 0;
-
         *offset_out = offset;
     }
 
@@ -1385,8 +1974,12 @@ cos_parse_content_streams(struct nspdf_doc *doc,
     strmoff_t offset;
     struct cos_stream *stream;
     unsigned int stream_index;
-    struct cos_object *operands[MAX_OPERAND_COUNT];
+    struct cos_object operands[MAX_OPERAND_COUNT];
     unsigned int operand_idx = 0;
+    unsigned int length = 0;
+    size_t size = 0;
+    size_t mark;
+    void *data;
 
     //#define SHOW_STRUCT_SIZE
     #ifdef SHOW_STRUCT_SIZE
@@ -1420,6 +2013,9 @@ cos_parse_content_streams(struct nspdf_doc *doc,
     }
     cosobj->type = COS_TYPE_CONTENT;
 
+    /* operations are built on the scratch stack */
+    mark = nspdf__scratch_mark(doc->scratch);
+
     cosobj->u.content = calloc(1, sizeof (struct cos_content));
     if (cosobj->u.content == NULL) {
         res = NSPDFERROR_NOMEM;
@@ -1440,30 +2036,15 @@ cos_parse_content_streams(struct nspdf_doc *doc,
 
         while (offset < stream->length) {
 
-            /* ensure there is space in the operations array */
-            if (cosobj->u.content->alloc < (cosobj->u.content->length + 1)) {
-                struct content_operation *newops;
-                newops = realloc(cosobj->u.content->operations,
-                                 sizeof(struct content_operation) *
-                                 (cosobj->u.content->alloc + 32));
-                if (newops == NULL) {
-                    res = NSPDFERROR_NOMEM;
-                    goto cos_parse_content_stream_error;
-                }
-                cosobj->u.content->operations = newops;
-                cosobj->u.content->alloc += 32;
-            }
-
             /* parse an operation out */
-            res = parse_content_operation(
-                doc,
-                stream,
-                &offset,
-                operands,
-                &operand_idx,
-                cosobj->u.content->operations + cosobj->u.content->length);
+            res = parse_content_operation(doc,
+                                          stream,
+                                          &offset,
+                                          operands,
+                                          &operand_idx);
             if (res== NSPDFERROR_OK) {
-                cosobj->u.content->length++;
+                size = nspdf__scratch_size(doc->scratch, mark);
+                length++;
             } else if (res == NSPDFERROR_INCOMPLETE) {
                 //printf("Incomplete\n");
             } else if (res != NSPDFERROR_OK) {
@@ -1472,11 +2053,34 @@ cos_parse_content_streams(struct nspdf_doc *doc,
 
         }
     }
+
+    /* operands with no operator following them are discarded */
+    free_content_operands(operands, &operand_idx);
+
+    data = NULL;
+    if (size > 0) {
+        data = malloc(size);
+        if (data == NULL) {
+            res = NSPDFERROR_NOMEM;
+            goto cos_parse_content_stream_error;
+        }
+        memcpy(data, nspdf__scratch_at(doc->scratch, mark), size);
+    }
+    nspdf__scratch_release(doc->scratch, mark);
+
+    cosobj->u.content->operations = data;
+    cosobj->u.content->length = length;
+    cosobj->u.content->size = size;
+
     *content_out = cosobj;
 
     return NSPDFERROR_OK;
 
 cos_parse_content_stream_error:
+    free_content_operands(operands, &operand_idx);
+    /* release operands held by the completed operations */
+    nspdf__cos_content_release(nspdf__scratch_at(doc->scratch, mark), size);
+    nspdf__scratch_release(doc->scratch, mark);
     cos_free_object(cosobj);
     return res;
 }
@@ -27,6 +27,21 @@ struct cos_object;
  */
 nspdferror cos_parse_object(struct nspdf_doc *doc, struct cos_stream *stream, strmoff_t *offset_out, struct cos_object **cosobj_out);
 
+/**
+ * Locate the data of a stream object
+ *
+ * \param doc The document.
+ * \param stream The stream being parsed.
+ * \param offset_out The offset following the stream dictionary, updated to
+ *                   the offset following the endstream marker.
+ * \param stream_dict The stream dictionary.
+ * \param data_offset_out The offset of the encoded stream data.
+ * \param length_out The length of the encoded stream data.
+ * \return NSPDFERROR_OK on success or NSPDFERROR_NOTFOUND if the dictionary is
+ *          not followed by stream data.
+ */
+nspdferror cos_parse_stream_extent(struct nspdf_doc *doc, struct cos_stream *stream, strmoff_t *offset_out, struct cos_object *stream_dict, strmoff_t *data_offset_out, strmoff_t *length_out);
+
 /**
  * Parse content stream into content operations object
  */
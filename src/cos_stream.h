@@ -15,22 +15,90 @@
 #ifndef NSPDF__COS_STREAM_H_
 #define NSPDF__COS_STREAM_H_
 
-/* stream offset type */
-typedef unsigned int strmoff_t;
+/* stream offset type, wide enough for documents larger than 4GiB */
+typedef uint64_t strmoff_t;
+
+struct nspdf_source;
+struct nspdf_arena;
+
+/**
+ * number of readable bytes which follow the data of every in memory stream
+ *
+ * Allocated stream data is followed by an end of line and then sentinel bytes
+ *  (see stream_pad()). Streams referencing part of another stream are followed
+ *  by the remainder of that stream and its padding. Scanners stop within the
+ *  padding without checking the stream length on every byte and only check
+ *  the offset against the length once a token ends. The padding is larger
+ *  than twice the widest vector load so block scanners may load from any
+ *  offset up to one past the end of line.
+ */
+#define STREAM_PADDING 64
+
+/**
+ * sentinel byte used to pad streams
+ *
+ * This is a delimiter which cannot start any token and is not whitespace.
+ */
+#define STREAM_SENTINEL ')'
 
 /**
  * stream of data.
+ *
+ * Streams are either held entirely in memory or, for a document read from a
+ *  byte source, accessed through a window onto the source chunk cache.
  */
 struct cos_stream {
     strmoff_t length; /**< decoded stream length */
     size_t alloc; /**< memory allocated for stream */
-    const uint8_t *data; /**< decoded stream data */
+    const uint8_t *data; /**< decoded stream data or current window data */
+
+    /**
+     * region objects parsed from the stream are allocated from or NULL to
+     *  allocate them individually
+     */
+    struct nspdf_arena *arena;
+
+    struct nspdf_source *source; /**< byte source or NULL if in memory */
+    strmoff_t window_offset; /**< offset of window data within source */
+    strmoff_t window_length; /**< length of window data */
 };
 
+/**
+ * get a byte from a stream outside of the current window
+ *
+ * Moves the window of a byte source backed stream to the chunk containing
+ *  offset. Bytes beyond the end of the source are returned as the padding an
+ *  in memory stream would have and bytes which cannot be fetched are returned
+ *  as sentinels.
+ */
+uint8_t nspdf__source_stream_byte(struct cos_stream *stream, strmoff_t offset);
+
+/**
+ * write the padding which follows stream data
+ *
+ * \param end The end of the stream data which must have STREAM_PADDING bytes
+ *            allocated after it.
+ */
+static inline void stream_pad(uint8_t *end)
+{
+    unsigned int idx;
+
+    end[0] = '\n';
+    for (idx = 1; idx < STREAM_PADDING; idx++) {
+        end[idx] = STREAM_SENTINEL;
+    }
+}
+
 static inline uint8_t
 stream_byte(struct cos_stream *stream, strmoff_t offset)
 {
-    return *(stream->data + offset);
+    if (stream->source == NULL) {
+        return *(stream->data + offset);
+    }
+    if ((offset - stream->window_offset) < stream->window_length) {
+        return *(stream->data + (offset - stream->window_offset));
+    }
+    return nspdf__source_stream_byte(stream, offset);
 }
 
 #endif
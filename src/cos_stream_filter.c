@@ -13,12 +13,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include <zlib.h>
+#include <libwapcaplet/libwapcaplet.h>
 
 #include <nspdf/errors.h>
 
 #include "cos_object.h"
 #include "pdf_doc.h"
+#include "atom.h"
 
 static nspdferror
 cos_stream_inflate(struct nspdf_doc *doc, struct cos_stream **stream_out)
@@ -27,10 +30,14 @@ cos_stream_inflate(struct nspdf_doc *doc, struct cos_stream **stream_out)
     z_stream strm;
     struct cos_stream *stream_in;
     struct cos_stream *stream_res;
+    strmoff_t remaining; /* input not yet passed to zlib */
 
     stream_in = *stream_out;
 
     stream_res = calloc(1, sizeof(struct cos_stream));
+    if (stream_res == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
 
     //printf("inflating from %d bytes\n", stream_in->length);
 
@@ -42,17 +49,28 @@ cos_stream_inflate(struct nspdf_doc *doc, struct cos_stream **stream_out)
 
     ret = inflateInit(&strm);
     if (ret != Z_OK) {
+        free(stream_res);
         return NSPDFERROR_NOTFOUND;
     }
 
     strm.next_in = (void *)stream_in->data;
-    strm.avail_in = stream_in->length;
+    remaining = stream_in->length;
 
     do {
         int64_t available; /* available buffer space for decompression */
+
+        /* zlib lengths are limited to unsigned int so feed large input in
+         * sections
+         */
+        if ((strm.avail_in == 0) && (remaining > 0)) {
+            strm.avail_in = (remaining > UINT_MAX) ? UINT_MAX : remaining;
+            remaining -= strm.avail_in;
+        }
+
         available = stream_res->alloc - stream_res->length;
 
-        if (available < (strm.avail_in << 1)) {
+        if ((available == 0) ||
+            (available < ((int64_t)strm.avail_in << 1))) {
             uint8_t *newdata;
             size_t newlength;
 
@@ -72,13 +90,25 @@ cos_stream_inflate(struct nspdf_doc *doc, struct cos_stream **stream_out)
             available = stream_res->alloc - stream_res->length;
         }
 
+        if (available > UINT_MAX) {
+            available = UINT_MAX;
+        }
         strm.avail_out = available;
         strm.next_out = (void*)(stream_res->data + stream_res->length);
         ret = inflate(&strm, Z_NO_FLUSH);
-        /** \todo check zlib return code */
 
         stream_res->length += (available - strm.avail_out);
 
+        if ((ret != Z_OK) && (ret != Z_STREAM_END)) {
+            /* corrupt data or input truncated before the end of the
+             * compressed stream
+             */
+            free((void *)stream_res->data);
+            free(stream_res);
+            inflateEnd(&strm);
+            return NSPDFERROR_FORMAT;
+        }
+
     } while (ret != Z_STREAM_END);
 
     //printf("allocated %d\n", stream_res->alloc);
@@ -87,6 +117,23 @@ cos_stream_inflate(struct nspdf_doc *doc, struct cos_stream **stream_out)
 
     inflateEnd(&strm);
 
+    /* ensure there is space for the padding */
+    if ((stream_res->alloc - stream_res->length) < STREAM_PADDING) {
+        uint8_t *newdata;
+        size_t newlength;
+
+        newlength = stream_res->length + STREAM_PADDING;
+        newdata = realloc((void *)stream_res->data, newlength);
+        if (newdata == NULL) {
+            free((void *)stream_res->data);
+            free(stream_res);
+            return NSPDFERROR_NOMEM;
+        }
+        stream_res->data = newdata;
+        stream_res->alloc = newlength;
+    }
+    stream_pad((uint8_t *)stream_res->data + stream_res->length);
+
     if (stream_in->alloc != 0) {
         free((void*)stream_in->data);
     }
@@ -99,14 +146,14 @@ cos_stream_inflate(struct nspdf_doc *doc, struct cos_stream **stream_out)
 
 nspdferror
 nspdf__cos_stream_filter(struct nspdf_doc *doc,
-                         const char *filter_name,
+                         lwc_string *filter_name,
                          struct cos_stream **stream_out)
 {
     nspdferror res;
 
     //printf("applying filter %s\n", filter_name);
     /** \todo implement all the other mandantory stream filters */
-    if (strcmp(filter_name, "FlateDecode") == 0) {
+    if (filter_name == nspdf__atom_FlateDecode) {
         res = cos_stream_inflate(doc, stream_out);
     } else {
         res = NSPDFERROR_NOTFOUND;
@@ -13,6 +13,11 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <nspdf/document.h>
 
@@ -21,6 +26,11 @@
 #include "cos_object.h"
 #include "xref.h"
 #include "pdf_doc.h"
+#include "linearized.h"
+#include "source.h"
+#include "arena.h"
+#include "scratch.h"
+#include "atom.h"
 
 /*
  * And you may find yourself
@@ -40,16 +50,28 @@
 
 #define SLEN(x) (sizeof((x)) - 1)
 
-/* byte data acessory, allows for more complex buffer handling in future */
-#define DOC_BYTE(doc, offset) (doc->start[(offset)])
+/* byte data accessor, goes through the stream so byte sources are paged */
+#define DOC_BYTE(doc, offset) stream_byte(doc->stream, (offset))
 
 #define STARTXREF_TOK "startxref"
+#define TRAILER_TOK "trailer"
+#define EOF_TOK "%%EOF"
+#define HEADER_TOK "%PDF-1."
+
+/* Number of bytes from the start of input the header may be found within */
+#define HEADER_SEARCH_SIZE 1024
 
 /* Number of bytes to search back from file end to find xref start token,
  * convention says 1024 bytes
  */
 #define STARTXREF_SEARCH_SIZE 1024
 
+/* minimum allocation for progressively appended document data */
+#define APPEND_ALLOC_MIN (64 * 1024)
+
+/* initial number of slots in the set of decoded cross reference sections */
+#define XREF_SECTIONS_INITIAL 16
+
 
 /**
  * finds the startxref marker at the end of input
@@ -57,32 +79,25 @@
 static nspdferror
 find_startxref(struct nspdf_doc *doc, strmoff_t *offset_out)
 {
-    strmoff_t offset; /* offset of characters being considered for startxref */
-    unsigned int earliest; /* earliest offset to serch for startxref */
-
-    offset = doc->length - SLEN(STARTXREF_TOK);
+    nspdferror res;
+    strmoff_t earliest; /* earliest offset to serch for startxref */
 
-    if (doc->length < STARTXREF_SEARCH_SIZE) {
+    if (doc->stream->length < STARTXREF_SEARCH_SIZE) {
         earliest = 0;
     } else {
-        earliest = doc->length - STARTXREF_SEARCH_SIZE;
-    }
-
-    for (;offset > earliest; offset--) {
-        if ((DOC_BYTE(doc, offset    ) == 's') &&
-            (DOC_BYTE(doc, offset + 1) == 't') &&
-            (DOC_BYTE(doc, offset + 2) == 'a') &&
-            (DOC_BYTE(doc, offset + 3) == 'r') &&
-            (DOC_BYTE(doc, offset + 4) == 't') &&
-            (DOC_BYTE(doc, offset + 5) == 'x') &&
-            (DOC_BYTE(doc, offset + 6) == 'r') &&
-            (DOC_BYTE(doc, offset + 7) == 'e') &&
-            (DOC_BYTE(doc, offset + 8) == 'f')) {
-            *offset_out = offset;
-            return NSPDFERROR_OK;
-        }
+        earliest = doc->stream->length - STARTXREF_SEARCH_SIZE;
     }
-    return NSPDFERROR_SYNTAX;
+
+    res = nspdf__stream_rfind(doc->stream,
+                              earliest,
+                              doc->stream->length,
+                              STARTXREF_TOK,
+                              SLEN(STARTXREF_TOK),
+                              offset_out);
+    if (res != NSPDFERROR_OK) {
+        return NSPDFERROR_SYNTAX;
+    }
+    return NSPDFERROR_OK;
 }
 
 
@@ -92,7 +107,7 @@ find_startxref(struct nspdf_doc *doc, strmoff_t *offset_out)
 static nspdferror
 decode_startxref(struct nspdf_doc *doc,
                  strmoff_t *offset_out,
-                 unsigned int *start_xref_out)
+                 strmoff_t *start_xref_out)
 {
     strmoff_t offset; /* offset of characters being considered for startxref */
     uint64_t start_xref;
@@ -149,21 +164,18 @@ decode_startxref(struct nspdf_doc *doc,
  */
 static nspdferror find_trailer(struct nspdf_doc *doc, strmoff_t *offset_out)
 {
-    strmoff_t offset; /* offset of characters being considered for trailer */
-
-    for (offset = *offset_out;offset < doc->length; offset++) {
-        if ((DOC_BYTE(doc, offset    ) == 't') &&
-            (DOC_BYTE(doc, offset + 1) == 'r') &&
-            (DOC_BYTE(doc, offset + 2) == 'a') &&
-            (DOC_BYTE(doc, offset + 3) == 'i') &&
-            (DOC_BYTE(doc, offset + 4) == 'l') &&
-            (DOC_BYTE(doc, offset + 5) == 'e') &&
-            (DOC_BYTE(doc, offset + 6) == 'r')) {
-            *offset_out = offset;
-            return NSPDFERROR_OK;
-        }
+    nspdferror res;
+
+    res = nspdf__stream_find(doc->stream,
+                             *offset_out,
+                             doc->stream->length,
+                             TRAILER_TOK,
+                             SLEN(TRAILER_TOK),
+                             offset_out);
+    if (res != NSPDFERROR_OK) {
+        return NSPDFERROR_SYNTAX;
     }
-    return NSPDFERROR_SYNTAX;
+    return NSPDFERROR_OK;
 }
 
 
@@ -211,101 +223,332 @@ decode_trailer(struct nspdf_doc *doc,
 
 
 /**
- * recursively parse trailers and xref tables
+ * extract the document entries from the most recent trailer
+ *
+ * creates a cross reference table large enough for the trailer Size and takes
+ *  ownership of the Root, Encrypt, Info and ID entries.
  */
 static nspdferror
-decode_xref_trailer(struct nspdf_doc *doc, unsigned int xref_offset)
+decode_trailer_entries(struct nspdf_doc *doc, struct cos_object *trailer)
 {
     nspdferror res;
-    strmoff_t offset; /* the current data offset */
-    unsigned int startxref; /* the value of the startxref field */
-    struct cos_object *trailer; /* the current trailer */
-    int64_t prev;
+    int64_t size;
 
-    offset = xref_offset;
+    /* extract Size from trailer and create xref table large enough */
+    res = cos_get_dictionary_int(doc, trailer, nspdf__atom_Size, &size);
+    if (res != NSPDFERROR_OK) {
+        printf("trailer has no integer Size value\n");
+        return res;
+    }
+
+    res = cos_extract_dictionary_value(NULL,
+                                       trailer,
+                                       nspdf__atom_Root,
+                                       &doc->root);
+    if (res != NSPDFERROR_OK) {
+        printf("no Root!\n");
+        return res;
+    }
 
-    res = find_trailer(doc, &offset);
+    res = nspdf__xref_allocate(doc, size);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    res = cos_extract_dictionary_value(NULL,
+                                       trailer,
+                                       nspdf__atom_Encrypt,
+                                       &doc->encrypt);
+    if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_NOTFOUND)) {
+        return res;
+    }
+
+    res = cos_extract_dictionary_value(NULL,
+                                       trailer,
+                                       nspdf__atom_Info,
+                                       &doc->info);
+    if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_NOTFOUND)) {
+        return res;
+    }
+
+    res = cos_extract_dictionary_value(NULL,
+                                       trailer,
+                                       nspdf__atom_ID,
+                                       &doc->id);
+    if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_NOTFOUND)) {
+        return res;
+    }
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * decode the trailer of a cross reference section
+ *
+ * A classic cross reference table is followed by its trailer while the
+ *  dictionary of a cross reference stream is the trailer of its section.
+ *
+ * \param doc The document.
+ * \param offset_out The offset of the cross reference section, updated to the
+ *                   offset following the trailer.
+ * \param trailer_out The trailer dictionary.
+ * \param stream_out Set true if the section is a cross reference stream.
+ */
+static nspdferror
+decode_section_trailer(struct nspdf_doc *doc,
+                       strmoff_t *offset_out,
+                       struct cos_object **trailer_out,
+                       bool *stream_out)
+{
+    nspdferror res;
+
+    if ((DOC_BYTE(doc, *offset_out    ) != 'x') ||
+        (DOC_BYTE(doc, *offset_out + 1) != 'r') ||
+        (DOC_BYTE(doc, *offset_out + 2) != 'e') ||
+        (DOC_BYTE(doc, *offset_out + 3) != 'f')) {
+        *stream_out = true;
+        return nspdf__xref_parse_stream_dictionary(doc,
+                                                   doc->stream,
+                                                   offset_out,
+                                                   trailer_out);
+    }
+    *stream_out = false;
+
+    res = find_trailer(doc, offset_out);
     if (res != NSPDFERROR_OK) {
         printf("failed to find last trailer\n");
         return res;
     }
 
-    res = decode_trailer(doc, &offset, &trailer);
+    res = decode_trailer(doc, offset_out, trailer_out);
     if (res != NSPDFERROR_OK) {
         printf("failed to decode trailer\n");
         return res;
     }
 
-    res = decode_startxref(doc, &offset, &startxref);
-    if (res != NSPDFERROR_OK) {
-        printf("failed to decode startxref\n");
-        goto decode_xref_trailer_failed;
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * slot of an offset in the set of decoded cross reference sections
+ *
+ * The set must have been allocated.
+ *
+ * \return The slot holding the offset or the empty slot it would be added to.
+ */
+static inline strmoff_t *
+xref_section_slot(struct nspdf_doc *doc, strmoff_t offset)
+{
+    uint32_t mask;
+    uint32_t idx;
+
+    mask = doc->xref_section_alloc - 1;
+    idx = ((uint32_t)(offset ^ (offset >> 32)) * 0x9e3779b1U) & mask;
+    while ((doc->xref_sections[idx] != 0) &&
+           (doc->xref_sections[idx] != offset)) {
+        idx = (idx + 1) & mask;
     }
 
-    if (startxref != xref_offset) {
-        printf("startxref and Prev value disagree\n");
+    return &doc->xref_sections[idx];
+}
+
+
+/**
+ * add an offset to the set of decoded cross reference sections
+ *
+ * The set is doubled in size when it becomes half full.
+ */
+static nspdferror xref_section_record(struct nspdf_doc *doc, strmoff_t offset)
+{
+    strmoff_t *sections; /* the sections before the set is grown */
+    strmoff_t *slot;
+    unsigned int alloc; /* the size of the set before it is grown */
+    unsigned int idx;
+
+    if (offset == 0) {
+        /* zero marks unused slots and is never a section */
+        return NSPDFERROR_OK;
     }
 
-    if (doc->xref_table == NULL) {
-        /* extract Size from trailer and create xref table large enough */
-        int64_t size;
+    if ((doc->xref_section_count + 1) > (doc->xref_section_alloc / 2)) {
+        sections = doc->xref_sections;
+        alloc = doc->xref_section_alloc;
 
-        res = cos_get_dictionary_int(doc, trailer, "Size", &size);
-        if (res != NSPDFERROR_OK) {
-            printf("trailer has no integer Size value\n");
-            goto decode_xref_trailer_failed;
+        doc->xref_section_alloc = alloc * 2;
+        if (doc->xref_section_alloc == 0) {
+            doc->xref_section_alloc = XREF_SECTIONS_INITIAL;
         }
-
-        res = cos_extract_dictionary_value(NULL, trailer, "Root", &doc->root);
-        if (res != NSPDFERROR_OK) {
-            printf("no Root!\n");
-            goto decode_xref_trailer_failed;
+        doc->xref_sections = calloc(doc->xref_section_alloc,
+                                    sizeof(strmoff_t));
+        if (doc->xref_sections == NULL) {
+            doc->xref_sections = sections;
+            doc->xref_section_alloc = alloc;
+            return NSPDFERROR_NOMEM;
         }
 
-        res = nspdf__xref_allocate(doc, size);
-        if (res != NSPDFERROR_OK) {
-            goto decode_xref_trailer_failed;
+        for (idx = 0; idx < alloc; idx++) {
+            if (sections[idx] != 0) {
+                *xref_section_slot(doc, sections[idx]) = sections[idx];
+            }
         }
+        free(sections);
+    }
 
-        res = cos_extract_dictionary_value(NULL, trailer, "Encrypt", &doc->encrypt);
-        if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_NOTFOUND)) {
-            goto decode_xref_trailer_failed;
-        }
+    slot = xref_section_slot(doc, offset);
+    if (*slot == 0) {
+        *slot = offset;
+        doc->xref_section_count++;
+    }
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * decode one cross reference section of the trailer chain
+ *
+ * Sections are decoded from the newest so entries from older sections never
+ *  replace those already present. Sections may be classic tables or cross
+ *  reference streams. The stream referenced by the XRefStm entry of a hybrid
+ *  table trailer is decoded after the table so the table entries take
+ *  precedence.
+ *
+ * The Prev entry of the trailer becomes the next section of the chain to be
+ *  decoded.
+ */
+static nspdferror
+decode_xref_section(struct nspdf_doc *doc, strmoff_t xref_offset)
+{
+    nspdferror res;
+    strmoff_t offset; /* the current data offset */
+    strmoff_t startxref; /* the value of the startxref field */
+    struct cos_object *trailer;
+    int64_t prev;
+    int64_t xrefstm = 0;
+    bool stream;
 
-        res = cos_extract_dictionary_value(NULL, trailer, "Info", &doc->info);
-        if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_NOTFOUND)) {
-            goto decode_xref_trailer_failed;
+    /* lookups made while the section is decoded must not follow the chain */
+    doc->xref_prev = 0;
+
+    offset = xref_offset;
+    res = decode_section_trailer(doc, &offset, &trailer, &stream);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    if (!stream) {
+        res = decode_startxref(doc, &offset, &startxref);
+        if (res != NSPDFERROR_OK) {
+            printf("failed to decode startxref\n");
+            cos_free_object(trailer);
+            return res;
         }
 
-        res = cos_extract_dictionary_value(NULL, trailer, "ID", &doc->id);
-        if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_NOTFOUND)) {
-            goto decode_xref_trailer_failed;
+        if ((startxref != xref_offset) && (doc->linear == NULL)) {
+            /* linearized documents trailers startxref do not refer to
+             * their own cross reference sections
+             */
+            printf("startxref and Prev value disagree\n");
         }
 
+        res = cos_get_dictionary_int(doc,
+                                     trailer,
+                                     nspdf__atom_XRefStm,
+                                     &xrefstm);
+        if (res != NSPDFERROR_OK) {
+            xrefstm = 0;
+        }
     }
 
-    /* check for prev ID key in trailer and recurse call if present */
-    res = cos_get_dictionary_int(doc, trailer, "Prev", &prev);
-    if (res == NSPDFERROR_OK) {
-        res = decode_xref_trailer(doc, prev);
+    if (doc->xref_table == NULL) {
+        res = decode_trailer_entries(doc, trailer);
         if (res != NSPDFERROR_OK) {
-            goto decode_xref_trailer_failed;
+            cos_free_object(trailer);
+            return res;
         }
     }
 
-    offset = xref_offset;
-    /** @todo deal with XrefStm (number) in trailer */
+    /* check for prev ID key in trailer */
+    res = cos_get_dictionary_int(doc, trailer, nspdf__atom_Prev, &prev);
+    cos_free_object(trailer);
+    if (res != NSPDFERROR_OK) {
+        prev = 0;
+    } else if (prev < 0) {
+        return NSPDFERROR_RANGE;
+    }
 
+    offset = xref_offset;
     res = nspdf__xref_parse(doc, doc->stream, &offset);
     if (res != NSPDFERROR_OK) {
         printf("failed to decode xref table\n");
-        goto decode_xref_trailer_failed;
+        return res;
     }
 
-decode_xref_trailer_failed:
-    cos_free_object(trailer);
+    if (xrefstm > 0) {
+        offset = xrefstm;
+        res = nspdf__xref_parse(doc, doc->stream, &offset);
+        if (res != NSPDFERROR_OK) {
+            printf("failed to decode hybrid xref stream\n");
+            return res;
+        }
+    }
 
-    return res;
+    /* record the section so a chain looping back to it is detected */
+    res = xref_section_record(doc, xref_offset);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    doc->xref_prev = prev;
+
+    return NSPDFERROR_OK;
+}
+
+
+/* exported interface documented in pdf_doc.h */
+nspdferror nspdf__decode_xref_prev(struct nspdf_doc *doc)
+{
+    nspdferror res;
+    strmoff_t xref_offset;
+
+    if (doc->xref_prev_error != NSPDFERROR_OK) {
+        /* the chain stops at a corrupt section */
+        return doc->xref_prev_error;
+    }
+
+    xref_offset = doc->xref_prev;
+    if (xref_offset == 0) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    if ((doc->xref_section_alloc != 0) &&
+        (*xref_section_slot(doc, xref_offset) == xref_offset)) {
+        printf("trailer Prev chain loops\n");
+        doc->xref_prev = 0;
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    res = decode_xref_section(doc, xref_offset);
+    if (res != NSPDFERROR_OK) {
+        /* entries decoded before the failure are kept. A section which has
+         * not been received yet is decoded again by the next lookup which
+         * misses, any other failure is returned without decoding it again.
+         */
+        printf("failed to decode previous xref section (%d)\n", res);
+        doc->xref_prev = xref_offset;
+        if (res == NSPDFERROR_NOTFOUND) {
+            /* the section is corrupt rather than the object absent */
+            res = NSPDFERROR_FORMAT;
+        }
+        if (res != NSPDFERROR_INCOMPLETE) {
+            doc->xref_prev_error = res;
+        }
+        return res;
+    }
+
+    return NSPDFERROR_OK;
 }
 
 
@@ -320,9 +563,11 @@ decode_xref_trailer_failed:
  * contains a startxref token followed by a byte offset into the file of the
  * beginning of the cross reference table followed by a literal '%%EOF'
  *
- * the initial offset is used to walk back down a chain of xref/trailers until
- * the trailer does not contain a Prev entry and decode xref tables forwards to
- * overwrite earlier object entries with later ones.
+ * Only the cross reference section the initial offset refers to is decoded
+ * here. The older sections of the chain of xref/trailers are decoded by
+ * following the Prev entries when an object lookup misses the entries already
+ * present, so documents with many incremental updates open without reading
+ * sections whose objects are never used.
  *
  * It is necessary to search forwards from the xref table to find the trailer
  * block because instead of the Prev entry pointing to the previous trailer
@@ -335,7 +580,7 @@ static nspdferror decode_trailers(struct nspdf_doc *doc)
 {
     nspdferror res;
     strmoff_t offset; /* the current data offset */
-    unsigned int startxref; /* the value of the first startxref field */
+    strmoff_t startxref; /* the value of the first startxref field */
 
     res = find_startxref(doc, &offset);
     if (res != NSPDFERROR_OK) {
@@ -349,8 +594,8 @@ static nspdferror decode_trailers(struct nspdf_doc *doc)
         return res;
     }
 
-    /* recurse down the xref and trailers */
-    return decode_xref_trailer(doc, startxref);
+    /* decode the newest xref and trailer */
+    return decode_xref_section(doc, startxref);
 }
 
 
@@ -360,7 +605,7 @@ static nspdferror decode_catalog(struct nspdf_doc *doc)
 {
     nspdferror res;
     struct cos_object *catalog;
-    const char *type;
+    lwc_string *type;
     struct cos_object *pages;
     unsigned int page_index = 0;
 
@@ -370,11 +615,11 @@ static nspdferror decode_catalog(struct nspdf_doc *doc)
     }
 
     /* Type = Catalog */
-    res = cos_get_dictionary_name(doc, catalog, "Type", &type);
+    res = cos_get_dictionary_name(doc, catalog, nspdf__atom_Type, &type);
     if (res != NSPDFERROR_OK) {
         return res;
     }
-    if (strcmp(type, "Catalog") != 0) {
+    if (type != nspdf__atom_Catalog) {
         return NSPDFERROR_FORMAT;
     }
 
@@ -385,7 +630,7 @@ static nspdferror decode_catalog(struct nspdf_doc *doc)
      * to free in xref table
      */
 
-    res = cos_get_dictionary_dictionary(doc, catalog, "Pages", &pages);
+    res = cos_get_dictionary_dictionary(doc, catalog, nspdf__atom_Pages, &pages);
     if (res != NSPDFERROR_OK) {
         return res;
     }
@@ -402,25 +647,187 @@ static nspdferror decode_catalog(struct nspdf_doc *doc)
     return res;
 }
 
+/**
+ * decode the first page of a linearized document
+ *
+ * Uses the first page cross reference section and trailer which directly
+ *  follow the linearization dictionary. Only the objects required by the
+ *  first page are guaranteed to be present before offset E so the page is
+ *  retrieved directly by object number instead of walking the page tree.
+ */
+static nspdferror decode_first_page(struct nspdf_doc *doc)
+{
+    nspdferror res;
+    struct nspdf_linearized *linear = doc->linear;
+    strmoff_t offset;
+    struct cos_object *trailer;
+    struct cos_object *catalog;
+    lwc_string *type;
+    struct cos_object page_ref_obj;
+    struct cos_object *page;
+    bool stream;
+
+    if (doc->stream->length < linear->first_page_end) {
+        return NSPDFERROR_INCOMPLETE;
+    }
+
+    offset = linear->xref_offset;
+
+    res = decode_section_trailer(doc, &offset, &trailer, &stream);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    res = decode_trailer_entries(doc, trailer);
+    cos_free_object(trailer);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    offset = linear->xref_offset;
+    res = nspdf__xref_parse(doc, doc->stream, &offset);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    res = cos_get_dictionary(doc, doc->root, &catalog);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    res = cos_get_dictionary_name(doc, catalog, nspdf__atom_Type, &type);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    if (type != nspdf__atom_Catalog) {
+        return NSPDFERROR_FORMAT;
+    }
+
+    /* first page object */
+    page_ref_obj.type = COS_TYPE_REFERENCE;
+    page_ref_obj.arena = false;
+    page_ref_obj.u.reference.id = linear->first_page_object;
+    page_ref_obj.u.reference.generation = 0;
+
+    res = cos_get_dictionary(doc, &page_ref_obj, &page);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    return nspdf__decode_first_page(doc, page, linear->page_count);
+}
+
 /* exported interface documented in nspdf/document.h */
 nspdferror nspdf_document_create(struct nspdf_doc **doc_out)
 {
     struct nspdf_doc *doc;
+    nspdferror res;
+
     doc = calloc(1, sizeof(struct nspdf_doc));
     if (doc == NULL) {
         return NSPDFERROR_NOMEM;
     }
 
+    res = nspdf__atom_init();
+    if (res != NSPDFERROR_OK) {
+        free(doc);
+        return res;
+    }
+
+    res = nspdf__scratch_create(&doc->scratch);
+    if (res != NSPDFERROR_OK) {
+        nspdf__atom_fini();
+        free(doc);
+        return res;
+    }
+
+    doc->max_depth = NSPDF_DEFAULT_MAX_DEPTH;
+
     *doc_out = doc;
 
     return NSPDFERROR_OK;
 }
 
+/* exported interface documented in nspdf/document.h */
+nspdferror
+nspdf_document_set_max_depth(struct nspdf_doc *doc, unsigned int max_depth)
+{
+    if (max_depth == 0) {
+        max_depth = NSPDF_DEFAULT_MAX_DEPTH;
+    }
+    doc->max_depth = max_depth;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * discard all state decoded by a previous parse of the document
+ */
+static nspdferror reset_document(struct nspdf_doc *doc)
+{
+    nspdf__free_page_table(doc);
+    nspdf__xref_free(doc);
+    nspdf__linearized_free(doc);
+
+    free(doc->xref_sections);
+    doc->xref_sections = NULL;
+    doc->xref_section_count = 0;
+    doc->xref_section_alloc = 0;
+    doc->xref_prev = 0;
+    doc->xref_prev_error = NSPDFERROR_OK;
+
+    if (doc->root != NULL) {
+        cos_free_object(doc->root);
+        doc->root = NULL;
+    }
+    if (doc->encrypt != NULL) {
+        cos_free_object(doc->encrypt);
+        doc->encrypt = NULL;
+    }
+    if (doc->info != NULL) {
+        cos_free_object(doc->info);
+        doc->info = NULL;
+    }
+    if (doc->id != NULL) {
+        cos_free_object(doc->id);
+        doc->id = NULL;
+    }
+
+    /* all objects parsed from the input are released together */
+    if (doc->arena != NULL) {
+        nspdf__arena_destroy(doc->arena);
+        doc->arena = NULL;
+    }
+    if (doc->stream != NULL) {
+        doc->stream->arena = NULL;
+    }
+
+    doc->ready = false;
+
+    return NSPDFERROR_OK;
+}
+
 /* exported interface documented in nspdf/document.h */
 nspdferror nspdf_document_destroy(struct nspdf_doc *doc)
 {
+    reset_document(doc);
+
+    if (doc->map != NULL) {
+        munmap(doc->map, doc->map_length);
+    }
+
+    if (doc->source != NULL) {
+        nspdf__source_destroy(doc->source);
+    }
+
+    nspdf__scratch_destroy(doc->scratch);
+
+    free(doc->buffer);
+    free(doc->stream);
     free(doc);
 
+    nspdf__atom_fini();
+
     return NSPDFERROR_OK;
 }
 
@@ -430,60 +837,444 @@ nspdferror nspdf_document_destroy(struct nspdf_doc *doc)
  */
 static nspdferror check_header(struct nspdf_doc *doc)
 {
-    uint64_t offset; /* offset of characters being considered for header */
-    for (offset = 0; offset < 1024; offset++) {
-        if ((DOC_BYTE(doc, offset) == '%') &&
-            (DOC_BYTE(doc, offset + 1) == 'P') &&
-            (DOC_BYTE(doc, offset + 2) == 'D') &&
-            (DOC_BYTE(doc, offset + 3) == 'F') &&
-            (DOC_BYTE(doc, offset + 4) == '-') &&
-            (DOC_BYTE(doc, offset + 5) == '1') &&
-            (DOC_BYTE(doc, offset + 6) == '.')) {
-            doc->start += offset;
-            doc->length -= offset;
-
-            /* \todo read number for minor */
-            return NSPDFERROR_OK;
-        }
+    nspdferror res;
+
+    res = nspdf__stream_find(doc->stream,
+                             0,
+                             HEADER_SEARCH_SIZE + SLEN(HEADER_TOK),
+                             HEADER_TOK,
+                             SLEN(HEADER_TOK),
+                             &doc->start);
+    if (res != NSPDFERROR_OK) {
+        return NSPDFERROR_NOTFOUND;
     }
-    return NSPDFERROR_NOTFOUND;
+
+    /* \todo read number for minor */
+    return NSPDFERROR_OK;
 }
 
-/* exported interface documented in nspdf/document.h */
-nspdferror
-nspdf_document_parse(struct nspdf_doc *doc,
-                     const uint8_t *buffer,
-                     unsigned int buffer_length)
+/**
+ * create the region objects parsed from the document input are allocated from
+ */
+static nspdferror create_arena(struct nspdf_doc *doc)
 {
     nspdferror res;
 
-    doc->start = buffer;
-    doc->length = buffer_length;
+    if (doc->arena == NULL) {
+        res = nspdf__arena_create(&doc->arena);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+    }
+    doc->stream->arena = doc->arena;
 
-    doc->stream = calloc(1, sizeof(struct cos_stream));
+    return NSPDFERROR_OK;
+}
+
+/**
+ * set the document input stream to an in memory buffer
+ */
+static nspdferror
+set_stream_buffer(struct nspdf_doc *doc,
+                  const uint8_t *buffer,
+                  size_t buffer_length)
+{
     if (doc->stream == NULL) {
-        return NSPDFERROR_NOMEM;
+        doc->stream = calloc(1, sizeof(struct cos_stream));
+        if (doc->stream == NULL) {
+            return NSPDFERROR_NOMEM;
+        }
     }
     doc->stream->data = buffer;
     doc->stream->length = buffer_length;
 
+    return create_arena(doc);
+}
+
+/**
+ * decode the document structure from the input stream
+ *
+ * \param doc The document to decode.
+ * \param complete true if no further data will be available.
+ */
+static nspdferror parse_document(struct nspdf_doc *doc, bool complete)
+{
+    nspdferror res;
+
     res = check_header(doc);
     if (res != 0) {
         printf("header check failed\n");
         return res;
     }
 
-    res = decode_trailers(doc);
+    res = nspdf__linearized_decode(doc, doc->start);
+    if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_NOTFOUND)) {
+        return res;
+    }
+
+    if ((doc->linear != NULL) &&
+        (complete == false) &&
+        (doc->stream->length < doc->linear->length)) {
+        /* linearized document which has not been completely received */
+        res = decode_first_page(doc);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+    } else {
+        res = decode_trailers(doc);
+        if (res != NSPDFERROR_OK) {
+            printf("failed to decode trailers (%d)\n", res);
+            return res;
+        }
+
+        res = decode_catalog(doc);
+        if (res != NSPDFERROR_OK) {
+            printf("failed to decode catalog (%d)\n", res);
+            return res;
+        }
+    }
+
+    if (doc->linear != NULL) {
+        /* page offset hints are optional so any failure is ignored */
+        nspdf__linearized_decode_hints(doc);
+    }
+
+    doc->ready = true;
+
+    return NSPDFERROR_OK;
+}
+
+/* exported interface documented in nspdf/document.h */
+nspdferror
+nspdf_document_parse(struct nspdf_doc *doc,
+                     const uint8_t *buffer,
+                     size_t buffer_length)
+{
+    nspdferror res;
+
+    if ((doc->stream != NULL) || (doc->buffer != NULL)) {
+        /* document already has an input */
+        return NSPDFERROR_SYNTAX;
+    }
+
+    if (buffer_length > (SIZE_MAX - STREAM_PADDING)) {
+        return NSPDFERROR_RANGE;
+    }
+
+    /* the passed buffer cannot be padded so the data is copied */
+    doc->buffer = malloc(buffer_length + STREAM_PADDING);
+    if (doc->buffer == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+    memcpy(doc->buffer, buffer, buffer_length);
+    stream_pad(doc->buffer + buffer_length);
+    doc->buffer_alloc = buffer_length + STREAM_PADDING;
+    doc->buffer_length = buffer_length;
+    doc->buffer_complete = true;
+
+    res = set_stream_buffer(doc, doc->buffer, doc->buffer_length);
     if (res != NSPDFERROR_OK) {
-        printf("failed to decode trailers (%d)\n", res);
         return res;
     }
 
-    res = decode_catalog(doc);
+    return parse_document(doc, true);
+}
+
+
+/**
+ * re-run the document decode over the data appended so far
+ *
+ * Any failure while more data may still arrive is reported as incomplete as
+ *  the trailer, cross reference table or catalog may simply not have been
+ *  received yet.
+ */
+static nspdferror attempt_appended_parse(struct nspdf_doc *doc)
+{
+    nspdferror res;
+
+    reset_document(doc);
+
+    res = set_stream_buffer(doc, doc->buffer, doc->buffer_length);
     if (res != NSPDFERROR_OK) {
-        printf("failed to decode catalog (%d)\n", res);
         return res;
     }
+    doc->buffer_parsed = doc->buffer_length;
 
+    res = parse_document(doc, doc->buffer_complete);
+    if ((res != NSPDFERROR_OK) &&
+        (res != NSPDFERROR_NOMEM) &&
+        (doc->buffer_complete == false)) {
+        res = NSPDFERROR_INCOMPLETE;
+    }
     return res;
 }
+
+/* exported interface documented in nspdf/document.h */
+nspdferror
+nspdf_document_append_data(struct nspdf_doc *doc,
+                           const uint8_t *data,
+                           unsigned int data_length)
+{
+    if ((doc->map != NULL) ||
+        (doc->source != NULL) ||
+        (doc->buffer_complete)) {
+        /* document data is not being supplied progressively */
+        return NSPDFERROR_SYNTAX;
+    }
+
+    if ((doc->buffer_length + data_length + STREAM_PADDING) <
+        doc->buffer_length) {
+        return NSPDFERROR_RANGE;
+    }
+
+    if ((doc->buffer_length + data_length + STREAM_PADDING) >
+        doc->buffer_alloc) {
+        uint8_t *nbuffer;
+        size_t nalloc;
+
+        nalloc = doc->buffer_alloc;
+        if (nalloc < APPEND_ALLOC_MIN) {
+            nalloc = APPEND_ALLOC_MIN;
+        }
+        while (nalloc < (doc->buffer_length + data_length + STREAM_PADDING)) {
+            nalloc = nalloc * 2;
+        }
+
+        nbuffer = realloc(doc->buffer, nalloc);
+        if (nbuffer == NULL) {
+            return NSPDFERROR_NOMEM;
+        }
+        if ((nbuffer != doc->buffer) && (doc->ready)) {
+            /* decoded objects may reference the old buffer */
+            reset_document(doc);
+        }
+        doc->buffer = nbuffer;
+        doc->buffer_alloc = nalloc;
+    }
+
+    memcpy(doc->buffer + doc->buffer_length, data, data_length);
+    doc->buffer_length += data_length;
+    stream_pad(doc->buffer + doc->buffer_length);
+
+    if (doc->ready) {
+        strmoff_t eof_offset;
+
+        /* extend the range of input available to object lookups */
+        doc->stream->length = doc->buffer_length;
+
+        /* an end marker spanning the previous block is found too */
+        eof_offset = doc->buffer_length - data_length;
+        if (eof_offset > (SLEN(EOF_TOK) - 1)) {
+            eof_offset -= SLEN(EOF_TOK) - 1;
+        } else {
+            eof_offset = 0;
+        }
+        if (nspdf__stream_find(doc->stream,
+                               eof_offset,
+                               doc->buffer_length,
+                               EOF_TOK,
+                               SLEN(EOF_TOK),
+                               &eof_offset) == NSPDFERROR_OK) {
+            /* an incremental update has been completed */
+            return attempt_appended_parse(doc);
+        }
+
+        if ((doc->page_table_decoded < doc->page_table_size) &&
+            (doc->linear != NULL) &&
+            (doc->buffer_length >= doc->linear->length)) {
+            /* whole linearized document now available */
+            return attempt_appended_parse(doc);
+        }
+        return NSPDFERROR_OK;
+    }
+
+    return attempt_appended_parse(doc);
+}
+
+/* exported interface documented in nspdf/document.h */
+nspdferror nspdf_document_append_done(struct nspdf_doc *doc)
+{
+    if ((doc->map != NULL) || (doc->source != NULL)) {
+        return NSPDFERROR_SYNTAX;
+    }
+
+    doc->buffer_complete = true;
+
+    if ((doc->ready) &&
+        (doc->page_table_decoded == doc->page_table_size) &&
+        (doc->buffer_parsed == doc->buffer_length)) {
+        /* nothing has been appended since the last decode */
+        return NSPDFERROR_OK;
+    }
+
+    return attempt_appended_parse(doc);
+}
+
+/* exported interface documented in nspdf/document.h */
+nspdferror nspdf_document_ready(struct nspdf_doc *doc)
+{
+    if (doc->ready) {
+        return NSPDFERROR_OK;
+    }
+    return NSPDFERROR_INCOMPLETE;
+}
+
+/* exported interface documented in nspdf/document.h */
+nspdferror
+nspdf_document_open_file(struct nspdf_doc *doc, const char *filename)
+{
+    nspdferror res;
+    int fd;
+    struct stat st;
+    void *map;
+    size_t map_length;
+
+    if ((doc->stream != NULL) || (doc->buffer != NULL)) {
+        /* document already has an input */
+        return NSPDFERROR_SYNTAX;
+    }
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        return NSPDFERROR_SIZE;
+    }
+
+    if ((uint64_t)st.st_size > (SIZE_MAX - STREAM_PADDING)) {
+        /* larger than the address space can map */
+        close(fd);
+        return NSPDFERROR_RANGE;
+    }
+
+    /* reserve space for the file and the stream padding then map the file
+     * over the start of the reservation. The padding is written through the
+     * private mapping so only the last page of the file is copied.
+     */
+    map_length = st.st_size + STREAM_PADDING;
+    map = mmap(NULL,
+               map_length,
+               PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS,
+               -1,
+               0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NSPDFERROR_NOMEM;
+    }
+
+    if (mmap(map,
+             st.st_size,
+             PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_FIXED,
+             fd,
+             0) == MAP_FAILED) {
+        close(fd);
+        munmap(map, map_length);
+        return NSPDFERROR_NOMEM;
+    }
+    close(fd); /* the mapping holds its own reference to the file */
+
+    stream_pad((uint8_t *)map + st.st_size);
+    if (mprotect(map, map_length, PROT_READ) != 0) {
+        munmap(map, map_length);
+        return NSPDFERROR_NOMEM;
+    }
+
+    /* access is mostly scattered seeks to the trailer, xref and objects */
+    posix_madvise(map, st.st_size, POSIX_MADV_RANDOM);
+
+    doc->map = map;
+    doc->map_length = map_length;
+
+    res = set_stream_buffer(doc, map, st.st_size);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    return parse_document(doc, true);
+}
+
+/* exported interface documented in nspdf/document.h */
+nspdferror
+nspdf_document_open_source(struct nspdf_doc *doc,
+                           nspdf_source_fetch_fn fetch,
+                           void *ctx,
+                           uint64_t length,
+                           size_t chunk_size)
+{
+    nspdferror res;
+
+    if ((doc->stream != NULL) || (doc->buffer != NULL)) {
+        /* document already has an input */
+        return NSPDFERROR_SYNTAX;
+    }
+
+    res = nspdf__source_create(fetch, ctx, length, chunk_size, &doc->source);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    doc->stream = calloc(1, sizeof(struct cos_stream));
+    if (doc->stream == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+    doc->stream->length = length;
+    doc->stream->source = doc->source;
+
+    res = create_arena(doc);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    res = parse_document(doc, true);
+    if ((res != NSPDFERROR_OK) &&
+        (doc->source->error != NSPDFERROR_OK)) {
+        /* report the underlying fetch failure instead of the parse error */
+        res = doc->source->error;
+    }
+
+    return res;
+}
+
+/* exported interface documented in nspdf/document.h */
+nspdferror
+nspdf_document_source_stats(struct nspdf_doc *doc,
+                            uint64_t *hits_out,
+                            uint64_t *misses_out)
+{
+    if (doc->source == NULL) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    *hits_out = doc->source->hits;
+    *misses_out = doc->source->misses;
+
+    return NSPDFERROR_OK;
+}
+
+/* exported interface documented in nspdf/document.h */
+nspdferror
+nspdf_document_arena_stats(struct nspdf_doc *doc,
+                           uint64_t *allocs_out,
+                           uint64_t *bytes_out,
+                           uint64_t *blocks_out)
+{
+    if (doc->arena == NULL) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    *allocs_out = doc->arena->allocs;
+    *bytes_out = doc->arena->bytes;
+    *blocks_out = doc->arena->blocks;
+
+    return NSPDFERROR_OK;
+}
@@ -0,0 +1,411 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <nspdf/errors.h>
+#include <nspdf/page.h>
+
+#include "cos_parse.h"
+#include "byte_class.h"
+#include "cos_object.h"
+#include "pdf_doc.h"
+#include "xref.h"
+#include "linearized.h"
+#include "atom.h"
+
+/**
+ * Number of bytes from the file start the linearization dictionary must be
+ *  completely contained within.
+ */
+#define LINEARIZED_SEARCH_SIZE 1024
+
+/** number of bytes in the page offset hint table header */
+#define PAGE_OFFSET_HEADER_SIZE 36
+
+/**
+ * bit stream reader for hint tables
+ */
+struct hint_bits {
+    const uint8_t *data;
+    strmoff_t length;
+    uint64_t bit; /**< current bit offset */
+};
+
+static nspdferror
+read_bits(struct hint_bits *bits, unsigned int count, uint64_t *value_out)
+{
+    uint64_t value = 0;
+
+    if (count > 32) {
+        return NSPDFERROR_RANGE;
+    }
+
+    if ((bits->bit + count) > ((uint64_t)bits->length * 8)) {
+        return NSPDFERROR_SIZE;
+    }
+
+    while (count > 0) {
+        value = (value << 1) |
+            ((bits->data[bits->bit >> 3] >> (7 - (bits->bit & 7))) & 1);
+        bits->bit++;
+        count--;
+    }
+
+    *value_out = value;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * move a bit stream reader to the next byte boundary
+ */
+static inline void align_bits(struct hint_bits *bits)
+{
+    bits->bit = (bits->bit + 7) & ~((uint64_t)7);
+}
+
+/**
+ * check the linearization dictionary is entirely within the search area
+ */
+static bool
+find_endobj(struct cos_stream *stream, strmoff_t offset)
+{
+    strmoff_t end;
+
+    end = offset + LINEARIZED_SEARCH_SIZE;
+    if (end > stream->length) {
+        end = stream->length;
+    }
+
+    for (; (offset + 6) <= end; offset++) {
+        if ((stream_byte(stream, offset    ) == 'e') &&
+            (stream_byte(stream, offset + 1) == 'n') &&
+            (stream_byte(stream, offset + 2) == 'd') &&
+            (stream_byte(stream, offset + 3) == 'o') &&
+            (stream_byte(stream, offset + 4) == 'b') &&
+            (stream_byte(stream, offset + 5) == 'j')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * get an integer value from the linearization dictionary
+ */
+static nspdferror
+get_param(struct cos_object *dict, lwc_string *key, int64_t *value_out)
+{
+    nspdferror res;
+    int64_t value;
+
+    /* all values must be direct objects so no dereferencing */
+    res = cos_get_dictionary_int(NULL, dict, key, &value);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    if (value < 0) {
+        return NSPDFERROR_RANGE;
+    }
+    *value_out = value;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * get an integer value from the hint stream array
+ */
+static nspdferror
+get_hint_value(struct cos_object *hint, unsigned int index, int64_t *value_out)
+{
+    nspdferror res;
+    struct cos_object *value;
+
+    res = cos_get_array_value(NULL, hint, index, &value);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    res = cos_get_int(NULL, value, value_out);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    if (*value_out < 0) {
+        return NSPDFERROR_RANGE;
+    }
+    return NSPDFERROR_OK;
+}
+
+/* exported interface documented in linearized.h */
+nspdferror
+nspdf__linearized_decode(struct nspdf_doc *doc, strmoff_t header_offset)
+{
+    nspdferror res;
+    strmoff_t offset;
+    struct cos_object *lindict;
+    struct cos_object *hint;
+    struct nspdf_linearized *linear;
+    int64_t version;
+    int64_t length;
+    int64_t first_page_object;
+    int64_t first_page_end;
+    int64_t page_count;
+    int64_t hint_offset;
+    int64_t hint_length;
+
+    offset = header_offset;
+
+    /* skip the header line, the following binary marker comment and any
+     * whitespace are skipped as normal
+     */
+    while ((offset < doc->stream->length) &&
+           ((bclass[stream_byte(doc->stream, offset)] & BC_EOLM) == 0)) {
+        offset++;
+    }
+    nspdf__stream_skip_ws(doc->stream, &offset);
+
+    if ((offset >= doc->stream->length) ||
+        ((bclass[stream_byte(doc->stream, offset)] & BC_DCML) == 0)) {
+        /* first object is not an indirect object */
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    if (find_endobj(doc->stream, offset) == false) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    res = cos_parse_object(doc, doc->stream, &offset, &lindict);
+    if (res != NSPDFERROR_OK) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    res = get_param(lindict, nspdf__atom_Linearized, &version);
+    if (res != NSPDFERROR_OK) {
+        cos_free_object(lindict);
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    /* required parameters */
+    res = get_param(lindict, nspdf__atom_L, &length);
+    if (res == NSPDFERROR_OK) {
+        res = get_param(lindict, nspdf__atom_O, &first_page_object);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = get_param(lindict, nspdf__atom_E, &first_page_end);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = get_param(lindict, nspdf__atom_N, &page_count);
+    }
+    if (res == NSPDFERROR_OK) {
+        /* primary hint stream offset and length */
+        res = cos_get_dictionary_array(NULL, lindict, nspdf__atom_H, &hint);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = get_hint_value(hint, 0, &hint_offset);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = get_hint_value(hint, 1, &hint_length);
+    }
+    cos_free_object(lindict);
+    if (res != NSPDFERROR_OK) {
+        /* linearization dictionary is invalid, treat as unlinearized */
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    if ((page_count == 0) || (page_count > UINT32_MAX) ||
+        (first_page_object > UINT32_MAX)) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    linear = calloc(1, sizeof(struct nspdf_linearized));
+    if (linear == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+
+    linear->length = length;
+    linear->hint_offset = hint_offset;
+    linear->hint_length = hint_length;
+    linear->first_page_object = first_page_object;
+    linear->first_page_end = first_page_end;
+    linear->page_count = page_count;
+
+    /* the first page cross reference section directly follows */
+    linear->xref_offset = offset;
+
+    doc->linear = linear;
+
+    return NSPDFERROR_OK;
+}
+
+
+/* exported interface documented in linearized.h */
+nspdferror nspdf__linearized_decode_hints(struct nspdf_doc *doc)
+{
+    nspdferror res;
+    struct nspdf_linearized *linear;
+    struct cos_object *hint_obj;
+    struct cos_stream *hint_stream;
+    struct hint_bits bits;
+    strmoff_t offset;
+    uint64_t min_length; /* least length of a page */
+    uint64_t first_offset; /* location of first page's page object */
+    uint64_t nobjects_bits; /* bits for object count deltas */
+    uint64_t length_bits; /* bits for page length deltas */
+    uint64_t value;
+    uint64_t table_bits; /* bits needed for the per page entries */
+    uint32_t xref_size;
+    unsigned int page;
+
+    linear = doc->linear;
+    if (linear == NULL) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    if (linear->page_offset != NULL) {
+        /* already decoded */
+        return NSPDFERROR_OK;
+    }
+
+    if ((linear->hint_offset + linear->hint_length) > doc->stream->length) {
+        return NSPDFERROR_INCOMPLETE;
+    }
+
+    offset = linear->hint_offset;
+    res = cos_parse_object(doc, doc->stream, &offset, &hint_obj);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    res = cos_get_stream(doc, hint_obj, &hint_stream);
+    if (res != NSPDFERROR_OK) {
+        cos_free_object(hint_obj);
+        return res;
+    }
+
+    bits.data = hint_stream->data;
+    bits.length = hint_stream->length;
+    bits.bit = 0;
+
+    if (hint_stream->length < PAGE_OFFSET_HEADER_SIZE) {
+        cos_free_object(hint_obj);
+        return NSPDFERROR_FORMAT;
+    }
+
+    /* page offset hint table header */
+    read_bits(&bits, 32, &value); /* least number of objects in a page */
+    read_bits(&bits, 32, &first_offset);
+    read_bits(&bits, 16, &nobjects_bits);
+    read_bits(&bits, 32, &min_length);
+    read_bits(&bits, 16, &length_bits);
+    bits.bit = PAGE_OFFSET_HEADER_SIZE * 8; /* remaining header not needed */
+
+    /* every page is a separate object so cannot outnumber the objects */
+    if ((nspdf__xref_size(doc, &xref_size) == NSPDFERROR_OK) &&
+        (linear->page_count >= xref_size)) {
+        cos_free_object(hint_obj);
+        return NSPDFERROR_FORMAT;
+    }
+
+    /* the page count must fit in the table before its arrays are allocated */
+    table_bits = (linear->page_count * nobjects_bits + 7) & ~((uint64_t)7);
+    table_bits += linear->page_count * length_bits;
+    if (table_bits > (bits.length * 8 - bits.bit)) {
+        cos_free_object(hint_obj);
+        return NSPDFERROR_FORMAT;
+    }
+
+    linear->page_offset = calloc(linear->page_count, sizeof(strmoff_t));
+    linear->page_length = calloc(linear->page_count, sizeof(strmoff_t));
+    if ((linear->page_offset == NULL) || (linear->page_length == NULL)) {
+        res = NSPDFERROR_NOMEM;
+        goto decode_hints_error;
+    }
+
+    /* per page entries are stored as item one for all pages then item two for
+     * all pages etc. each item list starting on a byte boundary
+     */
+    for (page = 0; page < linear->page_count; page++) {
+        res = read_bits(&bits, nobjects_bits, &value);
+        if (res != NSPDFERROR_OK) {
+            goto decode_hints_error;
+        }
+    }
+    align_bits(&bits);
+
+    offset = first_offset;
+    for (page = 0; page < linear->page_count; page++) {
+        res = read_bits(&bits, length_bits, &value);
+        if (res != NSPDFERROR_OK) {
+            goto decode_hints_error;
+        }
+        linear->page_length[page] = min_length + value;
+
+        /* hint table offsets are computed as if the hint stream was absent */
+        if (offset >= linear->hint_offset) {
+            linear->page_offset[page] = offset + linear->hint_length;
+        } else {
+            linear->page_offset[page] = offset;
+        }
+        offset += linear->page_length[page];
+    }
+
+    cos_free_object(hint_obj);
+
+    return NSPDFERROR_OK;
+
+decode_hints_error:
+    free(linear->page_offset);
+    free(linear->page_length);
+    linear->page_offset = NULL;
+    linear->page_length = NULL;
+    cos_free_object(hint_obj);
+
+    return res;
+}
+
+
+/* exported interface documented in linearized.h */
+nspdferror nspdf__linearized_free(struct nspdf_doc *doc)
+{
+    if (doc->linear != NULL) {
+        free(doc->linear->page_offset);
+        free(doc->linear->page_length);
+        free(doc->linear);
+        doc->linear = NULL;
+    }
+    return NSPDFERROR_OK;
+}
+
+
+/* exported interface documented in nspdf/page.h */
+nspdferror
+nspdf_get_page_byte_range(struct nspdf_doc *doc,
+                          unsigned int page_number,
+                          uint64_t *offset_out,
+                          uint64_t *length_out)
+{
+    if ((doc->linear == NULL) ||
+        (doc->linear->page_offset == NULL)) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    if (page_number >= doc->linear->page_count) {
+        return NSPDFERROR_RANGE;
+    }
+
+    *offset_out = doc->linear->page_offset[page_number];
+    *length_out = doc->linear->page_length[page_number];
+
+    return NSPDFERROR_OK;
+}
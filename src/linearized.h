@@ -0,0 +1,67 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/**
+ * \file
+ * NetSurf PDF library linearized (fast web view) document handling
+ */
+
+#ifndef NSPDF__LINEARIZED_H_
+#define NSPDF__LINEARIZED_H_
+
+#include "cos_stream.h"
+
+struct nspdf_doc;
+
+/**
+ * linearization parameters and decoded hint tables
+ */
+struct nspdf_linearized {
+    strmoff_t length; /**< length of the entire file (L) */
+    strmoff_t hint_offset; /**< offset of primary hint stream (H) */
+    strmoff_t hint_length; /**< length of primary hint stream (H) */
+    uint64_t first_page_object; /**< object number of first page (O) */
+    strmoff_t first_page_end; /**< offset of end of first page (E) */
+    unsigned int page_count; /**< number of pages in document (N) */
+
+    /** offset of the first page cross reference section */
+    strmoff_t xref_offset;
+
+    /**
+     * page byte ranges from the page offset hint table, NULL if the hint
+     *  stream has not been decoded.
+     */
+    strmoff_t *page_offset;
+    strmoff_t *page_length;
+};
+
+/**
+ * detect and decode the linearization parameter dictionary
+ *
+ * \param doc The document to decode.
+ * \param header_offset The offset of the PDF header comment.
+ * \return NSPDFERROR_OK and doc->linear set if the document is linearized
+ *         else NSPDFERROR_NOTFOUND. A linearization dictionary which is not
+ *         yet completely available is also reported as not found.
+ */
+nspdferror nspdf__linearized_decode(struct nspdf_doc *doc, strmoff_t header_offset);
+
+/**
+ * decode the page offset hint table from the primary hint stream
+ *
+ * requires the cross reference table to be available
+ */
+nspdferror nspdf__linearized_decode_hints(struct nspdf_doc *doc);
+
+/**
+ * free linearization parameters
+ */
+nspdferror nspdf__linearized_free(struct nspdf_doc *doc);
+
+#endif
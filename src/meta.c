@@ -13,30 +13,7 @@
 
 #include "cos_object.h"
 #include "pdf_doc.h"
-
-static nspdferror lwc2nspdferr(lwc_error ret)
-{
-    nspdferror res;
-
-    switch (ret) {
-    case lwc_error_ok:
-        res = NSPDFERROR_OK;
-        break;
-
-    case lwc_error_oom:
-        res = NSPDFERROR_NOMEM;
-        break;
-
-    case lwc_error_range:
-        res = NSPDFERROR_RANGE;
-        break;
-
-    default:
-        res = NSPDFERROR_NOTFOUND;
-        break;
-    }
-    return res;
-}
+#include "atom.h"
 
 nspdferror nspdf_get_title(struct nspdf_doc *doc, struct lwc_string_s **title)
 {
@@ -47,14 +24,17 @@ nspdferror nspdf_get_title(struct nspdf_doc *doc, struct lwc_string_s **title)
         return NSPDFERROR_NOTFOUND;
     }
 
-    res = cos_get_dictionary_string(doc, doc->info, "Title", &cos_title);
+    res = cos_get_dictionary_string(doc,
+                                    doc->info,
+                                    nspdf__atom_Title,
+                                    &cos_title);
     if (res != NSPDFERROR_OK) {
         return res;
     }
 
-    res = lwc2nspdferr(lwc_intern_string((const char *)cos_title->data,
-                                         cos_title->length,
-                                         title));
+    res = nspdf__lwc_error(lwc_intern_string((const char *)cos_title->data,
+                                             cos_title->length,
+                                             title));
 
     return res;
 }
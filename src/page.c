@@ -21,6 +21,8 @@
 #include "cos_content.h"
 #include "cos_object.h"
 #include "pdf_doc.h"
+#include "xref.h"
+#include "atom.h"
 
 /** page entry */
 struct page_table_entry {
@@ -93,6 +95,132 @@ pdf_matrix_multiply(float *a, float *b, float *o)
     return NSPDFERROR_OK;
 }
 
+/**
+ * decode a page object into a page table entry
+ */
+static nspdferror
+decode_page(struct nspdf_doc *doc,
+            struct cos_object *page_node,
+            struct page_table_entry *page)
+{
+    nspdferror res;
+    struct cos_object *rect_array;
+
+    /* required heritable resources */
+    res = cos_heritable_dictionary_dictionary(doc,
+                                              page_node,
+                                              nspdf__atom_Resources,
+                                              &(page->resources));
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    /* required heritable mediabox */
+    res = cos_heritable_dictionary_array(doc,
+                                         page_node,
+                                         nspdf__atom_MediaBox,
+                                         &rect_array);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    res = cos_get_rectangle(doc, rect_array, &page->mediabox);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    /* optional heritable crop box */
+    res = cos_heritable_dictionary_array(doc,
+                                         page_node,
+                                         nspdf__atom_CropBox,
+                                         &rect_array);
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_rectangle(doc, rect_array, &page->cropbox);
+    }
+    if (res != NSPDFERROR_OK) {
+        /* default is mediabox */
+        page->cropbox = page->mediabox;
+    }
+
+    /* optional bleed box */
+    res = cos_get_dictionary_array(doc,
+                                   page_node,
+                                   nspdf__atom_BleedBox,
+                                   &rect_array);
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_rectangle(doc, rect_array, &page->bleedbox);
+    }
+    if (res != NSPDFERROR_OK) {
+        /* default is cropbox */
+        page->bleedbox = page->cropbox;
+    }
+
+    /* optional trim box */
+    res = cos_get_dictionary_array(doc,
+                                   page_node,
+                                   nspdf__atom_TrimBox,
+                                   &rect_array);
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_rectangle(doc, rect_array, &page->trimbox);
+    }
+    if (res != NSPDFERROR_OK) {
+        /* default is cropbox */
+        page->trimbox = page->cropbox;
+    }
+
+    /* optional art box */
+    res = cos_get_dictionary_array(doc,
+                                   page_node,
+                                   nspdf__atom_ArtBox,
+                                   &rect_array);
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_rectangle(doc, rect_array, &page->artbox);
+    }
+    if (res != NSPDFERROR_OK) {
+        /* default is cropbox */
+        page->artbox = page->cropbox;
+    }
+
+    /* optional page contents */
+    res = cos_extract_dictionary_value(doc,
+                                       page_node,
+                                       nspdf__atom_Contents,
+                                       &(page->contents));
+    if ((res != NSPDFERROR_OK) &&
+        (res != NSPDFERROR_NOTFOUND)) {
+        return res;
+    }
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * allocate the page table
+ */
+static nspdferror allocate_page_table(struct nspdf_doc *doc, int64_t count)
+{
+    uint32_t xref_size;
+
+    if (count < 0) {
+        return NSPDFERROR_RANGE;
+    }
+
+    /* every page is a separate object so cannot outnumber the objects */
+    if ((nspdf__xref_size(doc, &xref_size) == NSPDFERROR_OK) &&
+        (count >= xref_size)) {
+        return NSPDFERROR_FORMAT;
+    }
+
+    doc->page_table = calloc(count, sizeof(struct page_table_entry));
+    if (doc->page_table == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+    doc->page_table_size = count;
+    doc->page_table_decoded = 0;
+
+    return NSPDFERROR_OK;
+}
+
 /**
  * recursively decodes a page tree
  */
@@ -102,15 +230,15 @@ nspdf__decode_page_tree(struct nspdf_doc *doc,
                         unsigned int *page_index)
 {
     nspdferror res;
-    const char *type;
+    lwc_string *type;
 
     // Type = Pages
-    res = cos_get_dictionary_name(doc, page_tree_node, "Type", &type);
+    res = cos_get_dictionary_name(doc, page_tree_node, nspdf__atom_Type, &type);
     if (res != NSPDFERROR_OK) {
         return res;
     }
 
-    if (strcmp(type, "Pages") == 0) {
+    if (type == nspdf__atom_Pages) {
         struct cos_object *kids;
         unsigned int kids_size;
         unsigned int kids_index;
@@ -119,19 +247,24 @@ nspdf__decode_page_tree(struct nspdf_doc *doc,
             /* allocate top level page table */
             int64_t count;
 
-            res = cos_get_dictionary_int(doc, page_tree_node, "Count", &count);
+            res = cos_get_dictionary_int(doc,
+                                         page_tree_node,
+                                         nspdf__atom_Count,
+                                         &count);
             if (res != NSPDFERROR_OK) {
                 return res;
             }
 
-            doc->page_table = calloc(count, sizeof(struct page_table_entry));
-            if (doc->page_table == NULL) {
-                return NSPDFERROR_NOMEM;
+            res = allocate_page_table(doc, count);
+            if (res != NSPDFERROR_OK) {
+                return res;
             }
-            doc->page_table_size = count;
         }
 
-        res = cos_get_dictionary_array(doc, page_tree_node, "Kids", &kids);
+        res = cos_get_dictionary_array(doc,
+                                       page_tree_node,
+                                       nspdf__atom_Kids,
+                                       &kids);
         if (res != NSPDFERROR_OK) {
             return res;
         }
@@ -155,113 +288,78 @@ nspdf__decode_page_tree(struct nspdf_doc *doc,
             }
         }
 
-    } else if (strcmp(type, "Page") == 0) {
-        struct page_table_entry *page;
-        struct cos_object *rect_array;
-
-        page = doc->page_table + (*page_index);
-
-        /* required heritable resources */
-        res = cos_heritable_dictionary_dictionary(doc,
-                                                  page_tree_node,
-                                                  "Resources",
-                                                  &(page->resources));
-        if (res != NSPDFERROR_OK) {
-            return res;
+    } else if (type == nspdf__atom_Page) {
+        if ((doc->page_table == NULL) ||
+            ((*page_index) >= doc->page_table_size)) {
+            /* more pages in the tree than the Count declared */
+            return NSPDFERROR_FORMAT;
         }
 
-        /* required heritable mediabox */
-        res = cos_heritable_dictionary_array(doc,
-                                             page_tree_node,
-                                             "MediaBox",
-                                             &rect_array);
+        res = decode_page(doc, page_tree_node, doc->page_table + (*page_index));
         if (res != NSPDFERROR_OK) {
             return res;
         }
 
-        res = cos_get_rectangle(doc, rect_array, &page->mediabox);
-        if (res != NSPDFERROR_OK) {
-            return res;
-        }
+        (*page_index)++;
+        doc->page_table_decoded = *page_index;
+    } else {
+        res = NSPDFERROR_FORMAT;
+    }
+    return res;
+}
 
-        /* optional heritable crop box */
-        res = cos_heritable_dictionary_array(doc,
-                                             page_tree_node,
-                                             "CropBox",
-                                             &rect_array);
-        if (res == NSPDFERROR_OK) {
-            res = cos_get_rectangle(doc, rect_array, &page->cropbox);
-        }
-        if (res != NSPDFERROR_OK) {
-            /* default is mediabox */
-            page->cropbox = page->mediabox;
-        }
+/* exported interface documented in pdf_doc.h */
+nspdferror
+nspdf__decode_first_page(struct nspdf_doc *doc,
+                         struct cos_object *page_node,
+                         unsigned int page_count)
+{
+    nspdferror res;
 
-        /* optional bleed box */
-        res = cos_get_dictionary_array(doc,
-                                       page_tree_node,
-                                       "BleedBox",
-                                       &rect_array);
-        if (res == NSPDFERROR_OK) {
-            res = cos_get_rectangle(doc, rect_array, &page->bleedbox);
-        }
-        if (res != NSPDFERROR_OK) {
-            /* default is cropbox */
-            page->bleedbox = page->cropbox;
-        }
+    if (page_count == 0) {
+        return NSPDFERROR_RANGE;
+    }
 
-        /* optional trim box */
-        res = cos_get_dictionary_array(doc,
-                                       page_tree_node,
-                                       "TrimBox",
-                                       &rect_array);
-        if (res == NSPDFERROR_OK) {
-            res = cos_get_rectangle(doc, rect_array, &page->trimbox);
-        }
-        if (res != NSPDFERROR_OK) {
-            /* default is cropbox */
-            page->trimbox = page->cropbox;
-        }
+    res = allocate_page_table(doc, page_count);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
 
-        /* optional art box */
-        res = cos_get_dictionary_array(doc,
-                                       page_tree_node,
-                                       "ArtBox",
-                                       &rect_array);
-        if (res == NSPDFERROR_OK) {
-            res = cos_get_rectangle(doc, rect_array, &page->artbox);
-        }
-        if (res != NSPDFERROR_OK) {
-            /* default is cropbox */
-            page->artbox = page->cropbox;
-        }
+    res = decode_page(doc, page_node, doc->page_table);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    doc->page_table_decoded = 1;
 
-        /* optional page contents */
-        res = cos_extract_dictionary_value(doc,
-                                       page_tree_node,
-                                       "Contents",
-                                       &(page->contents));
-        if ((res != NSPDFERROR_OK) &&
-            (res != NSPDFERROR_NOTFOUND)) {
-            return res;
-        }
+    return NSPDFERROR_OK;
+}
 
-        /*
-        printf("page index:%d page:%p resources:%p mediabox:%p contents:%p contents type:%d\n",
-               *page_index,
-               page,
-               page->resources,
-               page->mediabox,
-               page->contents,
-            page->contents->type);
-        */
+/**
+ * free the page table
+ *
+ * The page resources are owned by the cross reference table, only the
+ *  extracted contents objects belong to the page table.
+ */
+nspdferror nspdf__free_page_table(struct nspdf_doc *doc)
+{
+    uint64_t index;
 
-        (*page_index)++;
-        res = NSPDFERROR_OK;
-    } else {
-        res = NSPDFERROR_FORMAT;
+    if (doc->page_table == NULL) {
+        return NSPDFERROR_OK;
     }
-    return res;
+
+    for (index = 0; index < doc->page_table_size; index++) {
+        if (doc->page_table[index].contents != NULL) {
+            cos_free_object(doc->page_table[index].contents);
+        }
+    }
+    free(doc->page_table);
+
+    doc->page_table = NULL;
+    doc->page_table_size = 0;
+    doc->page_table_decoded = 0;
+
+    return NSPDFERROR_OK;
 }
 
 /* exported interface documented in nspdf/page.h */
@@ -681,17 +779,17 @@ render_operation_k(struct content_operation *operation,
 }
 
 static inline nspdferror
-set_gsc_cs(struct graphics_state_color *gsc, const char *spacename)
+set_gsc_cs(struct graphics_state_color *gsc, lwc_string *spacename)
 {
-    if (strcmp(spacename, "DeviceGray") == 0) {
+    if (spacename == nspdf__atom_DeviceGray) {
         gsc->space = GSDeviceGray;
         gsc->u.gray = 0.0;
-    } else if (strcmp(spacename, "DeviceRGB") == 0) {
+    } else if (spacename == nspdf__atom_DeviceRGB) {
         gsc->space = GSDeviceRGB;
         gsc->u.rgb.r = 0.0;
         gsc->u.rgb.g = 0.0;
         gsc->u.rgb.b = 0.0;
-    } else if (strcmp(spacename, "DeviceCMYK") == 0) {
+    } else if (spacename == nspdf__atom_DeviceCMYK) {
         gsc->space = GSDeviceCMYK;
         gsc->u.cmyk.c = 0.0;
         gsc->u.cmyk.m = 0.0;
@@ -757,14 +855,27 @@ nspdf_page_render(struct nspdf_doc *doc,
                   struct nspdf_render_ctx* render_ctx)
 {
     struct page_table_entry *page_entry;
-    struct cos_content *page_content; /* page operations array */
+    struct cos_content *page_content; /* page packed operations */
     nspdferror res;
-    struct content_operation *operation;
-    unsigned int idx;
+    struct content_operation decoded;
+    struct content_operation *operation = &decoded;
+    size_t offset = 0;
     struct graphics_state gs;
 
+    if (page_number >= doc->page_table_size) {
+        return NSPDFERROR_RANGE;
+    }
+    if (page_number >= doc->page_table_decoded) {
+        /* page object has not been received yet */
+        return NSPDFERROR_INCOMPLETE;
+    }
     page_entry = doc->page_table + page_number;
 
+    if (page_entry->contents == NULL) {
+        /* page has no content */
+        return NSPDFERROR_OK;
+    }
+
     res = cos_get_content(doc, page_entry->contents, &page_content);
     if (res != NSPDFERROR_OK) {
         return res;
@@ -786,9 +897,9 @@ nspdf_page_render(struct nspdf_doc *doc,
     }
 
     /* iterate over operations */
-    for (idx = 0, operation = page_content->operations;
-         idx < page_content->length;
-         idx++, operation++) {
+    while (nspdf__cos_content_next(page_content,
+                                   &offset,
+                                   operation) == NSPDFERROR_OK) {
         switch(operation->operator) {
             /* path operations */
         case CONTENT_OP_m: /* move */
@@ -934,6 +1045,13 @@ nspdf_get_page_dimensions(struct nspdf_doc *doc,
                           float *height)
 {
     struct page_table_entry *page_entry;
+
+    if (page_number >= doc->page_table_size) {
+        return NSPDFERROR_RANGE;
+    }
+    if (page_number >= doc->page_table_decoded) {
+        return NSPDFERROR_INCOMPLETE;
+    }
     page_entry = doc->page_table + page_number;
     *width = page_entry->cropbox.urx - page_entry->cropbox.llx;
     *height = page_entry->cropbox.ury - page_entry->cropbox.lly;
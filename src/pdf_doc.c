@@ -11,6 +11,13 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <nspdf/errors.h>
 
@@ -19,8 +26,9 @@
 #include "cos_object.h"
 #include "pdf_doc.h"
 
+/* exported interface documented in pdf_doc.h */
 nspdferror
-nspdf__stream_skip_ws(struct cos_stream *stream, strmoff_t *offset)
+nspdf__stream_skip_ws_bytewise(struct cos_stream *stream, strmoff_t *offset)
 {
     uint8_t c;
 
@@ -28,16 +36,16 @@ nspdf__stream_skip_ws(struct cos_stream *stream, strmoff_t *offset)
         return NSPDFERROR_OK;
     }
 
+    /* the stream padding is an end of line followed by a non whitespace
+     * sentinel so neither loop needs to check the stream length
+     */
     c = stream_byte(stream, *offset);
-    while (((*offset) < stream->length) &&
-           ((bclass[c] & (BC_WSPC | BC_CMNT) ) != 0)) {
+    while ((bclass[c] & (BC_WSPC | BC_CMNT) ) != 0) {
         (*offset)++;
         /* skip comments */
-        if (((*offset) < stream->length) &&
-            ((bclass[c] & BC_CMNT) != 0)) {
+        if ((bclass[c] & BC_CMNT) != 0) {
             c = stream_byte(stream, *offset);
-            while ((*offset < stream->length) &&
-                   ((bclass[c] & BC_EOLM ) == 0)) {
+            while ((bclass[c] & BC_EOLM ) == 0) {
                 (*offset)++;
                 c = stream_byte(stream, (*offset));
             }
@@ -47,6 +55,460 @@ nspdf__stream_skip_ws(struct cos_stream *stream, strmoff_t *offset)
     return NSPDFERROR_OK;
 }
 
+#if defined(__AVX2__)
+
+/** bytes classified by each block scan */
+#define BLOCK_SIZE 32
+
+/**
+ * bit mask of bytes in a block equal to a value
+ */
+static inline uint32_t block_eq_mask(const uint8_t *data, uint8_t c)
+{
+    __m256i v;
+
+    v = _mm256_loadu_si256((const __m256i *)data);
+
+    return (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+
+/**
+ * bit mask of whitespace bytes in a block
+ */
+static inline uint32_t block_ws_mask(const uint8_t *data)
+{
+    __m256i v;
+    __m256i ws;
+
+    v = _mm256_loadu_si256((const __m256i *)data);
+    ws = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(v, _mm256_setzero_si256()),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '))),
+        _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\f')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')))));
+
+    return (uint32_t)_mm256_movemask_epi8(ws);
+}
+
+/**
+ * bit mask of bytes in a block which end a literal string run
+ */
+static inline uint32_t block_literal_mask(const uint8_t *data)
+{
+    __m256i v;
+    __m256i special;
+
+    v = _mm256_loadu_si256((const __m256i *)data);
+    special = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('(')),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(')'))),
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')))));
+
+    return (uint32_t)_mm256_movemask_epi8(special);
+}
+
+#elif defined(__SSE2__)
+
+/** bytes classified by each block scan */
+#define BLOCK_SIZE 16
+
+/**
+ * bit mask of bytes in a block equal to a value
+ */
+static inline uint32_t block_eq_mask(const uint8_t *data, uint8_t c)
+{
+    __m128i v;
+
+    v = _mm_loadu_si128((const __m128i *)data);
+
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+/**
+ * bit mask of whitespace bytes in a block
+ */
+static inline uint32_t block_ws_mask(const uint8_t *data)
+{
+    __m128i v;
+    __m128i ws;
+
+    v = _mm_loadu_si128((const __m128i *)data);
+    ws = _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_setzero_si128()),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8(' '))),
+        _mm_or_si128(
+            _mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+            _mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\f')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))));
+
+    return (uint32_t)_mm_movemask_epi8(ws);
+}
+
+/**
+ * bit mask of bytes in a block which end a literal string run
+ */
+static inline uint32_t block_literal_mask(const uint8_t *data)
+{
+    __m128i v;
+    __m128i special;
+
+    v = _mm_loadu_si128((const __m128i *)data);
+    special = _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('(')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8(')'))),
+        _mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')),
+            _mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))));
+
+    return (uint32_t)_mm_movemask_epi8(special);
+}
+
+#endif
+
+#if defined(__SSE2__)
+
+/** hex digits decoded by each block */
+#define HEX_BLOCK_SIZE 16
+
+/**
+ * decode a block of hex digit pairs
+ *
+ * Each digit is classified and converted to its value in parallel. The
+ *  values of each pair are then combined within 16 bit lanes, where the
+ *  first digit of the pair is the low byte, and packed down to bytes.
+ *
+ * \param data The hex digits to decode.
+ * \param out The location to store the decoded bytes.
+ * \return true if the whole block was hex digits and was decoded.
+ */
+static inline bool hex_decode_block(const uint8_t *data, uint8_t *out)
+{
+    __m128i v;
+    __m128i lower;
+    __m128i digit;
+    __m128i alpha;
+    __m128i value;
+
+    v = _mm_loadu_si128((const __m128i *)data);
+    lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+
+    /* bytes above 0x7f compare as negative so are never in range */
+    digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                          _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+    alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                          _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lower));
+    if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xffff) {
+        return false;
+    }
+
+    value = _mm_or_si128(
+        _mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+        _mm_andnot_si128(digit,
+                         _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+
+    value = _mm_or_si128(
+        _mm_slli_epi16(_mm_and_si128(value, _mm_set1_epi16(0x00ff)), 4),
+        _mm_srli_epi16(value, 8));
+
+    _mm_storel_epi64((__m128i *)out,
+                     _mm_packus_epi16(value, _mm_setzero_si128()));
+
+    return true;
+}
+
+#endif
+
+#if defined(BLOCK_SIZE)
+
+/** mask of all the bytes in a block */
+#define BLOCK_MASK ((uint32_t)((1ULL << BLOCK_SIZE) - 1))
+
+/**
+ * skip whitespace and comments in memory a block at a time
+ *
+ * The whitespace bytes (NUL, HT, LF, FF, CR and SP) are classified a block at
+ *  a time. Comments are located with the same block scan for their end of
+ *  line. Loads are unaligned and may extend beyond the stream data into the
+ *  padding, which always stops the scan as it is an end of line followed by
+ *  a non whitespace sentinel.
+ */
+static inline strmoff_t
+skip_ws_block(const uint8_t *data, strmoff_t offset)
+{
+    uint32_t mask;
+
+    for (;;) {
+        mask = ~block_ws_mask(data + offset) & BLOCK_MASK;
+        if (mask == 0) {
+            offset += BLOCK_SIZE;
+            continue;
+        }
+        offset += __builtin_ctz(mask);
+
+        if ((bclass[data[offset]] & BC_CMNT) == 0) {
+            return offset;
+        }
+
+        /* comment, scan for its end of line */
+        offset++;
+        for (;;) {
+            mask = block_eq_mask(data + offset, '\n') |
+                block_eq_mask(data + offset, '\r');
+            if (mask != 0) {
+                offset += __builtin_ctz(mask);
+                break;
+            }
+            offset += BLOCK_SIZE;
+        }
+    }
+}
+
+#endif
+
+/* exported interface documented in pdf_doc.h */
+nspdferror
+nspdf__stream_skip_ws(struct cos_stream *stream, strmoff_t *offset)
+{
+#if defined(BLOCK_SIZE)
+    if (stream->source == NULL) {
+        if ((*offset) < stream->length) {
+            *offset = skip_ws_block(stream->data, *offset);
+        }
+        return NSPDFERROR_OK;
+    }
+#endif
+    return nspdf__stream_skip_ws_bytewise(stream, offset);
+}
+
+
+/* exported interface documented in pdf_doc.h */
+size_t nspdf__literal_run(const uint8_t *data, size_t length)
+{
+    size_t idx = 0;
+    uint8_t c;
+
+#if defined(BLOCK_SIZE)
+    uint32_t mask;
+
+    for (; (length - idx) >= BLOCK_SIZE; idx += BLOCK_SIZE) {
+        mask = block_literal_mask(data + idx);
+        if (mask != 0) {
+            return idx + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; idx < length; idx++) {
+        c = data[idx];
+        if ((c == '(') ||
+            (c == ')') ||
+            (c == '\\') ||
+            ((bclass[c] & BC_EOLM) != 0)) {
+            break;
+        }
+    }
+    return idx;
+}
+
+/**
+ * value of a hex digit
+ *
+ * Letters have bit 6 set and a low nibble one more than their value less
+ *  ten in either case.
+ */
+static inline uint8_t hex_value(uint8_t c)
+{
+    return (c & 0xf) + ((c >> 6) * 9);
+}
+
+/* exported interface documented in pdf_doc.h */
+size_t nspdf__hex_decode(const uint8_t *data, size_t length, uint8_t *out)
+{
+    size_t idx = 0;
+
+#if defined(HEX_BLOCK_SIZE)
+    for (; (length - idx) >= HEX_BLOCK_SIZE; idx += HEX_BLOCK_SIZE) {
+        if (!hex_decode_block(data + idx, out)) {
+            break;
+        }
+        out += HEX_BLOCK_SIZE / 2;
+    }
+#endif
+
+    for (; (length - idx) >= 2; idx += 2) {
+        if (((bclass[data[idx]] & BC_HEXL) == 0) ||
+            ((bclass[data[idx + 1]] & BC_HEXL) == 0)) {
+            break;
+        }
+        *out++ = (hex_value(data[idx]) << 4) | hex_value(data[idx + 1]);
+    }
+    return idx;
+}
+
+
+/**
+ * check for a keyword at an offset a byte at a time
+ */
+static inline bool
+match_keyword(struct cos_stream *stream,
+              strmoff_t offset,
+              const uint8_t *keyword,
+              size_t keyword_len)
+{
+    size_t idx;
+
+    for (idx = 0; idx < keyword_len; idx++) {
+        if (stream_byte(stream, offset + idx) != keyword[idx]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* exported interface documented in pdf_doc.h */
+nspdferror
+nspdf__stream_find(struct cos_stream *stream,
+                   strmoff_t offset,
+                   strmoff_t end,
+                   const char *keyword,
+                   size_t keyword_len,
+                   strmoff_t *offset_out)
+{
+    const uint8_t *kw = (const uint8_t *)keyword;
+    strmoff_t last; /* last offset the keyword may start at */
+
+    if (end > stream->length) {
+        end = stream->length;
+    }
+    if ((keyword_len == 0) ||
+        (end < keyword_len) ||
+        (offset > (end - keyword_len))) {
+        return NSPDFERROR_NOTFOUND;
+    }
+    last = end - keyword_len;
+
+#if defined(BLOCK_SIZE)
+    if (stream->source == NULL) {
+        const uint8_t *data = stream->data;
+        uint32_t mask;
+        unsigned int bit;
+
+        /* candidates are where both the first and last keyword bytes match.
+         * Loads beyond the last candidate are within the stream padding.
+         */
+        for (; offset <= last; offset += BLOCK_SIZE) {
+            mask = block_eq_mask(data + offset, kw[0]) &
+                block_eq_mask(data + offset + keyword_len - 1,
+                              kw[keyword_len - 1]);
+            while (mask != 0) {
+                bit = __builtin_ctz(mask);
+                if ((offset + bit) > last) {
+                    return NSPDFERROR_NOTFOUND;
+                }
+                if (memcmp(data + offset + bit, kw, keyword_len) == 0) {
+                    *offset_out = offset + bit;
+                    return NSPDFERROR_OK;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return NSPDFERROR_NOTFOUND;
+    }
+#endif
+
+    for (; offset <= last; offset++) {
+        if (match_keyword(stream, offset, kw, keyword_len)) {
+            *offset_out = offset;
+            return NSPDFERROR_OK;
+        }
+    }
+    return NSPDFERROR_NOTFOUND;
+}
+
+/* exported interface documented in pdf_doc.h */
+nspdferror
+nspdf__stream_rfind(struct cos_stream *stream,
+                    strmoff_t start,
+                    strmoff_t end,
+                    const char *keyword,
+                    size_t keyword_len,
+                    strmoff_t *offset_out)
+{
+    const uint8_t *kw = (const uint8_t *)keyword;
+    strmoff_t offset;
+    strmoff_t last; /* last offset the keyword may start at */
+
+    if (end > stream->length) {
+        end = stream->length;
+    }
+    if ((keyword_len == 0) ||
+        (end < keyword_len) ||
+        (start > (end - keyword_len))) {
+        return NSPDFERROR_NOTFOUND;
+    }
+    last = end - keyword_len;
+
+#if defined(BLOCK_SIZE)
+    if (stream->source == NULL) {
+        const uint8_t *data = stream->data;
+        uint32_t mask;
+        unsigned int bit;
+
+        /* whole blocks of candidates working back from the last */
+        offset = last + 1;
+        while ((offset - start) >= BLOCK_SIZE) {
+            offset -= BLOCK_SIZE;
+            mask = block_eq_mask(data + offset, kw[0]) &
+                block_eq_mask(data + offset + keyword_len - 1,
+                              kw[keyword_len - 1]);
+            while (mask != 0) {
+                bit = 31 - __builtin_clz(mask);
+                if (memcmp(data + offset + bit, kw, keyword_len) == 0) {
+                    *offset_out = offset + bit;
+                    return NSPDFERROR_OK;
+                }
+                mask &= ~((uint32_t)1 << bit);
+            }
+        }
+        if (offset == start) {
+            return NSPDFERROR_NOTFOUND;
+        }
+        /* remaining candidates are checked a byte at a time */
+        last = offset - 1;
+    }
+#endif
+
+    for (offset = last; offset >= start; offset--) {
+        if (match_keyword(stream, offset, kw, keyword_len)) {
+            *offset_out = offset;
+            return NSPDFERROR_OK;
+        }
+        if (offset == 0) {
+            break;
+        }
+    }
+    return NSPDFERROR_NOTFOUND;
+}
+
 
 /**
  * move offset to next non eol byte
@@ -55,7 +517,8 @@ nspdferror
 nspdf__stream_skip_eol(struct cos_stream *stream, strmoff_t *offset)
 {
     uint8_t c;
-    /** \todo sort out keeping offset in range */
+
+    /* terminated by the stream padding sentinel */
     c = stream_byte(stream, *offset);
     while ((bclass[c] & BC_EOLM) != 0) {
         (*offset)++;
@@ -73,29 +536,23 @@ nspdf__stream_read_uint(struct cos_stream *stream,
     uint8_t c; /* current byte from source data */
     strmoff_t offset; /* current offset of source data */
     unsigned int len; /* number of decimal places in number */
-    uint8_t num[21]; /* temporary buffer for decimal values */
-    uint64_t result=0; /* parsed result */
-    uint64_t tens;
+    uint64_t result = 0; /* parsed result */
 
     offset = *offset_out;
 
-    for (len = 0; len < sizeof(num); len++) {
+    for (len = 0; len < 21; len++) {
         c = stream_byte(stream, offset);
         if ((bclass[c] & BC_DCML) != BC_DCML) {
             if (len == 0) {
                 return -2; /* parse error no decimals in input */
             }
-            /* sum value from each place */
-            for (tens = 1; len > 0; tens = tens * 10, len--) {
-                result += (num[len - 1] * tens);
-            }
 
             *offset_out = offset;
             *result_out = result;
 
             return NSPDFERROR_OK;
         }
-        num[len] = c - '0';
+        result = (result * 10) + (c - '0');
         offset++;
     }
     return NSPDFERROR_RANGE; /* number too long */
@@ -17,30 +17,100 @@
 
 #include "cos_stream.h"
 
-struct xref_table_entry;
+struct xref_table;
+struct xref_objstm_cache;
 struct page_table_entry;
+struct nspdf_linearized;
+struct nspdf_source;
+struct nspdf_arena;
+struct nspdf_scratch;
+struct lwc_string_s;
+
+/** default limit on the nesting of parsed objects and trailer chains */
+#define NSPDF_DEFAULT_MAX_DEPTH 256
 
 /**
  * pdf document
  */
 struct nspdf_doc {
 
-    const uint8_t *start; /* start of pdf document in input stream */
-    unsigned int length;
+    strmoff_t start; /* offset of pdf header in input stream */
+
+    /**
+     * file mapping, including stream padding, owned by the document (NULL
+     * if the file was not opened directly)
+     */
+    void *map;
+    size_t map_length;
+
+    /**
+     * byte source owned by the document (NULL if data is in memory)
+     */
+    struct nspdf_source *source;
+
+    /**
+     * buffer owned by the document when data is appended progressively
+     */
+    uint8_t *buffer;
+    size_t buffer_alloc;
+    size_t buffer_length;
+    size_t buffer_parsed; /* buffer length when the structure was decoded */
+    bool buffer_complete; /* no more data will be appended */
+    bool ready; /* trailers and catalog have been decoded */
 
     /**
      * input data stream
      */
     struct cos_stream *stream;
 
+    /**
+     * region objects parsed from the input stream are allocated from
+     */
+    struct nspdf_arena *arena;
+
+    /**
+     * stack containers are built on while they are parsed
+     */
+    struct nspdf_scratch *scratch;
+
+    /**
+     * maximum nesting of parsed objects and length of trailer chains
+     */
+    unsigned int max_depth;
+    unsigned int reference_depth; /* objects being parsed by dereferencing */
+
     int major;
     int minor;
 
     /**
      * Indirect object cross reference table
      */
-    uint64_t xref_table_size;
-    struct xref_table_entry *xref_table;
+    struct xref_table *xref_table;
+
+    /**
+     * recently decoded object streams or NULL if none have been used
+     */
+    struct xref_objstm_cache *objstm_cache;
+
+    /**
+     * offset of the next older cross reference section still to be decoded
+     *  or zero if the trailer chain is exhausted
+     */
+    strmoff_t xref_prev;
+
+    /**
+     * error decoding the section at xref_prev which is returned instead of
+     *  decoding the corrupt section again
+     */
+    nspdferror xref_prev_error;
+
+    /**
+     * offsets of the cross reference sections decoded so far held in an open
+     *  addressed set where zero marks unused slots
+     */
+    unsigned int xref_section_count;
+    unsigned int xref_section_alloc;
+    strmoff_t *xref_sections;
 
     struct cos_object *root;
     struct cos_object *encrypt;
@@ -49,18 +119,109 @@ struct nspdf_doc {
 
     /* page refrerence table */
     uint64_t page_table_size;
+    uint64_t page_table_decoded; /* number of leading pages decoded */
     struct page_table_entry *page_table;
+
+    /* linearization parameters if document is linearized */
+    struct nspdf_linearized *linear;
 };
 
 /* helpers in pdf_doc.c */
+
+/**
+ * move offset past any whitespace and comments
+ *
+ * In memory streams are scanned a vector block at a time where the target
+ *  supports it.
+ */
 nspdferror nspdf__stream_skip_ws(struct cos_stream *stream, strmoff_t *offset);
+
+/**
+ * move offset past any whitespace and comments classifying a byte at a time
+ */
+nspdferror nspdf__stream_skip_ws_bytewise(struct cos_stream *stream, strmoff_t *offset);
+
 nspdferror nspdf__stream_skip_eol(struct cos_stream *stream, strmoff_t *offset);
+
+/**
+ * find the first occurrence of a keyword in a stream
+ *
+ * \param stream The stream to search.
+ * \param offset The offset to start searching from.
+ * \param end The offset the keyword must end at or before.
+ * \param keyword The keyword to find.
+ * \param keyword_len The length of the keyword.
+ * \param offset_out The offset of the start of the keyword.
+ * \return NSPDFERROR_OK and offset_out set or NSPDFERROR_NOTFOUND.
+ */
+nspdferror nspdf__stream_find(struct cos_stream *stream, strmoff_t offset, strmoff_t end, const char *keyword, size_t keyword_len, strmoff_t *offset_out);
+
+/**
+ * find the last occurrence of a keyword in a stream
+ *
+ * \param stream The stream to search.
+ * \param start The earliest offset the keyword may start at.
+ * \param end The offset the keyword must end at or before.
+ * \param keyword The keyword to find.
+ * \param keyword_len The length of the keyword.
+ * \param offset_out The offset of the start of the keyword.
+ * \return NSPDFERROR_OK and offset_out set or NSPDFERROR_NOTFOUND.
+ */
+nspdferror nspdf__stream_rfind(struct cos_stream *stream, strmoff_t start, strmoff_t end, const char *keyword, size_t keyword_len, strmoff_t *offset_out);
+
+/**
+ * length of a run of literal string bytes in memory which need no translation
+ *
+ * \param data The string bytes.
+ * \param length The number of bytes which may be scanned.
+ * \return The number of bytes before the first parenthesis, backslash or end
+ *          of line, or length if there is none.
+ */
+size_t nspdf__literal_run(const uint8_t *data, size_t length);
+
+/**
+ * decode pairs of hex digits in memory
+ *
+ * Decoding stops at the first pair which is not two hex digits. Digits are
+ *  decoded a vector block at a time where the target supports it.
+ *
+ * \param data The hex digits.
+ * \param length The number of bytes which may be decoded.
+ * \param out Storage for at least length / 2 decoded bytes.
+ * \return The number of hex digits decoded which is always even.
+ */
+size_t nspdf__hex_decode(const uint8_t *data, size_t length, uint8_t *out);
+
 nspdferror nspdf__stream_read_uint(struct cos_stream *stream, strmoff_t *offset_out, uint64_t *result_out);
 
 
 nspdferror nspdf__decode_page_tree(struct nspdf_doc *doc, struct cos_object *page_tree_node, unsigned int *page_index);
+nspdferror nspdf__free_page_table(struct nspdf_doc *doc);
+
+/**
+ * decode only the first page of a document with a known page count
+ *
+ * Used to render the first page of a linearized document before the page tree
+ *  has been received.
+ */
+nspdferror nspdf__decode_first_page(struct nspdf_doc *doc, struct cos_object *page_node, unsigned int page_count);
+
+/* helpers in document.c */
+
+/**
+ * decode the next older cross reference section of the trailer chain
+ *
+ * Only the newest section is decoded when the document is parsed, older
+ *  sections are decoded as object lookups miss the entries already present.
+ *
+ * \param doc The document.
+ * \return NSPDFERROR_OK if a section was decoded, NSPDFERROR_NOTFOUND if the
+ *          chain is exhausted or loops or the error decoding the section
+ *          which is returned again by every later call.
+ */
+nspdferror nspdf__decode_xref_prev(struct nspdf_doc *doc);
 
 /* cos stream filters */
-nspdferror nspdf__cos_stream_filter(struct nspdf_doc *doc, const char *filter_name, struct cos_stream **stream_out);
+nspdferror nspdf__cos_stream_filter(struct nspdf_doc *doc, struct lwc_string_s *filter_name, struct cos_stream **stream_out);
 
 #endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nspdf/errors.h>
+
+#include "scratch.h"
+
+/** smallest scratch stack allocation */
+#define SCRATCH_MIN_ALLOC 4096
+
+/* exported interface documented in scratch.h */
+nspdferror nspdf__scratch_create(struct nspdf_scratch **scratch_out)
+{
+    struct nspdf_scratch *scratch;
+
+    scratch = calloc(1, sizeof(struct nspdf_scratch));
+    if (scratch == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+
+    *scratch_out = scratch;
+
+    return NSPDFERROR_OK;
+}
+
+/* exported interface documented in scratch.h */
+nspdferror nspdf__scratch_destroy(struct nspdf_scratch *scratch)
+{
+    free(scratch->data);
+    free(scratch);
+
+    return NSPDFERROR_OK;
+}
+
+/* exported interface documented in scratch.h */
+nspdferror nspdf__scratch_extend(struct nspdf_scratch *scratch, size_t size)
+{
+    uint8_t *ndata;
+    size_t nalloc;
+
+    if (size > (SIZE_MAX - scratch->length)) {
+        return NSPDFERROR_NOMEM;
+    }
+
+    /* the stack is doubled so pushes are amortised constant time */
+    nalloc = (scratch->alloc == 0) ? SCRATCH_MIN_ALLOC : scratch->alloc;
+    while (nalloc < (scratch->length + size)) {
+        if (nalloc > (SIZE_MAX / 2)) {
+            nalloc = scratch->length + size;
+            break;
+        }
+        nalloc = nalloc * 2;
+    }
+
+    ndata = realloc(scratch->data, nalloc);
+    if (ndata == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+    scratch->data = ndata;
+    scratch->alloc = nalloc;
+
+    return NSPDFERROR_OK;
+}
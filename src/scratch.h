@@ -0,0 +1,181 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/**
+ * \file
+ * NetSurf PDF library parser scratch stack
+ *
+ * Containers are built up on a stack owned by the document while they are
+ *  parsed and copied into an allocation of exactly the final size once they
+ *  are complete. Nested containers are built above their parent and released
+ *  before the parent continues so the stack is shared by every level.
+ */
+
+#ifndef NSPDF__SCRATCH_H_
+#define NSPDF__SCRATCH_H_
+
+/** alignment of the start of each container on the stack */
+#define SCRATCH_ALIGN 8
+
+/**
+ * parser scratch stack
+ */
+struct nspdf_scratch {
+    uint8_t *data; /**< stack storage */
+    size_t length; /**< bytes in use */
+    size_t alloc; /**< bytes allocated */
+};
+
+/**
+ * create a scratch stack
+ */
+nspdferror nspdf__scratch_create(struct nspdf_scratch **scratch_out);
+
+/**
+ * destroy a scratch stack
+ */
+nspdferror nspdf__scratch_destroy(struct nspdf_scratch *scratch);
+
+/**
+ * extend a scratch stack so at least size more bytes may be pushed
+ *
+ * The storage may move so pointers into the stack are invalidated.
+ */
+nspdferror nspdf__scratch_extend(struct nspdf_scratch *scratch, size_t size);
+
+/**
+ * start a container on a scratch stack
+ *
+ * The start is aligned so a container whose element size is a multiple of
+ *  SCRATCH_ALIGN remains contiguous when nested containers are built and
+ *  released above it.
+ *
+ * \return The mark of the container start which is passed to
+ *          nspdf__scratch_at() and nspdf__scratch_release()
+ */
+static inline size_t nspdf__scratch_mark(struct nspdf_scratch *scratch)
+{
+    scratch->length = (scratch->length + (SCRATCH_ALIGN - 1)) &
+        ~(size_t)(SCRATCH_ALIGN - 1);
+    return scratch->length;
+}
+
+/**
+ * get the top of a scratch stack without starting a container
+ *
+ * Releasing to the top discards everything pushed since including any
+ *  alignment added by nested containers, so byte packed data may be built
+ *  around them.
+ */
+static inline size_t nspdf__scratch_top(struct nspdf_scratch *scratch)
+{
+    return scratch->length;
+}
+
+/**
+ * push data onto a scratch stack
+ */
+static inline nspdferror
+nspdf__scratch_push(struct nspdf_scratch *scratch, const void *data, size_t size)
+{
+    nspdferror res;
+
+    if ((scratch->alloc - scratch->length) < size) {
+        res = nspdf__scratch_extend(scratch, size);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+    }
+    memcpy(scratch->data + scratch->length, data, size);
+    scratch->length += size;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * push a byte onto a scratch stack
+ */
+static inline nspdferror
+nspdf__scratch_push_byte(struct nspdf_scratch *scratch, uint8_t c)
+{
+    nspdferror res;
+
+    if (scratch->length == scratch->alloc) {
+        res = nspdf__scratch_extend(scratch, 1);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+    }
+    scratch->data[scratch->length++] = c;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * reserve space on top of a scratch stack to be written in place
+ *
+ * The bytes written are pushed with nspdf__scratch_commit() and the pointer
+ *  is only valid until the next push.
+ */
+static inline nspdferror
+nspdf__scratch_reserve(struct nspdf_scratch *scratch,
+                       size_t size,
+                       uint8_t **data_out)
+{
+    nspdferror res;
+
+    if ((scratch->alloc - scratch->length) < size) {
+        res = nspdf__scratch_extend(scratch, size);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+    }
+    *data_out = scratch->data + scratch->length;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * push bytes written in place after nspdf__scratch_reserve()
+ */
+static inline void
+nspdf__scratch_commit(struct nspdf_scratch *scratch, size_t size)
+{
+    scratch->length += size;
+}
+
+/**
+ * get the contents of a scratch stack from a mark
+ *
+ * The pointer is only valid until the next push.
+ */
+static inline void *nspdf__scratch_at(struct nspdf_scratch *scratch, size_t mark)
+{
+    return scratch->data + mark;
+}
+
+/**
+ * number of bytes pushed onto a scratch stack since a mark
+ */
+static inline size_t
+nspdf__scratch_size(struct nspdf_scratch *scratch, size_t mark)
+{
+    return scratch->length - mark;
+}
+
+/**
+ * discard everything pushed onto a scratch stack since a mark
+ */
+static inline void
+nspdf__scratch_release(struct nspdf_scratch *scratch, size_t mark)
+{
+    scratch->length = mark;
+}
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <nspdf/errors.h>
+
+#include "source.h"
+
+/* exported interface documented in source.h */
+nspdferror
+nspdf__source_create(nspdf_source_fetch_fn fetch,
+                     void *ctx,
+                     strmoff_t length,
+                     size_t chunk_size,
+                     struct nspdf_source **source_out)
+{
+    struct nspdf_source *source;
+
+    if (fetch == NULL) {
+        return NSPDFERROR_SYNTAX;
+    }
+
+    source = calloc(1, sizeof(struct nspdf_source));
+    if (source == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+
+    if (chunk_size == 0) {
+        chunk_size = SOURCE_CHUNK_SIZE;
+    }
+
+    source->fetch = fetch;
+    source->ctx = ctx;
+    source->length = length;
+    source->chunk_size = chunk_size;
+    source->error = NSPDFERROR_OK;
+
+    *source_out = source;
+
+    return NSPDFERROR_OK;
+}
+
+/* exported interface documented in source.h */
+nspdferror nspdf__source_destroy(struct nspdf_source *source)
+{
+    unsigned int index;
+
+    for (index = 0; index < SOURCE_CHUNK_COUNT; index++) {
+        free(source->chunks[index].data);
+    }
+    free(source);
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * find a chunk in the cache fetching it if necessary
+ */
+static struct source_chunk *
+get_chunk(struct nspdf_source *source, uint64_t chunk_index)
+{
+    nspdferror res;
+    struct source_chunk *chunk;
+    struct source_chunk *victim;
+    strmoff_t offset;
+    unsigned int index;
+
+    source->clock++;
+
+    victim = &source->chunks[0];
+    for (index = 0; index < SOURCE_CHUNK_COUNT; index++) {
+        chunk = &source->chunks[index];
+        if ((chunk->used != 0) && (chunk->index == chunk_index)) {
+            source->hits++;
+            chunk->used = source->clock;
+            return chunk;
+        }
+        if (chunk->used < victim->used) {
+            /* least recently used, empty slots have a zero use */
+            victim = chunk;
+        }
+    }
+
+    source->misses++;
+
+    if (victim->data == NULL) {
+        victim->data = malloc(source->chunk_size);
+        if (victim->data == NULL) {
+            source->error = NSPDFERROR_NOMEM;
+            return NULL;
+        }
+    }
+
+    offset = chunk_index * source->chunk_size;
+    victim->length = source->chunk_size;
+    if ((offset + victim->length) > source->length) {
+        victim->length = source->length - offset;
+    }
+
+    res = source->fetch(source->ctx, offset, victim->data, victim->length);
+    if (res != NSPDFERROR_OK) {
+        victim->used = 0;
+        if (source->error == NSPDFERROR_OK) {
+            source->error = res;
+        }
+        return NULL;
+    }
+
+    victim->index = chunk_index;
+    victim->used = source->clock;
+
+    return victim;
+}
+
+/* exported interface documented in cos_stream.h */
+uint8_t nspdf__source_stream_byte(struct cos_stream *stream, strmoff_t offset)
+{
+    struct nspdf_source *source = stream->source;
+    struct source_chunk *chunk;
+
+    if (offset >= source->length) {
+        /* same padding as an in memory stream */
+        if (offset == source->length) {
+            return '\n';
+        }
+        return STREAM_SENTINEL;
+    }
+
+    chunk = get_chunk(source, offset / source->chunk_size);
+    if (chunk == NULL) {
+        return STREAM_SENTINEL;
+    }
+
+    /* move the window to the chunk. It is the most recently used so remains
+     * valid until a lookup for another chunk.
+     */
+    stream->data = chunk->data;
+    stream->window_offset = chunk->index * source->chunk_size;
+    stream->window_length = chunk->length;
+
+    return stream->data[offset - stream->window_offset];
+}
+
+/* exported interface documented in source.h */
+nspdferror
+nspdf__source_read(struct nspdf_source *source,
+                   strmoff_t offset,
+                   strmoff_t length,
+                   uint8_t **data_out)
+{
+    nspdferror res;
+    uint8_t *data;
+
+    if ((offset > source->length) ||
+        (length > (source->length - offset)) ||
+        (length > SIZE_MAX)) {
+        return NSPDFERROR_RANGE;
+    }
+
+    data = malloc(length + STREAM_PADDING);
+    if (data == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+
+    if (length > 0) {
+        res = source->fetch(source->ctx, offset, data, length);
+        if (res != NSPDFERROR_OK) {
+            free(data);
+            return res;
+        }
+    }
+    stream_pad(data + length);
+
+    *data_out = data;
+
+    return NSPDFERROR_OK;
+}
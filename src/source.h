@@ -0,0 +1,86 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/**
+ * \file
+ * NetSurf PDF library random access byte source with chunk cache
+ */
+
+#ifndef NSPDF__SOURCE_H_
+#define NSPDF__SOURCE_H_
+
+#include <nspdf/document.h>
+
+#include "cos_stream.h"
+
+/** default size of cached chunks */
+#define SOURCE_CHUNK_SIZE (64 * 1024)
+
+/** number of chunks held in the cache */
+#define SOURCE_CHUNK_COUNT 16
+
+/**
+ * cached chunk of source data
+ */
+struct source_chunk {
+    uint64_t index; /**< chunk index (offset / chunk size) */
+    uint64_t used; /**< cache clock at last use, zero if slot is empty */
+    size_t length; /**< length of valid data */
+    uint8_t *data; /**< chunk data */
+};
+
+/**
+ * random access byte source
+ */
+struct nspdf_source {
+    nspdf_source_fetch_fn fetch; /**< client fetch callback */
+    void *ctx; /**< client context */
+    strmoff_t length; /**< total length of source */
+
+    size_t chunk_size;
+    struct source_chunk chunks[SOURCE_CHUNK_COUNT];
+    uint64_t clock; /**< incremented on every chunk lookup */
+
+    uint64_t hits; /**< chunk lookups satisfied from the cache */
+    uint64_t misses; /**< chunk lookups which required a fetch */
+
+    nspdferror error; /**< first fetch error encountered */
+};
+
+/**
+ * create a byte source
+ *
+ * \param fetch The callback used to fill chunks.
+ * \param ctx The context passed to the fetch callback.
+ * \param length The total length of the source.
+ * \param chunk_size The chunk size or zero for the default.
+ * \param source_out The created source.
+ */
+nspdferror nspdf__source_create(nspdf_source_fetch_fn fetch, void *ctx, strmoff_t length, size_t chunk_size, struct nspdf_source **source_out);
+
+/**
+ * destroy a byte source freeing all cached chunks
+ */
+nspdferror nspdf__source_destroy(struct nspdf_source *source);
+
+/**
+ * read a range of bytes from a source into a newly allocated buffer
+ *
+ * Large ranges such as stream data are fetched directly instead of through
+ *  the chunk cache.
+ *
+ * \param source The source to read from.
+ * \param offset The offset to read from.
+ * \param length The number of bytes to read.
+ * \param data_out The allocated buffer which the caller must free. It has
+ *                 STREAM_PADDING bytes of padding after the data.
+ */
+nspdferror nspdf__source_read(struct nspdf_source *source, strmoff_t offset, strmoff_t length, uint8_t **data_out);
+
+#endif
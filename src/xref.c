@@ -10,140 +10,1672 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <zlib.h>
 
 #include <nspdf/errors.h>
 
 #include "cos_parse.h"
 #include "cos_object.h"
 #include "pdf_doc.h"
+#include "source.h"
+#include "atom.h"
 #include "xref.h"
 
+/** number of fields in each cross reference stream entry */
+#define XREF_STREAM_FIELDS 3
 
-/** indirect object */
-struct xref_table_entry {
-    /* reference identifier */
-    struct cos_reference ref;
+/** widest cross reference stream entry field in bytes */
+#define XREF_STREAM_FIELD_MAX 8
 
-    /** offset of object */
+/** size of the buffer cross reference stream data is inflated into */
+#define XREF_STREAM_CHUNK 4096
+
+/** number of decoded object streams kept */
+#define XREF_OBJSTM_CACHE_SIZE 8
+
+/** shift of the entry type within the information word of an entry */
+#define XREF_INFO_SHIFT 30
+
+/** largest generation or object stream index an entry can hold */
+#define XREF_INFO_VALUE_MAX ((1U << XREF_INFO_SHIFT) - 1)
+
+/** information word of an entry */
+#define XREF_INFO(type, value) (((uint32_t)(type) << XREF_INFO_SHIFT) | (value))
+
+/** type of an entry from its information word */
+#define XREF_INFO_TYPE(info) ((enum xref_entry_type)((info) >> XREF_INFO_SHIFT))
+
+/** generation or object stream index from an information word */
+#define XREF_INFO_VALUE(info) ((info) & XREF_INFO_VALUE_MAX)
+
+/** initial number of slots in the parsed object map */
+#define XREF_OBJECT_MAP_INITIAL 64
+
+/** largest declared size a dense table is always used for */
+#define XREF_DENSE_SIZE 65536
+
+/** length of a classic cross reference table entry */
+#define XREF_TABLE_ENTRY_LENGTH 20
+
+/** largest expansion of deflate compressed data */
+#define XREF_INFLATE_RATIO 1032
+
+/**
+ * a sparse table becomes dense once more than this fraction of its declared
+ *  size is present which is where a dense table becomes the smaller
+ */
+#define XREF_SPARSE_RATIO 4
+
+/** initial number of slots in a sparse table */
+#define XREF_SPARSE_INITIAL 1024
+
+/** offset marking an entry whose offset is held in the wide offset map */
+#define XREF_OFFSET_WIDE UINT32_MAX
+
+/** initial number of slots in the wide offset map */
+#define XREF_WIDE_INITIAL 16
+
+/**
+ * type of cross reference table entry
+ */
+enum xref_entry_type {
+    XREF_ENTRY_FREE = 0, /**< no object */
+    XREF_ENTRY_OBJECT = 1, /**< uncompressed object at an offset */
+    XREF_ENTRY_COMPRESSED = 2, /**< object within an object stream */
+};
+
+/**
+ * parsed object map slot
+ */
+struct xref_object_slot {
+    uint32_t id; /**< object number or zero if the slot is empty */
+    struct cos_object *object; /**< parsed object */
+};
+
+/**
+ * sparse cross reference table slot
+ */
+struct xref_sparse_slot {
+    uint32_t id; /**< object number or zero if the slot is empty */
+    uint32_t offset; /**< offset or object stream number */
+    uint32_t info; /**< type and generation or index */
+};
+
+/**
+ * wide offset map slot
+ */
+struct xref_wide_slot {
+    uint32_t id; /**< object number or zero if the slot is empty */
+    uint64_t offset; /**< offset of the object */
+};
+
+/**
+ * cross reference table
+ *
+ * Entries are held in parallel arrays indexed by object number so each takes
+ *  eight bytes. The offset is the byte offset of an uncompressed object or
+ *  the object number of the object stream holding a compressed one. The
+ *  information word holds the entry type in its top bits and the generation
+ *  or the index within the object stream below.
+ *
+ * Offsets which do not fit below XREF_OFFSET_WIDE are held in full in an
+ *  open addressed map keyed by object number and the entry offset is set to
+ *  XREF_OFFSET_WIDE. The map is only allocated once such an entry is added so
+ *  documents smaller than 4GiB keep four byte offsets.
+ *
+ * Damaged or hostile documents can declare a size far larger than the
+ *  objects they hold. Storage is not allocated until the first section is
+ *  parsed and if that section cannot hold enough entries to fill a
+ *  reasonable part of a large table the table is sparse. The entries present
+ *  are then held in an open addressed map keyed by object number which keeps
+ *  memory proportional to them. The table is made dense if enough entries
+ *  are added.
+ *
+ * Parsed objects are held in an open addressed map keyed by object number
+ *  which grows with the number of objects actually used instead of the size
+ *  of the table.
+ */
+struct xref_table {
+    uint32_t declared_size; /**< number of entries declared by the trailer */
+    uint32_t size; /**< number of entries or zero until storage is reserved */
+    uint32_t *offset; /**< offset or object stream number of each entry */
+    uint32_t *info; /**< type and generation or index of each entry */
+
+    uint32_t sparse_count; /**< number of entries in a sparse table */
+    uint32_t sparse_alloc; /**< number of sparse slots, a power of two */
+    struct xref_sparse_slot *sparse; /**< entries or NULL if table is dense */
+
+    uint32_t wide_count; /**< number of entries in the wide offset map */
+    uint32_t wide_alloc; /**< number of wide offset slots, a power of two */
+    struct xref_wide_slot *wide; /**< wide offset map or NULL if unused */
+
+    uint32_t object_count; /**< number of parsed objects in the map */
+    uint32_t object_alloc; /**< number of map slots, a power of two */
+    struct xref_object_slot *objects; /**< parsed object map */
+};
+
+/**
+ * cross reference stream entry decoder
+ *
+ * Entries are decoded a row at a time as the stream data is inflated so the
+ *  decoded stream is never held in full.
+ */
+struct xref_stream_decoder {
+    struct nspdf_doc *doc;
+
+    unsigned int width[XREF_STREAM_FIELDS]; /**< width of each field */
+    unsigned int row_length; /**< bytes in a row including any predictor */
+    bool predictor; /**< rows are preceded by a PNG predictor byte */
+
+    uint8_t row[1 + (XREF_STREAM_FIELDS * XREF_STREAM_FIELD_MAX)];
+    uint8_t prev[1 + (XREF_STREAM_FIELDS * XREF_STREAM_FIELD_MAX)];
+    unsigned int row_fill; /**< bytes of the current row received */
+
+    struct cos_object *index; /**< subsection ranges or NULL for one range */
+    unsigned int index_next; /**< next entry in index */
+    uint64_t objnumber; /**< object number of the next entry */
+    uint64_t remaining; /**< entries remaining in current subsection */
+};
+
+/**
+ * object within an object stream
+ */
+struct xref_objstm_entry {
+    uint64_t id; /**< object number */
+    strmoff_t offset; /**< offset of object within decoded stream data */
+};
+
+/**
+ * decoded object stream
+ */
+struct xref_objstm {
+    uint32_t id; /**< object number of the object stream or zero if unused */
+    uint64_t used; /**< cache clock when the object stream was last used */
+    unsigned int count; /**< number of objects in the object stream */
+    struct xref_objstm_entry *entries; /**< index of objects */
+    struct cos_stream *stream; /**< decoded stream data */
+};
+
+/**
+ * cache of decoded object streams
+ *
+ * Object streams are inflated and indexed once while they remain in the
+ *  cache. The least recently used object stream is evicted when another is
+ *  required.
+ */
+struct xref_objstm_cache {
+    uint64_t clock; /**< incremented on every use of an object stream */
+    bool decoding; /**< an object stream is being decoded */
+    struct xref_objstm slot[XREF_OBJSTM_CACHE_SIZE];
+};
+
+static struct cos_object cos_null_obj = {
+    .type = COS_TYPE_NULL,
+};
+
+nspdferror nspdf__xref_allocate(struct nspdf_doc *doc, int64_t size)
+{
+    struct xref_table *table;
+
+    if (doc->xref_table != NULL) {
+        /** \todo handle freeing xref table */
+        return NSPDFERROR_SYNTAX;
+    }
+
+    if (size < 0) {
+        return NSPDFERROR_RANGE;
+    }
+
+    /* object numbers are limited to 32 bits */
+    if (size > UINT32_MAX) {
+        size = UINT32_MAX;
+    }
+
+    table = calloc(1, sizeof(struct xref_table));
+    if (table == NULL) {
+        return NSPDFERROR_NOMEM;
+    }
+
+    table->objects = calloc(XREF_OBJECT_MAP_INITIAL,
+                            sizeof(struct xref_object_slot));
+    if (table->objects == NULL) {
+        free(table);
+        return NSPDFERROR_NOMEM;
+    }
+    table->declared_size = size;
+    table->object_alloc = XREF_OBJECT_MAP_INITIAL;
+
+    doc->xref_table = table;
+
+    return NSPDFERROR_OK;
+}
+
+nspdferror nspdf__xref_size(struct nspdf_doc *doc, uint32_t *size_out)
+{
+    if (doc->xref_table == NULL) {
+        return NSPDFERROR_NOTFOUND;
+    }
+    *size_out = doc->xref_table->declared_size;
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * reserve storage for a cross reference table before entries are added
+ *
+ * The table is made dense unless it is large and the entries about to be
+ *  added could only fill a small part of it.
+ *
+ * \param table The cross reference table.
+ * \param count The largest number of entries the section being parsed could
+ *               hold.
+ */
+static nspdferror xref_reserve(struct xref_table *table, uint64_t count)
+{
+    if (table->size != 0) {
+        /* storage already reserved */
+        return NSPDFERROR_OK;
+    }
+
+    if ((table->declared_size <= XREF_DENSE_SIZE) ||
+        (count > (table->declared_size / XREF_SPARSE_RATIO))) {
+        table->offset = calloc(table->declared_size, sizeof(uint32_t));
+        table->info = calloc(table->declared_size, sizeof(uint32_t));
+        if ((table->offset == NULL) || (table->info == NULL)) {
+            free(table->offset);
+            free(table->info);
+            table->offset = NULL;
+            table->info = NULL;
+            return NSPDFERROR_NOMEM;
+        }
+    } else {
+        table->sparse = calloc(XREF_SPARSE_INITIAL,
+                               sizeof(struct xref_sparse_slot));
+        if (table->sparse == NULL) {
+            return NSPDFERROR_NOMEM;
+        }
+        table->sparse_alloc = XREF_SPARSE_INITIAL;
+    }
+    table->size = table->declared_size;
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * slot of an object number in a sparse table
+ *
+ * \return The slot holding the entry or the empty slot it would be added to.
+ */
+static inline struct xref_sparse_slot *
+xref_sparse_slot(struct xref_table *table, uint32_t id)
+{
+    uint32_t mask = table->sparse_alloc - 1;
+    uint32_t index;
+
+    index = (id * 0x9e3779b1U) & mask;
+    while ((table->sparse[index].id != id) &&
+           (table->sparse[index].id != 0)) {
+        index = (index + 1) & mask;
+    }
+
+    return &table->sparse[index];
+}
+
+
+/**
+ * double the number of slots in a sparse table
+ */
+static nspdferror xref_sparse_grow(struct xref_table *table)
+{
+    struct xref_sparse_slot *sparse;
+    uint32_t alloc;
+    uint32_t index;
+
+    sparse = table->sparse;
+    alloc = table->sparse_alloc;
+
+    table->sparse = calloc(alloc * 2, sizeof(struct xref_sparse_slot));
+    if (table->sparse == NULL) {
+        table->sparse = sparse;
+        return NSPDFERROR_NOMEM;
+    }
+    table->sparse_alloc = alloc * 2;
+
+    for (index = 0; index < alloc; index++) {
+        if (sparse[index].id != 0) {
+            *xref_sparse_slot(table, sparse[index].id) = sparse[index];
+        }
+    }
+    free(sparse);
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * convert a sparse table into a dense one
+ */
+static nspdferror xref_make_dense(struct xref_table *table)
+{
+    struct xref_sparse_slot *slot;
+    uint32_t index;
+
+    table->offset = calloc(table->size, sizeof(uint32_t));
+    table->info = calloc(table->size, sizeof(uint32_t));
+    if ((table->offset == NULL) || (table->info == NULL)) {
+        free(table->offset);
+        free(table->info);
+        table->offset = NULL;
+        table->info = NULL;
+        return NSPDFERROR_NOMEM;
+    }
+
+    for (index = 0; index < table->sparse_alloc; index++) {
+        slot = &table->sparse[index];
+        if (slot->id != 0) {
+            table->offset[slot->id] = slot->offset;
+            table->info[slot->id] = slot->info;
+        }
+    }
+    free(table->sparse);
+
+    table->sparse = NULL;
+    table->sparse_count = 0;
+    table->sparse_alloc = 0;
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * slot of an object number in the wide offset map
+ *
+ * \return The slot holding the offset or the empty slot it would be added to.
+ */
+static inline struct xref_wide_slot *
+xref_wide_slot(struct xref_table *table, uint32_t id)
+{
+    uint32_t mask = table->wide_alloc - 1;
+    uint32_t index;
+
+    index = (id * 0x9e3779b1U) & mask;
+    while ((table->wide[index].id != id) &&
+           (table->wide[index].id != 0)) {
+        index = (index + 1) & mask;
+    }
+
+    return &table->wide[index];
+}
+
+
+/**
+ * add an offset to the wide offset map
+ *
+ * The map is doubled in size when it becomes half full.
+ */
+static nspdferror
+xref_wide_add(struct xref_table *table, uint32_t id, uint64_t offset)
+{
+    struct xref_wide_slot *wide;
+    struct xref_wide_slot *slot;
+    uint32_t alloc;
+    uint32_t index;
+
+    if ((table->wide_count + 1) > (table->wide_alloc / 2)) {
+        wide = table->wide;
+        alloc = table->wide_alloc;
+
+        table->wide_alloc = alloc * 2;
+        if (table->wide_alloc == 0) {
+            table->wide_alloc = XREF_WIDE_INITIAL;
+        }
+        table->wide = calloc(table->wide_alloc,
+                             sizeof(struct xref_wide_slot));
+        if (table->wide == NULL) {
+            table->wide = wide;
+            table->wide_alloc = alloc;
+            return NSPDFERROR_NOMEM;
+        }
+
+        for (index = 0; index < alloc; index++) {
+            if (wide[index].id != 0) {
+                *xref_wide_slot(table, wide[index].id) = wide[index];
+            }
+        }
+        free(wide);
+    }
+
+    slot = xref_wide_slot(table, id);
+    if (slot->id == 0) {
+        slot->id = id;
+        table->wide_count++;
+    }
+    slot->offset = offset;
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * set a cross reference table entry
+ *
+ * Sections are decoded from the newest so an entry already present is never
+ *  replaced. Entries which are out of range of the table, for object zero
+ *  which is never used or which cannot be represented are ignored.
+ */
+static nspdferror
+xref_set_entry(struct xref_table *table,
+               uint64_t id,
+               enum xref_entry_type type,
+               uint64_t offset,
+               uint64_t value)
+{
+    nspdferror res;
+    struct xref_sparse_slot *slot;
+
+    if ((id == 0) ||
+        (id >= table->size) ||
+        (value > XREF_INFO_VALUE_MAX) ||
+        ((type == XREF_ENTRY_COMPRESSED) && (offset >= table->size))) {
+        /* object zero also marks empty map slots and an object stream
+         *  must itself be an entry of the table
+         */
+        return NSPDFERROR_OK;
+    }
+
+    /* an entry already present is from a newer section */
+    if (table->sparse != NULL) {
+        if (xref_sparse_slot(table, id)->id != 0) {
+            return NSPDFERROR_OK;
+        }
+    } else if (XREF_INFO_TYPE(table->info[id]) != XREF_ENTRY_FREE) {
+        return NSPDFERROR_OK;
+    }
+
+    if (offset >= XREF_OFFSET_WIDE) {
+        res = xref_wide_add(table, id, offset);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+        offset = XREF_OFFSET_WIDE;
+    }
+
+    if (table->sparse != NULL) {
+        if ((table->sparse_count + 1) > (table->size / XREF_SPARSE_RATIO)) {
+            /* a dense table is now no larger */
+            res = xref_make_dense(table);
+            if (res != NSPDFERROR_OK) {
+                return res;
+            }
+        } else {
+            if ((table->sparse_count + 1) > (table->sparse_alloc / 2)) {
+                res = xref_sparse_grow(table);
+                if (res != NSPDFERROR_OK) {
+                    return res;
+                }
+            }
+            slot = xref_sparse_slot(table, id);
+            slot->id = id;
+            table->sparse_count++;
+            slot->offset = offset;
+            slot->info = XREF_INFO(type, value);
+
+            return NSPDFERROR_OK;
+        }
+    }
+
+    table->offset[id] = offset;
+    table->info[id] = XREF_INFO(type, value);
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * get a cross reference table entry
+ *
+ * \param table The cross reference table.
+ * \param id The object number of the entry.
+ * \param offset_out The offset or object stream number of the entry.
+ * \return The information word of the entry which is a free entry if the
+ *          object number is not present.
+ */
+static inline uint32_t
+xref_get_entry(struct xref_table *table, uint32_t id, strmoff_t *offset_out)
+{
+    struct xref_sparse_slot *slot;
+    uint32_t offset;
+    uint32_t info;
+
+    if (id >= table->size) {
+        return XREF_INFO(XREF_ENTRY_FREE, 0);
+    }
+
+    if (table->sparse == NULL) {
+        offset = table->offset[id];
+        info = table->info[id];
+    } else {
+        slot = xref_sparse_slot(table, id);
+        offset = slot->offset;
+        info = slot->info;
+    }
+
+    if (offset == XREF_OFFSET_WIDE) {
+        *offset_out = xref_wide_slot(table, id)->offset;
+    } else {
+        *offset_out = offset;
+    }
+
+    return info;
+}
+
+
+/**
+ * find a cross reference table entry decoding older sections as required
+ *
+ * Sections of the trailer chain are decoded until the entry is present or
+ *  the chain is exhausted.
+ *
+ * \param doc The document.
+ * \param id The object number of the entry.
+ * \param info_out The information word of the entry which is a free entry if
+ *                 the object number is not present in any section.
+ * \param offset_out The offset or object stream number of the entry.
+ * \return NSPDFERROR_OK and the entry updated or the error decoding an older
+ *          section.
+ */
+static nspdferror
+xref_find_entry(struct nspdf_doc *doc,
+                uint32_t id,
+                uint32_t *info_out,
+                strmoff_t *offset_out)
+{
+    nspdferror res;
+    uint32_t info;
+
+    info = xref_get_entry(doc->xref_table, id, offset_out);
+    while ((XREF_INFO_TYPE(info) == XREF_ENTRY_FREE) &&
+           (id < doc->xref_table->size)) {
+        res = nspdf__decode_xref_prev(doc);
+        if (res == NSPDFERROR_NOTFOUND) {
+            break;
+        }
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+        info = xref_get_entry(doc->xref_table, id, offset_out);
+    }
+    *info_out = info;
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * slot of an object number in the parsed object map
+ *
+ * \return The slot holding the object or the empty slot it would be added to.
+ */
+static inline struct xref_object_slot *
+xref_object_slot(struct xref_table *table, uint32_t id)
+{
+    uint32_t mask = table->object_alloc - 1;
+    uint32_t index;
+
+    index = (id * 0x9e3779b1U) & mask;
+    while ((table->objects[index].id != id) &&
+           (table->objects[index].id != 0)) {
+        index = (index + 1) & mask;
+    }
+
+    return &table->objects[index];
+}
+
+
+/**
+ * add a parsed object to the map
+ *
+ * The map is doubled in size when it becomes half full.
+ */
+static nspdferror
+xref_object_add(struct xref_table *table,
+                uint32_t id,
+                struct cos_object *object)
+{
+    struct xref_object_slot *objects;
+    struct xref_object_slot *slot;
+    uint32_t alloc;
+    uint32_t index;
+
+    if ((table->object_count + 1) > (table->object_alloc / 2)) {
+        objects = table->objects;
+        alloc = table->object_alloc;
+
+        table->objects = calloc(alloc * 2, sizeof(struct xref_object_slot));
+        if (table->objects == NULL) {
+            table->objects = objects;
+            return NSPDFERROR_NOMEM;
+        }
+        table->object_alloc = alloc * 2;
+
+        for (index = 0; index < alloc; index++) {
+            if (objects[index].id != 0) {
+                *xref_object_slot(table, objects[index].id) = objects[index];
+            }
+        }
+        free(objects);
+    }
+
+    slot = xref_object_slot(table, id);
+    slot->id = id;
+    slot->object = object;
+    table->object_count++;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * release a decoded object stream
+ */
+static void xref_objstm_release(struct xref_objstm *objstm)
+{
+    if (objstm->stream != NULL) {
+        if (objstm->stream->alloc != 0) {
+            free((void *)objstm->stream->data);
+        }
+        free(objstm->stream);
+    }
+    free(objstm->entries);
+
+    objstm->id = 0;
+    objstm->count = 0;
+    objstm->entries = NULL;
+    objstm->stream = NULL;
+}
+
+nspdferror nspdf__xref_free(struct nspdf_doc *doc)
+{
+    struct xref_table *table;
+    uint64_t index;
+
+    if (doc->objstm_cache != NULL) {
+        for (index = 0; index < XREF_OBJSTM_CACHE_SIZE; index++) {
+            xref_objstm_release(&doc->objstm_cache->slot[index]);
+        }
+        free(doc->objstm_cache);
+        doc->objstm_cache = NULL;
+    }
+
+    table = doc->xref_table;
+    if (table == NULL) {
+        return NSPDFERROR_OK;
+    }
+
+    for (index = 0; index < table->object_alloc; index++) {
+        if (table->objects[index].id != 0) {
+            cos_free_object(table->objects[index].object);
+        }
+    }
+    free(table->objects);
+    free(table->offset);
+    free(table->info);
+    free(table->sparse);
+    free(table->wide);
+    free(table);
+
+    doc->xref_table = NULL;
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * parse a classic cross reference table
+ */
+static nspdferror
+xref_parse_table(struct nspdf_doc *doc,
+                 struct cos_stream *stream,
+                 strmoff_t *offset_out)
+{
+    strmoff_t offset;
+    nspdferror res;
+    uint64_t objnumber; /* current object number */
+    uint64_t objcount;
+
+    offset = *offset_out;
+
+    /* the table cannot hold more entries than the remaining data */
+    res = xref_reserve(doc->xref_table,
+                       (stream->length - offset) / XREF_TABLE_ENTRY_LENGTH);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    /* xref object header */
+    offset += 4;
+
+    res = nspdf__stream_skip_ws(stream, &offset);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    /* subsections
+     * <first object number> <number of references in subsection>
+     */
+    res = nspdf__stream_read_uint(stream, &offset, &objnumber);
+    while (res == NSPDFERROR_OK) {
+        uint64_t lastobj;
+        res = nspdf__stream_skip_ws(stream, &offset);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+
+        res = nspdf__stream_read_uint(stream, &offset, &objcount);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+
+        res = nspdf__stream_skip_ws(stream, &offset);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+
+        //printf("decoding subsection %lld %lld\n", objnumber, objcount);
+
+        lastobj = objnumber + objcount;
+        for (; objnumber < lastobj ; objnumber++) {
+            /* each entry is a fixed format */
+            uint64_t objindex;
+            uint64_t objgeneration;
+
+            /* object index */
+            res = nspdf__stream_read_uint(stream, &offset, &objindex);
+            if (res != NSPDFERROR_OK) {
+                return res;
+            }
+            offset++; /* skip space */
+
+            res = nspdf__stream_read_uint(stream, &offset, &objgeneration);
+            if (res != NSPDFERROR_OK) {
+                return res;
+            }
+            offset++; /* skip space */
+
+            if ((stream_byte(stream, offset++) == 'n')) {
+                res = xref_set_entry(doc->xref_table,
+                                     objnumber,
+                                     XREF_ENTRY_OBJECT,
+                                     objindex,
+                                     objgeneration);
+                if (res != NSPDFERROR_OK) {
+                    return res;
+                }
+            }
+
+            offset += 2; /* skip EOL */
+        }
+
+        res = nspdf__stream_read_uint(stream, &offset, &objnumber);
+    }
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * move to the next subsection of a cross reference stream
+ *
+ * \return NSPDFERROR_OK and the decoder updated with the subsection or
+ *          NSPDFERROR_NOTFOUND when there are no more subsections.
+ */
+static nspdferror xref_stream_subsection(struct xref_stream_decoder *dec)
+{
+    nspdferror res;
+    struct cos_object *value;
+    int64_t first;
+    int64_t count;
+    unsigned int size;
+
+    if (dec->index == NULL) {
+        /* default single subsection has already been used */
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    res = cos_get_array_size(dec->doc, dec->index, &size);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    if ((dec->index_next + 1) >= size) {
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    res = cos_get_array_value(dec->doc, dec->index, dec->index_next, &value);
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_int(dec->doc, value, &first);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_array_value(dec->doc,
+                                  dec->index,
+                                  dec->index_next + 1,
+                                  &value);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_int(dec->doc, value, &count);
+    }
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    if ((first < 0) || (count < 0)) {
+        return NSPDFERROR_RANGE;
+    }
+    dec->index_next += 2;
+
+    dec->objnumber = first;
+    dec->remaining = count;
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * reverse the PNG predictor applied to a cross reference stream row
+ *
+ * Cross reference stream rows are a single byte wide component so the byte to
+ *  the left is the previous byte of the row.
+ */
+static nspdferror xref_stream_unpredict(struct xref_stream_decoder *dec)
+{
+    uint8_t *row = dec->row + 1;
+    const uint8_t *prev = dec->prev + 1;
+    unsigned int length = dec->row_length - 1;
+    unsigned int idx;
+    int left;
+    int up;
+    int upleft;
+    int p;
+
+    switch (dec->row[0]) {
+    case 0: /* none */
+        break;
+
+    case 1: /* sub */
+        for (idx = 1; idx < length; idx++) {
+            row[idx] += row[idx - 1];
+        }
+        break;
+
+    case 2: /* up */
+        for (idx = 0; idx < length; idx++) {
+            row[idx] += prev[idx];
+        }
+        break;
+
+    case 3: /* average */
+        for (idx = 0; idx < length; idx++) {
+            left = (idx > 0) ? row[idx - 1] : 0;
+            row[idx] += (left + prev[idx]) / 2;
+        }
+        break;
+
+    case 4: /* paeth */
+        for (idx = 0; idx < length; idx++) {
+            left = (idx > 0) ? row[idx - 1] : 0;
+            up = prev[idx];
+            upleft = (idx > 0) ? prev[idx - 1] : 0;
+            p = left + up - upleft;
+            if ((abs(p - left) <= abs(p - up)) &&
+                (abs(p - left) <= abs(p - upleft))) {
+                row[idx] += left;
+            } else if (abs(p - up) <= abs(p - upleft)) {
+                row[idx] += up;
+            } else {
+                row[idx] += upleft;
+            }
+        }
+        break;
+
+    default:
+        return NSPDFERROR_FORMAT;
+    }
+
+    memcpy(dec->prev, dec->row, dec->row_length);
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * decode a complete cross reference stream row into the xref table
+ */
+static nspdferror xref_stream_row(struct xref_stream_decoder *dec)
+{
+    nspdferror res;
+    const uint8_t *data;
+    uint64_t field[XREF_STREAM_FIELDS];
+    unsigned int fidx;
+    unsigned int bidx;
+
+    data = dec->row;
+    if (dec->predictor) {
+        res = xref_stream_unpredict(dec);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+        data++;
+    }
+
+    while (dec->remaining == 0) {
+        res = xref_stream_subsection(dec);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+    }
+
+    /* fields are big endian, the type defaults to 1 and others to 0 */
+    for (fidx = 0; fidx < XREF_STREAM_FIELDS; fidx++) {
+        field[fidx] = 0;
+        for (bidx = 0; bidx < dec->width[fidx]; bidx++) {
+            field[fidx] = (field[fidx] << 8) | *data++;
+        }
+    }
+    if (dec->width[0] == 0) {
+        field[0] = 1;
+    }
+
+    if (field[0] == 1) {
+        /* uncompressed object at an offset */
+        res = xref_set_entry(dec->doc->xref_table,
+                             dec->objnumber,
+                             XREF_ENTRY_OBJECT,
+                             field[1],
+                             field[2]);
+    } else if ((field[0] == 2) && (field[1] != 0)) {
+        /* object compressed in an object stream */
+        res = xref_set_entry(dec->doc->xref_table,
+                             dec->objnumber,
+                             XREF_ENTRY_COMPRESSED,
+                             field[1],
+                             field[2]);
+    } else {
+        res = NSPDFERROR_OK;
+    }
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    dec->objnumber++;
+    dec->remaining--;
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * decode cross reference stream data into the xref table
+ */
+static nspdferror
+xref_stream_decode(struct xref_stream_decoder *dec,
+                   const uint8_t *data,
+                   size_t length)
+{
+    nspdferror res;
+    size_t used;
+
+    while (length > 0) {
+        used = dec->row_length - dec->row_fill;
+        if (used > length) {
+            used = length;
+        }
+        memcpy(dec->row + dec->row_fill, data, used);
+        dec->row_fill += used;
+        data += used;
+        length -= used;
+
+        if (dec->row_fill == dec->row_length) {
+            res = xref_stream_row(dec);
+            if (res != NSPDFERROR_OK) {
+                return res;
+            }
+            dec->row_fill = 0;
+        }
+    }
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * inflate cross reference stream data decoding each chunk into the xref table
+ */
+static nspdferror
+xref_stream_inflate(struct xref_stream_decoder *dec,
+                    const uint8_t *data,
+                    strmoff_t length)
+{
+    nspdferror res = NSPDFERROR_OK;
+    uint8_t chunk[XREF_STREAM_CHUNK];
+    z_stream strm;
+    int ret;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = 0;
+    strm.next_in = Z_NULL;
+
+    ret = inflateInit(&strm);
+    if (ret != Z_OK) {
+        return NSPDFERROR_NOMEM;
+    }
+
+    strm.next_in = (void *)data;
+
+    do {
+        /* zlib lengths are limited to unsigned int so feed large input in
+         * sections
+         */
+        if ((strm.avail_in == 0) && (length > 0)) {
+            strm.avail_in = (length > UINT_MAX) ? UINT_MAX : length;
+            length -= strm.avail_in;
+        }
+
+        strm.avail_out = sizeof(chunk);
+        strm.next_out = chunk;
+        ret = inflate(&strm, Z_NO_FLUSH);
+        if ((ret != Z_OK) && (ret != Z_STREAM_END)) {
+            /* corrupt data or input truncated before the end of the
+             * compressed stream
+             */
+            res = NSPDFERROR_FORMAT;
+            break;
+        }
+
+        res = xref_stream_decode(dec, chunk, sizeof(chunk) - strm.avail_out);
+    } while ((res == NSPDFERROR_OK) && (ret != Z_STREAM_END));
+
+    inflateEnd(&strm);
+
+    if (res == NSPDFERROR_NOTFOUND) {
+        /* more rows than the subsections have entries */
+        res = NSPDFERROR_OK;
+    }
+
+    return res;
+}
+
+
+/**
+ * set up a cross reference stream decoder from the stream dictionary
+ */
+static nspdferror
+xref_stream_decoder_init(struct nspdf_doc *doc,
+                         struct cos_object *dict,
+                         struct xref_stream_decoder *dec)
+{
+    nspdferror res;
+    struct cos_object *widths;
+    struct cos_object *value;
+    struct cos_object *parms;
+    unsigned int size;
+    unsigned int idx;
+    int64_t width;
+    int64_t size64;
+    int64_t predictor = 1;
+    int64_t columns = 1;
+
+    dec->doc = doc;
+    dec->row_length = 0;
+    dec->row_fill = 0;
+    dec->index_next = 0;
+
+    res = cos_get_dictionary_array(doc, dict, nspdf__atom_W, &widths);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    res = cos_get_array_size(doc, widths, &size);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    if (size != XREF_STREAM_FIELDS) {
+        return NSPDFERROR_FORMAT;
+    }
+    for (idx = 0; idx < XREF_STREAM_FIELDS; idx++) {
+        res = cos_get_array_value(doc, widths, idx, &value);
+        if (res == NSPDFERROR_OK) {
+            res = cos_get_int(doc, value, &width);
+        }
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+        if ((width < 0) || (width > XREF_STREAM_FIELD_MAX)) {
+            return NSPDFERROR_RANGE;
+        }
+        dec->width[idx] = width;
+        dec->row_length += width;
+    }
+    if (dec->row_length == 0) {
+        return NSPDFERROR_FORMAT;
+    }
+
+    /* optional PNG predictor, the columns must be a whole row */
+    res = cos_get_dictionary_dictionary(doc,
+                                        dict,
+                                        nspdf__atom_DecodeParms,
+                                        &parms);
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_dictionary_int(doc,
+                                     parms,
+                                     nspdf__atom_Predictor,
+                                     &predictor);
+        if (res == NSPDFERROR_OK) {
+            res = cos_get_dictionary_int(doc,
+                                         parms,
+                                         nspdf__atom_Columns,
+                                         &columns);
+        }
+        if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_NOTFOUND)) {
+            return res;
+        }
+    }
+    dec->predictor = false;
+    if (predictor >= 10) {
+        if (columns != dec->row_length) {
+            return NSPDFERROR_FORMAT;
+        }
+        dec->predictor = true;
+        dec->row_length++;
+        memset(dec->prev, 0, sizeof(dec->prev));
+    } else if (predictor != 1) {
+        /* TIFF predictor is not used for cross reference streams */
+        return NSPDFERROR_FORMAT;
+    }
+
+    /* subsections default to every object up to the size */
+    res = cos_get_dictionary_array(doc, dict, nspdf__atom_Index, &dec->index);
+    if (res == NSPDFERROR_NOTFOUND) {
+        res = cos_get_dictionary_int(doc, dict, nspdf__atom_Size, &size64);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+        if (size64 < 0) {
+            return NSPDFERROR_RANGE;
+        }
+        dec->index = NULL;
+        dec->objnumber = 0;
+        dec->remaining = size64;
+    } else if (res != NSPDFERROR_OK) {
+        return res;
+    } else {
+        dec->remaining = 0;
+    }
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * parse a cross reference stream
+ *
+ * The binary entries are decoded straight into the xref table.
+ */
+static nspdferror
+xref_parse_stream(struct nspdf_doc *doc,
+                  struct cos_stream *stream,
+                  strmoff_t *offset_out)
+{
+    nspdferror res;
     strmoff_t offset;
+    struct cos_object *dict;
+    struct cos_object *filter;
+    lwc_string *filter_name = NULL;
+    struct xref_stream_decoder dec;
+    strmoff_t data_offset;
+    strmoff_t length;
+    const uint8_t *encoded;
+    uint8_t *data = NULL;
 
-    /* indirect object if already decoded */
-    struct cos_object *object;
-};
+    offset = *offset_out;
 
-static struct cos_object cos_null_obj = {
-    .type = COS_TYPE_NULL,
-};
+    res = nspdf__xref_parse_stream_dictionary(doc, stream, &offset, &dict);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
 
-nspdferror nspdf__xref_allocate(struct nspdf_doc *doc, int64_t size)
+    res = xref_stream_decoder_init(doc, dict, &dec);
+    if (res != NSPDFERROR_OK) {
+        goto xref_parse_stream_done;
+    }
+
+    res = cos_get_dictionary_value(doc, dict, nspdf__atom_Filter, &filter);
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_name(doc, filter, &filter_name);
+        if ((res != NSPDFERROR_OK) ||
+            (filter_name != nspdf__atom_FlateDecode)) {
+            printf("unsupported cross reference stream filter\n");
+            res = NSPDFERROR_FORMAT;
+            goto xref_parse_stream_done;
+        }
+    }
+
+    res = cos_parse_stream_extent(doc,
+                                  stream,
+                                  &offset,
+                                  dict,
+                                  &data_offset,
+                                  &length);
+    if (res != NSPDFERROR_OK) {
+        goto xref_parse_stream_done;
+    }
+
+    /* the stream cannot hold more rows than its data can encode */
+    res = xref_reserve(doc->xref_table,
+                       (length / dec.row_length) *
+                       ((filter_name != NULL) ? XREF_INFLATE_RATIO : 1));
+    if (res != NSPDFERROR_OK) {
+        goto xref_parse_stream_done;
+    }
+
+    if (stream->source != NULL) {
+        /* stream data is not in memory so must be read from the source */
+        res = nspdf__source_read(stream->source, data_offset, length, &data);
+        if (res != NSPDFERROR_OK) {
+            goto xref_parse_stream_done;
+        }
+        encoded = data;
+    } else {
+        encoded = stream->data + data_offset;
+    }
+
+    if (filter_name != NULL) {
+        res = xref_stream_inflate(&dec, encoded, length);
+    } else {
+        res = xref_stream_decode(&dec, encoded, length);
+        if (res == NSPDFERROR_NOTFOUND) {
+            /* more rows than the subsections have entries */
+            res = NSPDFERROR_OK;
+        }
+    }
+    free(data);
+
+    if (res == NSPDFERROR_OK) {
+        *offset_out = offset;
+    }
+
+xref_parse_stream_done:
+    cos_free_object(dict);
+
+    return res;
+}
+
+
+/**
+ * parse the dictionary of an indirect stream object of a given type
+ */
+static nspdferror
+xref_parse_typed_dictionary(struct nspdf_doc *doc,
+                            struct cos_stream *stream,
+                            strmoff_t *offset_out,
+                            lwc_string *wanted,
+                            struct cos_object **dict_out)
 {
-    if (doc->xref_table != NULL) {
-        /** \todo handle freeing xref table */
+    nspdferror res;
+    strmoff_t offset;
+    uint64_t objnumber;
+    uint64_t generation;
+    struct cos_object *dict;
+    lwc_string *type;
+
+    offset = *offset_out;
+
+    /* indirect object header */
+    res = nspdf__stream_read_uint(stream, &offset, &objnumber);
+    if (res != NSPDFERROR_OK) {
         return NSPDFERROR_SYNTAX;
     }
-    doc->xref_table_size = size;
+    nspdf__stream_skip_ws(stream, &offset);
 
-    doc->xref_table = calloc(doc->xref_table_size,
-                             sizeof(struct xref_table_entry));
-    if (doc->xref_table == NULL) {
-        return NSPDFERROR_NOMEM;
+    res = nspdf__stream_read_uint(stream, &offset, &generation);
+    if (res != NSPDFERROR_OK) {
+        return NSPDFERROR_SYNTAX;
+    }
+    nspdf__stream_skip_ws(stream, &offset);
+
+    if ((stream_byte(stream, offset    ) != 'o') ||
+        (stream_byte(stream, offset + 1) != 'b') ||
+        (stream_byte(stream, offset + 2) != 'j')) {
+        return NSPDFERROR_SYNTAX;
+    }
+    offset += 3;
+    nspdf__stream_skip_ws(stream, &offset);
+
+    /* the stream dictionary is parsed on its own so it is kept */
+    res = cos_parse_object(doc, stream, &offset, &dict);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    res = cos_get_dictionary_name(doc, dict, nspdf__atom_Type, &type);
+    if ((res != NSPDFERROR_OK) || (type != wanted)) {
+        cos_free_object(dict);
+        return NSPDFERROR_SYNTAX;
     }
+
+    *dict_out = dict;
+    *offset_out = offset;
+
     return NSPDFERROR_OK;
 }
 
+
+/* exported interface documented in xref.h */
+nspdferror
+nspdf__xref_parse_stream_dictionary(struct nspdf_doc *doc,
+                                    struct cos_stream *stream,
+                                    strmoff_t *offset_out,
+                                    struct cos_object **dict_out)
+{
+    return xref_parse_typed_dictionary(doc,
+                                       stream,
+                                       offset_out,
+                                       nspdf__atom_XRef,
+                                       dict_out);
+}
+
+
+/* exported interface documented in xref.h */
 nspdferror
 nspdf__xref_parse(struct nspdf_doc *doc,
                   struct cos_stream *stream,
                   strmoff_t *offset_out)
 {
-    strmoff_t offset;
+    if ((stream_byte(stream, *offset_out    ) == 'x') &&
+        (stream_byte(stream, *offset_out + 1) == 'r') &&
+        (stream_byte(stream, *offset_out + 2) == 'e') &&
+        (stream_byte(stream, *offset_out + 3) == 'f')) {
+        return xref_parse_table(doc, stream, offset_out);
+    }
+
+    return xref_parse_stream(doc, stream, offset_out);
+}
+
+
+/**
+ * build the index of the objects in a decoded object stream
+ *
+ * The stream starts with pairs of object number and offset relative to the
+ *  first object.
+ */
+static nspdferror
+xref_objstm_index(struct xref_objstm *objstm, int64_t count, int64_t first)
+{
     nspdferror res;
-    uint64_t objnumber; /* current object number */
-    uint64_t objcount;
+    struct cos_stream *stream = objstm->stream;
+    strmoff_t offset = 0;
+    unsigned int index;
+    uint64_t id;
+    uint64_t relative;
 
-    offset = *offset_out;
+    /* each pair takes at least four bytes */
+    if ((count < 0) ||
+        (first < 0) ||
+        ((uint64_t)count > (stream->length / 4)) ||
+        ((uint64_t)first > stream->length)) {
+        return NSPDFERROR_RANGE;
+    }
 
-    /* xref object header */
-    if ((stream_byte(stream, offset    ) != 'x') ||
-        (stream_byte(stream, offset + 1) != 'r') ||
-        (stream_byte(stream, offset + 2) != 'e') ||
-        (stream_byte(stream, offset + 3) != 'f')) {
-        return NSPDFERROR_SYNTAX;
+    objstm->entries = malloc(count * sizeof(struct xref_objstm_entry));
+    if (objstm->entries == NULL) {
+        return NSPDFERROR_NOMEM;
     }
-    offset += 4;
 
-    res = nspdf__stream_skip_ws(stream, &offset);
+    nspdf__stream_skip_ws(stream, &offset);
+    for (index = 0; index < count; index++) {
+        res = nspdf__stream_read_uint(stream, &offset, &id);
+        if (res == NSPDFERROR_OK) {
+            nspdf__stream_skip_ws(stream, &offset);
+            res = nspdf__stream_read_uint(stream, &offset, &relative);
+        }
+        if ((res != NSPDFERROR_OK) || (offset > (strmoff_t)first)) {
+            return NSPDFERROR_SYNTAX;
+        }
+        nspdf__stream_skip_ws(stream, &offset);
+
+        if (relative >= (stream->length - first)) {
+            return NSPDFERROR_RANGE;
+        }
+        objstm->entries[index].id = id;
+        objstm->entries[index].offset = first + relative;
+    }
+    objstm->count = count;
+
+    return NSPDFERROR_OK;
+}
+
+
+/**
+ * inflate and index an object stream
+ *
+ * \param doc The document.
+ * \param id The object number of the object stream.
+ * \param objstm The unused cache slot to decode the object stream into.
+ */
+static nspdferror
+xref_objstm_decode(struct nspdf_doc *doc,
+                   uint32_t id,
+                   struct xref_objstm *objstm)
+{
+    nspdferror res;
+    struct cos_object *dict;
+    struct cos_object *filter;
+    lwc_string *filter_name;
+    struct cos_stream *stream;
+    strmoff_t offset;
+    strmoff_t data_offset;
+    strmoff_t length;
+    int64_t count;
+    int64_t first;
+    uint8_t *data;
+    uint32_t info;
+    strmoff_t entry_offset;
+
+    /* the object stream must itself be uncompressed */
+    res = xref_find_entry(doc, id, &info, &entry_offset);
     if (res != NSPDFERROR_OK) {
         return res;
     }
+    if (XREF_INFO_TYPE(info) != XREF_ENTRY_OBJECT) {
+        return NSPDFERROR_FORMAT;
+    }
 
-    /* subsections
-     * <first object number> <number of references in subsection>
-     */
-    res = nspdf__stream_read_uint(stream, &offset, &objnumber);
-    while (res == NSPDFERROR_OK) {
-        uint64_t lastobj;
-        res = nspdf__stream_skip_ws(stream, &offset);
-        if (res != NSPDFERROR_OK) {
-            return res;
-        }
+    offset = entry_offset;
+    if (offset >= doc->stream->length) {
+        /* object data has not been supplied yet */
+        return NSPDFERROR_INCOMPLETE;
+    }
 
-        res = nspdf__stream_read_uint(stream, &offset, &objcount);
+    res = xref_parse_typed_dictionary(doc,
+                                      doc->stream,
+                                      &offset,
+                                      nspdf__atom_ObjStm,
+                                      &dict);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    res = cos_get_dictionary_int(doc, dict, nspdf__atom_N, &count);
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_dictionary_int(doc, dict, nspdf__atom_First, &first);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = cos_parse_stream_extent(doc,
+                                      doc->stream,
+                                      &offset,
+                                      dict,
+                                      &data_offset,
+                                      &length);
+    }
+    if (res != NSPDFERROR_OK) {
+        goto xref_objstm_decode_done;
+    }
+
+    stream = calloc(1, sizeof(struct cos_stream));
+    if (stream == NULL) {
+        res = NSPDFERROR_NOMEM;
+        goto xref_objstm_decode_done;
+    }
+    stream->length = length;
+
+    if (doc->stream->source != NULL) {
+        /* stream data is not in memory so must be read from the source */
+        res = nspdf__source_read(doc->stream->source,
+                                 data_offset,
+                                 length,
+                                 &data);
         if (res != NSPDFERROR_OK) {
-            return res;
+            free(stream);
+            goto xref_objstm_decode_done;
         }
+        stream->data = data;
+        stream->alloc = length + STREAM_PADDING;
+    } else {
+        /* stream data is followed by the remainder of the document */
+        stream->data = doc->stream->data + data_offset;
+    }
+    objstm->stream = stream;
 
-        res = nspdf__stream_skip_ws(stream, &offset);
+    res = cos_get_dictionary_value(doc, dict, nspdf__atom_Filter, &filter);
+    if (res == NSPDFERROR_OK) {
+        res = cos_get_name(doc, filter, &filter_name);
+        if (res == NSPDFERROR_OK) {
+            res = nspdf__cos_stream_filter(doc, filter_name, &stream);
+        }
         if (res != NSPDFERROR_OK) {
-            return res;
+            goto xref_objstm_decode_done;
         }
+        objstm->stream = stream;
+    }
 
-        //printf("decoding subsection %lld %lld\n", objnumber, objcount);
+    /* objects parsed from the stream outlive its decoded data */
+    stream->arena = doc->arena;
 
-        lastobj = objnumber + objcount;
-        for (; objnumber < lastobj ; objnumber++) {
-            /* each entry is a fixed format */
-            uint64_t objindex;
-            uint64_t objgeneration;
+    res = xref_objstm_index(objstm, count, first);
+    if (res == NSPDFERROR_OK) {
+        objstm->id = id;
+    }
 
-            /* object index */
-            res = nspdf__stream_read_uint(stream, &offset, &objindex);
-            if (res != NSPDFERROR_OK) {
-                return res;
-            }
-            offset++; /* skip space */
+xref_objstm_decode_done:
+    if (res != NSPDFERROR_OK) {
+        xref_objstm_release(objstm);
+    }
+    cos_free_object(dict);
 
-            res = nspdf__stream_read_uint(stream, &offset, &objgeneration);
-            if (res != NSPDFERROR_OK) {
-                return res;
-            }
-            offset++; /* skip space */
+    return res;
+}
 
-            if ((stream_byte(stream, offset++) == 'n')) {
-                if (objnumber < doc->xref_table_size) {
-                    struct xref_table_entry *indobj;
-                    indobj = doc->xref_table + objnumber;
 
-                    indobj->ref.id = objnumber;
-                    indobj->ref.generation = objgeneration;
-                    indobj->offset = objindex;
+/**
+ * get an object stream from the cache decoding it if necessary
+ */
+static nspdferror
+xref_objstm_get(struct nspdf_doc *doc,
+                uint32_t id,
+                struct xref_objstm **objstm_out)
+{
+    nspdferror res;
+    struct xref_objstm_cache *cache;
+    struct xref_objstm *objstm;
+    unsigned int index;
 
-                    //printf("xref %lld %lld -> %lld\n", objnumber, objgeneration, objindex);
-                } else {
-                    //printf("index out of bounds\n");
-                }
-            }
+    cache = doc->objstm_cache;
+    if (cache == NULL) {
+        cache = calloc(1, sizeof(struct xref_objstm_cache));
+        if (cache == NULL) {
+            return NSPDFERROR_NOMEM;
+        }
+        doc->objstm_cache = cache;
+    }
 
-            offset += 2; /* skip EOL */
+    /* find the object stream or the least recently used slot */
+    objstm = &cache->slot[0];
+    for (index = 0; index < XREF_OBJSTM_CACHE_SIZE; index++) {
+        if (cache->slot[index].id == id) {
+            objstm = &cache->slot[index];
+            break;
+        }
+        if (cache->slot[index].used < objstm->used) {
+            objstm = &cache->slot[index];
+        }
+    }
+
+    if (objstm->id != id) {
+        /* the values in an object stream dictionary may not themselves be
+         * compressed so an object stream is never required while decoding
+         * another.
+         */
+        if (cache->decoding) {
+            return NSPDFERROR_FORMAT;
         }
 
-        res = nspdf__stream_read_uint(stream, &offset, &objnumber);
+        xref_objstm_release(objstm);
+
+        cache->decoding = true;
+        res = xref_objstm_decode(doc, id, objstm);
+        cache->decoding = false;
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
     }
 
+    objstm->used = ++cache->clock;
+    *objstm_out = objstm;
+
     return NSPDFERROR_OK;
 }
 
 
+/**
+ * parse an object compressed in an object stream
+ *
+ * \param doc The document.
+ * \param id The object number of the compressed object.
+ * \param stream The object number of the object stream holding the object.
+ * \param index The index of the object within the object stream.
+ * \param cobj_out The parsed object.
+ */
+static nspdferror
+xref_parse_compressed(struct nspdf_doc *doc,
+                      uint32_t id,
+                      uint32_t stream,
+                      uint32_t index,
+                      struct cos_object **cobj_out)
+{
+    nspdferror res;
+    struct xref_objstm *objstm;
+    strmoff_t offset;
+
+    res = xref_objstm_get(doc, stream, &objstm);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    if ((index >= objstm->count) || (objstm->entries[index].id != id)) {
+        printf("object %u not at index %u of object stream %u\n",
+               id,
+               index,
+               stream);
+        return NSPDFERROR_FORMAT;
+    }
+
+    offset = objstm->entries[index].offset;
+
+    return cos_parse_object(doc, objstm->stream, &offset, cobj_out);
+}
+
+
 nspdferror
 nspdf__xref_get_referenced(struct nspdf_doc *doc, struct cos_object **cobj_out)
 {
@@ -151,7 +1683,11 @@ nspdf__xref_get_referenced(struct nspdf_doc *doc, struct cos_object **cobj_out)
     struct cos_object *cobj;
     struct cos_object *indirect;
     strmoff_t offset;
-    struct xref_table_entry *entry;
+    struct xref_table *table;
+    struct xref_object_slot *slot;
+    uint32_t id;
+    uint32_t info;
+    strmoff_t entry_offset;
 
     cobj = *cobj_out;
 
@@ -165,31 +1701,76 @@ nspdf__xref_get_referenced(struct nspdf_doc *doc, struct cos_object **cobj_out)
         return NSPDFERROR_REFERENCE;
     }
 
-    entry = doc->xref_table + cobj->u.reference->id;
+    table = doc->xref_table;
+    id = cobj->u.reference.id;
 
     /* check if referenced object is in range and exists. return null object if
      * not
      */
-    if ((cobj->u.reference->id >= doc->xref_table_size) ||
-        (cobj->u.reference->id == 0) ||
-        (entry->ref.id == 0)) {
+    if ((table == NULL) || (id == 0)) {
         *cobj_out = &cos_null_obj;
         return NSPDFERROR_OK;
     }
+    res = xref_find_entry(doc, id, &info, &entry_offset);
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+    if (XREF_INFO_TYPE(info) == XREF_ENTRY_FREE) {
+        *cobj_out = &cos_null_obj;
+        return NSPDFERROR_OK;
+    }
+
+    slot = xref_object_slot(table, id);
+    if (slot->id != 0) {
+        *cobj_out = slot->object;
+        return NSPDFERROR_OK;
+    }
+
+    /* parsing an object may dereference others, such as a stream length,
+     * on the C stack so the nesting is limited to stop a reference to the
+     * object being parsed recursing without end.
+     */
+    if (doc->reference_depth >= doc->max_depth) {
+        return NSPDFERROR_RANGE;
+    }
+    doc->reference_depth++;
 
-    if (entry->object == NULL) {
+    if (XREF_INFO_TYPE(info) == XREF_ENTRY_COMPRESSED) {
+        /* compressed object has never been parsed */
+        res = xref_parse_compressed(doc,
+                                    id,
+                                    entry_offset,
+                                    XREF_INFO_VALUE(info),
+                                    &indirect);
+    } else if (entry_offset >= doc->stream->length) {
+        /* object data has not been supplied yet */
+        res = NSPDFERROR_INCOMPLETE;
+    } else {
         /* indirect object has never been parsed */
-        offset = entry->offset;
+        offset = entry_offset;
         res = cos_parse_object(doc, doc->stream, &offset, &indirect);
-        if (res != NSPDFERROR_OK) {
-            //printf("failed to decode indirect object\n");
-            return res;
-        }
+    }
+    doc->reference_depth--;
+    if (res != NSPDFERROR_OK) {
+        return res;
+    }
+
+    /* a nested dereference may have already added the object */
+    slot = xref_object_slot(table, id);
+    if (slot->id != 0) {
+        cos_free_object(indirect);
+        *cobj_out = slot->object;
+        return NSPDFERROR_OK;
+    }
 
-        entry->object = indirect;
+    /* parsing may have added other objects so the slot is found again */
+    res = xref_object_add(table, id, indirect);
+    if (res != NSPDFERROR_OK) {
+        cos_free_object(indirect);
+        return res;
     }
 
-    *cobj_out = entry->object;
+    *cobj_out = indirect;
 
     return NSPDFERROR_OK;
 }
@@ -22,10 +22,29 @@ struct cos_object;
 
 /**
  * parse xref from file
+ *
+ * Both classic cross reference tables and cross reference streams are
+ *  decoded into the xref table.
  */
 nspdferror nspdf__xref_parse(struct nspdf_doc *doc, struct cos_stream *stream, strmoff_t *offset_out);
 
 
+/**
+ * parse the dictionary of a cross reference stream
+ *
+ * The dictionary holds the trailer entries for the cross reference section.
+ *
+ * \param doc The document.
+ * \param stream The stream to parse.
+ * \param offset_out The offset of the cross reference stream object, updated
+ *                   to the offset following its dictionary.
+ * \param dict_out The stream dictionary.
+ * \return NSPDFERROR_OK on success or NSPDFERROR_SYNTAX if there is no cross
+ *          reference stream at the offset.
+ */
+nspdferror nspdf__xref_parse_stream_dictionary(struct nspdf_doc *doc, struct cos_stream *stream, strmoff_t *offset_out, struct cos_object **dict_out);
+
+
 /**
  * get an object dereferencing through xref table if necessary
  */
@@ -33,7 +52,26 @@ nspdferror nspdf__xref_get_referenced(struct nspdf_doc *doc, struct cos_object *
 
 /**
  * allocate storage for cross reference table
+ *
+ * Storage for the entries is reserved when the first section is parsed so
+ *  the table can be sparse if the declared size is far larger than the
+ *  entries present.
  */
 nspdferror nspdf__xref_allocate(struct nspdf_doc *doc, int64_t size);
 
+/**
+ * get the number of entries declared for the cross reference table
+ *
+ * \param doc The document.
+ * \param size_out The declared number of entries.
+ * \return NSPDFERROR_OK and size_out updated or NSPDFERROR_NOTFOUND if there
+ *          is no cross reference table.
+ */
+nspdferror nspdf__xref_size(struct nspdf_doc *doc, uint32_t *size_out);
+
+/**
+ * free cross reference table and any objects decoded through it
+ */
+nspdferror nspdf__xref_free(struct nspdf_doc *doc);
+
 #endif
@@ -0,0 +1,1255 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/*
+ * Parser hot path benchmarks
+ *
+ * Runs the internal lexer and cross reference table parser over synthetic
+ *  input of a typical size and reports the time per operation. The optional
+ *  arguments are the number of iterations of each benchmark and a file of
+ *  uncompressed content stream data to use for the whitespace benchmark.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <nspdf/document.h>
+
+#include "cos_stream.h"
+#include "cos_object.h"
+#include "cos_content.h"
+#include "cos_parse.h"
+#include "xref.h"
+#include "pdf_doc.h"
+#include "byte_class.h"
+#include "arena.h"
+#include "atom.h"
+
+/** number of objects in synthetic lexer input */
+#define LEXER_OBJECTS 10000
+
+/** number of dictionary lookups per iteration */
+#define DICTIONARY_LOOKUPS 100000
+
+/** number of entries in synthetic resource dictionary */
+#define RESOURCE_ENTRIES 256
+
+/** number of glyph widths in synthetic font widths arrays */
+#define WIDTHS_ENTRIES 224
+
+/** number of synthetic font widths arrays */
+#define WIDTHS_ARRAYS 1000
+
+/** number of decoded bytes in each synthetic hex string */
+#define HEX_STRING_BYTES 8192
+
+/** number of synthetic hex strings */
+#define HEX_STRINGS 100
+
+/** number of lines of text in each synthetic literal string */
+#define LITERAL_STRING_LINES 128
+
+/** number of synthetic literal strings */
+#define LITERAL_STRINGS 100
+
+/** number of values in each synthetic large array */
+#define LARGE_ARRAY_ENTRIES 8192
+
+/** number of synthetic large arrays */
+#define LARGE_ARRAYS 100
+
+/** number of blocks of operations in synthetic content stream */
+#define CONTENT_BLOCKS 10000
+
+/** number of entries in synthetic cross reference table */
+#define XREF_ENTRIES 100000
+
+/** number of object streams in object stream benchmark */
+#define OBJSTM_STREAMS 100
+
+/** number of objects in each object stream */
+#define OBJSTM_OBJECTS 100
+
+/** cross reference size of object stream benchmark */
+#define OBJSTM_SIZE ((OBJSTM_STREAMS * (OBJSTM_OBJECTS + 1)) + 2)
+
+/** number of incremental updates in document open benchmark */
+#define INCREMENTAL_UPDATES 200
+
+/**
+ * growable synthetic input buffer
+ */
+struct bench_buffer {
+    uint8_t *data;
+    size_t length;
+    size_t alloc;
+};
+
+static void buffer_append(struct bench_buffer *buf, const char *fmt, ...)
+{
+    va_list ap;
+    int len;
+
+    if ((buf->alloc - buf->length) < 256) {
+        buf->alloc = (buf->alloc * 2) + 4096;
+        buf->data = realloc(buf->data, buf->alloc);
+        if (buf->data == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+
+    va_start(ap, fmt);
+    len = vsnprintf((char *)buf->data + buf->length,
+                    buf->alloc - buf->length,
+                    fmt,
+                    ap);
+    va_end(ap);
+
+    buf->length += len;
+}
+
+/**
+ * append binary data to a buffer
+ */
+static void
+buffer_append_data(struct bench_buffer *buf, const void *data, size_t length)
+{
+    while ((buf->alloc - buf->length) < (length + 256)) {
+        buf->alloc = (buf->alloc * 2) + 4096;
+        buf->data = realloc(buf->data, buf->alloc);
+        if (buf->data == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+
+    memcpy(buf->data + buf->length, data, length);
+    buf->length += length;
+}
+
+/**
+ * set a stream to the buffer contents with the padding streams require
+ */
+static void buffer_stream(struct bench_buffer *buf, struct cos_stream *stream)
+{
+    buffer_append(buf, "%*s", STREAM_PADDING, "");
+    buf->length -= STREAM_PADDING;
+    stream_pad(buf->data + buf->length);
+
+    stream->data = buf->data;
+    stream->length = buf->length;
+    stream->alloc = 0;
+    stream->source = NULL;
+    stream->arena = NULL;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1000000000.0);
+}
+
+static void
+report(const char *name, double elapsed, uint64_t ops, uint64_t bytes)
+{
+    printf("%-18s %10.2f ns/op %10.2f MB/s\n",
+           name,
+           (elapsed * 1000000000.0) / ops,
+           (bytes / (1024.0 * 1024.0)) / elapsed);
+}
+
+/** whitespace skipping implementation */
+typedef nspdferror (skip_ws_fn)(struct cos_stream *stream, strmoff_t *offset);
+
+/**
+ * time a whitespace skip over every token separator in a stream
+ */
+static void
+time_skip_ws(const char *name,
+             skip_ws_fn *skip_ws,
+             struct cos_stream *stream,
+             unsigned int iterations)
+{
+    unsigned int iteration;
+    strmoff_t offset;
+    uint64_t ops = 0;
+    double start;
+
+    start = time_now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+        offset = 0;
+        while (offset < stream->length) {
+            skip_ws(stream, &offset);
+            /* token */
+            while ((offset < stream->length) &&
+                   ((bclass[stream->data[offset]] & (BC_WSPC | BC_CMNT)) == 0)) {
+                offset++;
+            }
+            ops++;
+        }
+    }
+    report(name, time_now() - start, ops, (uint64_t)stream->length * iterations);
+}
+
+/**
+ * read a file of uncompressed content stream data
+ */
+static nspdferror read_content(const char *filename, struct bench_buffer *buf)
+{
+    FILE *f;
+    size_t rd;
+
+    f = fopen(filename, "rb");
+    if (f == NULL) {
+        printf("unable to open %s\n", filename);
+        return NSPDFERROR_NOTFOUND;
+    }
+    do {
+        buffer_append(buf, "%s", "");
+        rd = fread(buf->data + buf->length, 1, buf->alloc - buf->length, f);
+        buf->length += rd;
+    } while (rd > 0);
+    fclose(f);
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * whitespace and comment skipping between tokens
+ *
+ * Compares the block and bytewise skips on tokens separated by comments and
+ *  on content stream data. Content is read from content_file if given
+ *  otherwise a synthetic stream in the deeply indented style of CAD exports
+ *  is used.
+ */
+static nspdferror
+bench_skip_ws(unsigned int iterations, const char *content_file)
+{
+    struct bench_buffer buf = { NULL, 0, 0 };
+    struct bench_buffer content = { NULL, 0, 0 };
+    struct cos_stream stream;
+    unsigned int index;
+    nspdferror res;
+
+    for (index = 0; index < LEXER_OBJECTS; index++) {
+        buffer_append(&buf, " \r\n\t %% comment %u\n  x", index);
+    }
+    buffer_stream(&buf, &stream);
+
+    time_skip_ws("skip_ws", nspdf__stream_skip_ws, &stream, iterations);
+    time_skip_ws("skip_ws_bytewise",
+                 nspdf__stream_skip_ws_bytewise,
+                 &stream,
+                 iterations);
+
+    if (content_file != NULL) {
+        res = read_content(content_file, &content);
+        if (res != NSPDFERROR_OK) {
+            free(buf.data);
+            free(content.data);
+            return res;
+        }
+    } else {
+        for (index = 0; index < LEXER_OBJECTS; index++) {
+            buffer_append(&content,
+                          "        q\n"
+                          "            %u.%03u %u.%03u m\n"
+                          "            %u.%03u %u.%03u l\n"
+                          "            0.25 w    0 0 0 RG\n"
+                          "            S\n"
+                          "        Q\n",
+                          index % 612, index % 1000, index % 792, index % 999,
+                          index % 600, index % 997, index % 780, index % 996);
+        }
+    }
+    buffer_stream(&content, &stream);
+
+    time_skip_ws("content", nspdf__stream_skip_ws, &stream, iterations);
+    time_skip_ws("content_bytewise",
+                 nspdf__stream_skip_ws_bytewise,
+                 &stream,
+                 iterations);
+
+    free(buf.data);
+    free(content.data);
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * parse of a sequence of typical dictionary objects
+ *
+ * If use_arena is set the objects are allocated from a region which is
+ *  released after each iteration as a document does instead of being freed
+ *  individually.
+ */
+static nspdferror
+bench_lexer(struct nspdf_doc *doc, unsigned int iterations, bool use_arena)
+{
+    struct bench_buffer buf = { NULL, 0, 0 };
+    struct cos_stream stream;
+    struct cos_object *cobj;
+    unsigned int iteration;
+    unsigned int index;
+    strmoff_t offset;
+    uint64_t ops = 0;
+    nspdferror res;
+    double start;
+
+    for (index = 0; index < LEXER_OBJECTS; index++) {
+        buffer_append(&buf,
+                      "<< /Type /Page /Parent %u 0 R /MediaBox [0 0 612 792] "
+                      "/Rotate %u /UserUnit 1.25 /Title (Page %u) "
+                      "/ID <0123456789abcdef> /Hidden false >>\n",
+                      index + 1, index % 4 * 90, index);
+    }
+
+    buffer_stream(&buf, &stream);
+
+    start = time_now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+        if (use_arena) {
+            res = nspdf__arena_create(&stream.arena);
+            if (res != NSPDFERROR_OK) {
+                free(buf.data);
+                return res;
+            }
+        }
+        offset = 0;
+        while (offset < stream.length) {
+            res = cos_parse_object(doc, &stream, &offset, &cobj);
+            if (res != NSPDFERROR_OK) {
+                printf("lexer failed at %" PRIu64 " (%d)\n",
+                       (uint64_t)offset, res);
+                if (stream.arena != NULL) {
+                    nspdf__arena_destroy(stream.arena);
+                }
+                free(buf.data);
+                return res;
+            }
+            cos_free_object(cobj);
+            ops++;
+        }
+        if (use_arena) {
+            nspdf__arena_destroy(stream.arena);
+            stream.arena = NULL;
+        }
+    }
+    report(use_arena ? "parse_object_arena" : "parse_object",
+           time_now() - start,
+           ops,
+           (uint64_t)buf.length * iterations);
+
+    free(buf.data);
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * time tokenising a content stream into operations
+ *
+ * The resident size of each packed operation is reported against the fixed
+ *  size decoded form.
+ */
+static nspdferror
+time_content(const char *name,
+             struct nspdf_doc *doc,
+             struct bench_buffer *buf,
+             unsigned int iterations)
+{
+    struct cos_stream stream;
+    struct cos_stream *streams = &stream;
+    struct cos_object *content;
+    unsigned int iteration;
+    uint64_t ops = 0;
+    uint64_t size = 0;
+    nspdferror res;
+    double start;
+
+    buffer_stream(buf, &stream);
+
+    start = time_now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+        res = cos_parse_content_streams(doc, &streams, 1, &content);
+        if (res != NSPDFERROR_OK) {
+            printf("%s failed (%d)\n", name, res);
+            return res;
+        }
+        ops += content->u.content->length;
+        size += content->u.content->size;
+        cos_free_object(content);
+    }
+    report(name, time_now() - start, ops, (uint64_t)buf->length * iterations);
+
+    printf("%-18s %10.2f bytes/op %7u bytes/op unpacked\n",
+           name,
+           (double)size / ops,
+           (unsigned int)sizeof(struct content_operation));
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * tokenise content streams into operations
+ *
+ * A typical mix of graphics and text operations is followed by a stream
+ *  dense in operators which take no operands and streams shaped like map
+ *  and CAD drawings which are mostly path construction.
+ */
+static nspdferror bench_content(struct nspdf_doc *doc, unsigned int iterations)
+{
+    struct bench_buffer buf = { NULL, 0, 0 };
+    struct bench_buffer dense = { NULL, 0, 0 };
+    struct bench_buffer map = { NULL, 0, 0 };
+    struct bench_buffer cad = { NULL, 0, 0 };
+    unsigned int index;
+    unsigned int point;
+    nspdferror res;
+
+    for (index = 0; index < CONTENT_BLOCKS; index++) {
+        buffer_append(&buf,
+                      "q 1 0 0 1 %u.%02u %u.%02u cm /GS%u gs\n"
+                      "0.5 0.25 0 rg %u %u 120.5 -14 re f\n"
+                      "%u.5 %u m %u %u.25 l %u %u %u %u %u %u c S\n"
+                      "BT /F%u 12 Tf 14.4 TL %u %u Td (Item %u) Tj "
+                      "[(W) 120 (orld) -250.5 <0041>] TJ T* ET Q\n",
+                      index % 612, index % 100, index % 792, index % 99,
+                      index % 8, index % 600, index % 780,
+                      index % 500, index % 700, index % 400, index % 650,
+                      index % 10, index % 20, index % 30, index % 40,
+                      index % 50, index % 60,
+                      index % 4, index % 300, index % 700, index % 1000);
+        buffer_append(&dense,
+                      "q BT ET Q n h S s f F f* B B* b b* W W* n\n"
+                      "BX EX q h W n Q T* EMC BI ID EI\n");
+
+        /* map feature: styled polyline, occasionally a filled area */
+        buffer_append(&map,
+                      "q 0.%u 0.5 0.%u RG %u.5 w 1 J 1 j %u.%02u %u.%02u m\n",
+                      index % 10, index % 7, index % 3,
+                      index % 612, index % 100, index % 792, index % 99);
+        for (point = 0; point < 12; point++) {
+            buffer_append(&map, "%u.%02u %u.%02u l\n",
+                          (index + point * 7) % 612, point * 3,
+                          (index + point * 11) % 792, point * 5);
+        }
+        buffer_append(&map, (index & 7) == 0 ? "h f Q\n" : "S Q\n");
+
+        /* CAD drawing: short segments, rectangles and dashed lines */
+        buffer_append(&cad,
+                      "%u %u m %u %u l S\n"
+                      "%u %u m %u %u l %u %u l h S\n"
+                      "%u %u %u %u re S\n"
+                      "q [3 2] 0 d 0.25 w %u %u m %u %u l S Q\n",
+                      index % 600, index % 700, index % 610, index % 700,
+                      index % 500, index % 400, index % 520, index % 420,
+                      index % 500, index % 440,
+                      index % 300, index % 200, 10 + (index % 40), 5,
+                      index % 600, index % 100, index % 600, index % 780);
+    }
+
+    res = time_content("content_parse", doc, &buf, iterations);
+    if (res == NSPDFERROR_OK) {
+        res = time_content("content_operators", doc, &dense, iterations);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = time_content("content_map", doc, &map, iterations);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = time_content("content_cad", doc, &cad, iterations);
+    }
+
+    free(buf.data);
+    free(dense.data);
+    free(map.data);
+    free(cad.data);
+
+    return res;
+}
+
+/**
+ * lookup of keys in a typical page dictionary
+ */
+static nspdferror
+bench_dictionary(struct nspdf_doc *doc, unsigned int iterations)
+{
+    struct bench_buffer buf = { NULL, 0, 0 };
+    struct cos_stream stream;
+    struct cos_object *dict;
+    struct cos_object *value;
+    lwc_string *keys[4];
+    unsigned int iteration;
+    unsigned int index;
+    strmoff_t offset = 0;
+    uint64_t found = 0;
+    nspdferror res;
+    double start;
+
+    buffer_append(&buf,
+                  "<< /Type /Page /Parent 3 0 R /MediaBox [0 0 612 792] "
+                  "/CropBox [0 0 612 792] /Rotate 90 /UserUnit 1.25 "
+                  "/Resources 4 0 R /Annots [] /Group 5 0 R /Tabs /S "
+                  "/StructParents 0 /Contents 6 0 R >>\n");
+    buffer_stream(&buf, &stream);
+
+    res = cos_parse_object(doc, &stream, &offset, &dict);
+    if (res != NSPDFERROR_OK) {
+        free(buf.data);
+        return res;
+    }
+
+    /* a mix of early, late and absent keys */
+    keys[0] = nspdf__atom_Type;
+    keys[1] = nspdf__atom_Resources;
+    keys[2] = nspdf__atom_Contents;
+    keys[3] = nspdf__atom_Kids;
+
+    start = time_now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+        for (index = 0; index < DICTIONARY_LOOKUPS; index++) {
+            res = cos_get_dictionary_value(NULL,
+                                           dict,
+                                           keys[index & 3],
+                                           &value);
+            if (res == NSPDFERROR_OK) {
+                found++;
+            }
+        }
+    }
+    report("dictionary_get",
+           time_now() - start,
+           (uint64_t)DICTIONARY_LOOKUPS * iterations,
+           0);
+
+    res = NSPDFERROR_OK;
+    if (found != ((uint64_t)DICTIONARY_LOOKUPS * iterations * 3) / 4) {
+        printf("dictionary lookup found %" PRIu64 " keys\n", found);
+        res = NSPDFERROR_NOTFOUND;
+    }
+
+    cos_free_object(dict);
+    free(buf.data);
+
+    return res;
+}
+
+/**
+ * lookup of keys in a large font resource dictionary
+ */
+static nspdferror
+bench_resources(struct nspdf_doc *doc, unsigned int iterations)
+{
+    struct bench_buffer buf = { NULL, 0, 0 };
+    struct cos_stream stream;
+    struct cos_object *dict;
+    struct cos_object *value;
+    lwc_string *keys[RESOURCE_ENTRIES];
+    char name[16];
+    unsigned int iteration;
+    unsigned int index;
+    strmoff_t offset = 0;
+    nspdferror res;
+    double start;
+
+    buffer_append(&buf, "<<");
+    for (index = 0; index < RESOURCE_ENTRIES; index++) {
+        buffer_append(&buf, " /F%u %u 0 R", index, index + 10);
+    }
+    buffer_append(&buf, " >>\n");
+    buffer_stream(&buf, &stream);
+
+    res = cos_parse_object(doc, &stream, &offset, &dict);
+    if (res != NSPDFERROR_OK) {
+        free(buf.data);
+        return res;
+    }
+
+    for (index = 0; index < RESOURCE_ENTRIES; index++) {
+        snprintf(name, sizeof(name), "F%u", index);
+        lwc_intern_string(name, strlen(name), &keys[index]);
+    }
+
+    start = time_now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+        for (index = 0; index < DICTIONARY_LOOKUPS; index++) {
+            unsigned int key = (index * 7) % RESOURCE_ENTRIES;
+
+            res = cos_get_dictionary_value(NULL, dict, keys[key], &value);
+            if ((res != NSPDFERROR_OK) ||
+                (value->type != COS_TYPE_REFERENCE) ||
+                (value->u.reference.id != (key + 10))) {
+                printf("resource lookup of F%u failed\n", key);
+                res = NSPDFERROR_NOTFOUND;
+                goto bench_resources_done;
+            }
+        }
+    }
+    report("dictionary_large",
+           time_now() - start,
+           (uint64_t)DICTIONARY_LOOKUPS * iterations,
+           0);
+
+bench_resources_done:
+    for (index = 0; index < RESOURCE_ENTRIES; index++) {
+        lwc_string_unref(keys[index]);
+    }
+    cos_free_object(dict);
+    free(buf.data);
+
+    return res;
+}
+
+/**
+ * parse of font widths arrays and retrieval of every width
+ */
+static nspdferror bench_widths(struct nspdf_doc *doc, unsigned int iterations)
+{
+    struct bench_buffer buf = { NULL, 0, 0 };
+    struct cos_stream stream;
+    struct cos_object *array;
+    struct cos_object *value;
+    unsigned int iteration;
+    unsigned int index;
+    strmoff_t offset;
+    int64_t width;
+    int64_t total = 0;
+    int64_t expected = 0;
+    nspdferror res;
+    double start;
+
+    for (index = 0; index < WIDTHS_ARRAYS; index++) {
+        unsigned int entry;
+
+        buffer_append(&buf, "[");
+        for (entry = 0; entry < WIDTHS_ENTRIES; entry++) {
+            buffer_append(&buf, " %u", 250 + ((index + entry) % 750));
+            expected += 250 + ((index + entry) % 750);
+        }
+        buffer_append(&buf, " ]\n");
+    }
+    buffer_stream(&buf, &stream);
+
+    start = time_now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+        offset = 0;
+        while (offset < stream.length) {
+            res = cos_parse_object(doc, &stream, &offset, &array);
+            if (res != NSPDFERROR_OK) {
+                printf("widths parse failed at %" PRIu64 " (%d)\n",
+                       (uint64_t)offset, res);
+                free(buf.data);
+                return res;
+            }
+            for (index = 0; index < WIDTHS_ENTRIES; index++) {
+                res = cos_get_array_value(NULL, array, index, &value);
+                if (res == NSPDFERROR_OK) {
+                    res = cos_get_int(NULL, value, &width);
+                }
+                if (res != NSPDFERROR_OK) {
+                    printf("width %u could not be retrieved (%d)\n",
+                           index, res);
+                    cos_free_object(array);
+                    free(buf.data);
+                    return res;
+                }
+                total += width;
+            }
+            cos_free_object(array);
+        }
+    }
+    report("array_widths",
+           time_now() - start,
+           (uint64_t)WIDTHS_ARRAYS * iterations,
+           (uint64_t)buf.length * iterations);
+
+    res = NSPDFERROR_OK;
+    if (total != (expected * iterations)) {
+        printf("widths total %" PRId64 " expected %" PRId64 "\n",
+               total, expected * iterations);
+        res = NSPDFERROR_RANGE;
+    }
+
+    free(buf.data);
+
+    return res;
+}
+
+/**
+ * parse of long hex and literal strings and large arrays
+ *
+ * These are built up value by value so show the cost of growing containers.
+ *  The literal strings are text with an occasional escape or end of line.
+ */
+static nspdferror
+bench_containers(struct nspdf_doc *doc, unsigned int iterations)
+{
+    struct bench_buffer strings = { NULL, 0, 0 };
+    struct bench_buffer literals = { NULL, 0, 0 };
+    struct bench_buffer arrays = { NULL, 0, 0 };
+    struct cos_stream stream;
+    struct cos_object *cobj;
+    unsigned int iteration;
+    unsigned int index;
+    unsigned int entry;
+    strmoff_t offset;
+    nspdferror res = NSPDFERROR_OK;
+    double start;
+
+    for (index = 0; index < HEX_STRINGS; index++) {
+        buffer_append(&strings, "<");
+        for (entry = 0; entry < HEX_STRING_BYTES; entry++) {
+            buffer_append(&strings, "%02x", (index + entry) & 0xff);
+        }
+        buffer_append(&strings, ">\n");
+    }
+    buffer_stream(&strings, &stream);
+
+    start = time_now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+        offset = 0;
+        while (offset < stream.length) {
+            res = cos_parse_object(doc, &stream, &offset, &cobj);
+            if (res != NSPDFERROR_OK) {
+                printf("hex string parse failed (%d)\n", res);
+                goto bench_containers_done;
+            }
+            if ((cobj->type != COS_TYPE_STRING) ||
+                (cobj->u.s->length != HEX_STRING_BYTES)) {
+                printf("hex string was not decoded\n");
+                cos_free_object(cobj);
+                res = NSPDFERROR_SYNTAX;
+                goto bench_containers_done;
+            }
+            cos_free_object(cobj);
+        }
+    }
+    report("hex_string",
+           time_now() - start,
+           (uint64_t)HEX_STRINGS * iterations,
+           (uint64_t)strings.length * iterations);
+
+    for (index = 0; index < LITERAL_STRINGS; index++) {
+        buffer_append(&literals, "(");
+        for (entry = 0; entry < LITERAL_STRING_LINES; entry++) {
+            buffer_append(&literals,
+                          "The quick brown fox \\(number %u\\) jumps over "
+                          "the lazy dog.\n",
+                          entry);
+        }
+        buffer_append(&literals, ")\n");
+    }
+    buffer_stream(&literals, &stream);
+
+    start = time_now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+        offset = 0;
+        while (offset < stream.length) {
+            res = cos_parse_object(doc, &stream, &offset, &cobj);
+            if (res != NSPDFERROR_OK) {
+                printf("literal string parse failed (%d)\n", res);
+                goto bench_containers_done;
+            }
+            if (cobj->type != COS_TYPE_STRING) {
+                printf("literal string was not decoded\n");
+                cos_free_object(cobj);
+                res = NSPDFERROR_SYNTAX;
+                goto bench_containers_done;
+            }
+            cos_free_object(cobj);
+        }
+    }
+    report("literal_string",
+           time_now() - start,
+           (uint64_t)LITERAL_STRINGS * iterations,
+           (uint64_t)literals.length * iterations);
+
+    for (index = 0; index < LARGE_ARRAYS; index++) {
+        buffer_append(&arrays, "[");
+        for (entry = 0; entry < LARGE_ARRAY_ENTRIES; entry++) {
+            buffer_append(&arrays, " %u", entry);
+        }
+        buffer_append(&arrays, " ]\n");
+    }
+    buffer_stream(&arrays, &stream);
+
+    start = time_now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+        offset = 0;
+        while (offset < stream.length) {
+            res = cos_parse_object(doc, &stream, &offset, &cobj);
+            if (res != NSPDFERROR_OK) {
+                printf("large array parse failed (%d)\n", res);
+                goto bench_containers_done;
+            }
+            if ((cobj->type != COS_TYPE_ARRAY) ||
+                (cobj->u.array->length != LARGE_ARRAY_ENTRIES)) {
+                printf("large array was not decoded\n");
+                cos_free_object(cobj);
+                res = NSPDFERROR_SYNTAX;
+                goto bench_containers_done;
+            }
+            cos_free_object(cobj);
+        }
+    }
+    report("array_large",
+           time_now() - start,
+           (uint64_t)LARGE_ARRAYS * iterations,
+           (uint64_t)arrays.length * iterations);
+
+bench_containers_done:
+    free(strings.data);
+    free(literals.data);
+    free(arrays.data);
+
+    return res;
+}
+
+/**
+ * time parsing a cross reference section
+ */
+static nspdferror
+time_xref(const char *name,
+          struct nspdf_doc *doc,
+          struct bench_buffer *buf,
+          unsigned int iterations)
+{
+    struct cos_stream stream;
+    unsigned int iteration;
+    strmoff_t offset;
+    nspdferror res;
+    double start;
+    double elapsed = 0;
+
+    buffer_stream(buf, &stream);
+
+    for (iteration = 0; iteration < iterations; iteration++) {
+        res = nspdf__xref_allocate(doc, XREF_ENTRIES);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+
+        offset = 0;
+        start = time_now();
+        res = nspdf__xref_parse(doc, &stream, &offset);
+        elapsed += time_now() - start;
+
+        nspdf__xref_free(doc);
+        if (res != NSPDFERROR_OK) {
+            printf("%s failed (%d)\n", name, res);
+            return res;
+        }
+    }
+    report(name,
+           elapsed,
+           (uint64_t)XREF_ENTRIES * iterations,
+           (uint64_t)buf->length * iterations);
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * parse of a cross reference table and of a cross reference stream with the
+ *  same entries
+ *
+ * The stream is compressed with the PNG up predictor as is usual for
+ *  cross reference streams.
+ */
+static nspdferror bench_xref(struct nspdf_doc *doc, unsigned int iterations)
+{
+    struct bench_buffer buf = { NULL, 0, 0 };
+    struct bench_buffer xrefstm = { NULL, 0, 0 };
+    uint8_t *rows;
+    uint8_t *row;
+    uint8_t *packed;
+    uLongf packed_length;
+    unsigned int index;
+    unsigned int offset;
+    unsigned int col;
+    nspdferror res;
+
+    buffer_append(&buf, "xref\n0 %u\n0000000000 65535 f\r\n", XREF_ENTRIES);
+    for (index = 1; index < XREF_ENTRIES; index++) {
+        buffer_append(&buf, "%010u 00000 n\r\n", index * 97);
+    }
+    buffer_append(&buf, "trailer\n");
+
+    /* six byte rows of predictor, type, three byte offset and generation */
+    rows = calloc(XREF_ENTRIES, 6);
+    packed_length = compressBound(XREF_ENTRIES * 6);
+    packed = malloc(packed_length);
+    if ((rows == NULL) || (packed == NULL)) {
+        free(rows);
+        free(packed);
+        free(buf.data);
+        return NSPDFERROR_NOMEM;
+    }
+    for (index = 1; index < XREF_ENTRIES; index++) {
+        row = rows + (index * 6);
+        offset = index * 97;
+        row[1] = 1;
+        row[2] = offset >> 16;
+        row[3] = offset >> 8;
+        row[4] = offset;
+    }
+    for (index = XREF_ENTRIES - 1; index > 0; index--) {
+        row = rows + (index * 6);
+        row[0] = 2;
+        for (col = 1; col < 6; col++) {
+            row[col] -= *(row + col - 6);
+        }
+    }
+    rows[0] = 2;
+    compress2(packed, &packed_length, rows, XREF_ENTRIES * 6, 9);
+
+    buffer_append(&xrefstm,
+                  "%u 0 obj\n<< /Type /XRef /Size %u /W [1 3 1] "
+                  "/Filter /FlateDecode "
+                  "/DecodeParms << /Predictor 12 /Columns 5 >> "
+                  "/Length %lu >>\nstream\n",
+                  XREF_ENTRIES,
+                  XREF_ENTRIES,
+                  (unsigned long)packed_length);
+    buffer_append_data(&xrefstm, packed, packed_length);
+    buffer_append(&xrefstm, "\nendstream\nendobj\n");
+
+    free(rows);
+    free(packed);
+
+    res = time_xref("xref_parse", doc, &buf, iterations);
+    if (res == NSPDFERROR_OK) {
+        res = time_xref("xref_stream", doc, &xrefstm, iterations);
+    }
+
+    free(buf.data);
+    free(xrefstm.data);
+
+    return res;
+}
+
+/**
+ * time dereferencing every object compressed in object streams
+ *
+ * If interleave is set consecutive objects are taken from different object
+ *  streams so each lookup misses the decoded object stream cache.
+ */
+static nspdferror
+time_objstm(const char *name,
+            struct nspdf_doc *doc,
+            struct bench_buffer *buf,
+            strmoff_t xref_offset,
+            unsigned int iterations,
+            bool interleave)
+{
+    struct cos_stream stream;
+    struct cos_object ref;
+    struct cos_object *cobj;
+    unsigned int iteration;
+    unsigned int index;
+    unsigned int object;
+    strmoff_t offset;
+    nspdferror res = NSPDFERROR_OK;
+    double start;
+    double elapsed = 0;
+
+    buffer_stream(buf, &stream);
+
+    ref.type = COS_TYPE_REFERENCE;
+    ref.arena = false;
+    ref.u.reference.generation = 0;
+
+    for (iteration = 0; iteration < iterations; iteration++) {
+        res = nspdf__xref_allocate(doc, OBJSTM_SIZE);
+        if (res != NSPDFERROR_OK) {
+            return res;
+        }
+        doc->stream = &stream;
+
+        offset = xref_offset;
+        res = nspdf__xref_parse(doc, &stream, &offset);
+
+        start = time_now();
+        for (index = 0;
+             (res == NSPDFERROR_OK) &&
+                 (index < (OBJSTM_STREAMS * OBJSTM_OBJECTS));
+             index++) {
+            object = index;
+            if (interleave) {
+                object = ((index % OBJSTM_STREAMS) * OBJSTM_OBJECTS) +
+                    (index / OBJSTM_STREAMS);
+            }
+            ref.u.reference.id = OBJSTM_STREAMS + 1 + object;
+            cobj = &ref;
+            res = nspdf__xref_get_referenced(doc, &cobj);
+        }
+        elapsed += time_now() - start;
+
+        nspdf__xref_free(doc);
+        doc->stream = NULL;
+        if (res != NSPDFERROR_OK) {
+            printf("%s failed (%d)\n", name, res);
+            return res;
+        }
+    }
+    report(name,
+           elapsed,
+           (uint64_t)OBJSTM_STREAMS * OBJSTM_OBJECTS * iterations,
+           (uint64_t)buf->length * iterations);
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * lookup of objects compressed in object streams
+ *
+ * Object streams are numbered from one and are followed by the objects they
+ *  hold and a cross reference stream.
+ */
+static nspdferror bench_objstm(struct nspdf_doc *doc, unsigned int iterations)
+{
+    struct bench_buffer buf = { NULL, 0, 0 };
+    struct bench_buffer objects = { NULL, 0, 0 };
+    struct bench_buffer header = { NULL, 0, 0 };
+    strmoff_t offsets[OBJSTM_STREAMS];
+    strmoff_t xref_offset;
+    unsigned int id;
+    unsigned int index;
+    unsigned int object;
+    uint8_t *rows;
+    uint8_t *row;
+    uint8_t *packed;
+    uLongf packed_length;
+    nspdferror res;
+
+    rows = calloc(OBJSTM_SIZE, 5);
+    packed = malloc(compressBound(OBJSTM_OBJECTS * 128));
+    if ((rows == NULL) || (packed == NULL)) {
+        free(rows);
+        free(packed);
+        return NSPDFERROR_NOMEM;
+    }
+
+    for (index = 0; index < OBJSTM_STREAMS; index++) {
+        objects.length = 0;
+        header.length = 0;
+        for (object = 0; object < OBJSTM_OBJECTS; object++) {
+            id = OBJSTM_STREAMS + 1 + (index * OBJSTM_OBJECTS) + object;
+            buffer_append(&header, "%u %u ", id, (unsigned int)objects.length);
+            buffer_append(&objects,
+                          "<< /Type /Annot /Subtype /Link /Rect [%u 0 %u 10] "
+                          "/Border [0 0 0] /Dest [%u 0 R /Fit] >>\n",
+                          object, object + 20, index + 1);
+        }
+        buffer_append_data(&header, objects.data, objects.length);
+
+        packed_length = compressBound(OBJSTM_OBJECTS * 128);
+        compress2(packed, &packed_length, header.data, header.length, 6);
+
+        offsets[index] = buf.length;
+        buffer_append(&buf,
+                      "%u 0 obj\n<< /Type /ObjStm /N %u /First %u "
+                      "/Filter /FlateDecode /Length %lu >>\nstream\n",
+                      index + 1,
+                      OBJSTM_OBJECTS,
+                      (unsigned int)(header.length - objects.length),
+                      (unsigned long)packed_length);
+        buffer_append_data(&buf, packed, packed_length);
+        buffer_append(&buf, "\nendstream\nendobj\n");
+    }
+
+    /* five byte rows of type, three byte offset or stream and index */
+    for (id = 1; id < OBJSTM_SIZE; id++) {
+        row = rows + (id * 5);
+        if (id <= OBJSTM_STREAMS) {
+            row[0] = 1;
+            row[1] = offsets[id - 1] >> 16;
+            row[2] = offsets[id - 1] >> 8;
+            row[3] = offsets[id - 1];
+        } else if (id < (OBJSTM_SIZE - 1)) {
+            row[0] = 2;
+            row[3] = ((id - OBJSTM_STREAMS - 1) / OBJSTM_OBJECTS) + 1;
+            row[4] = (id - OBJSTM_STREAMS - 1) % OBJSTM_OBJECTS;
+        }
+    }
+    xref_offset = buf.length;
+    buffer_append(&buf,
+                  "%u 0 obj\n<< /Type /XRef /Size %u /W [1 3 1] "
+                  "/Length %u >>\nstream\n",
+                  OBJSTM_SIZE - 1,
+                  OBJSTM_SIZE,
+                  OBJSTM_SIZE * 5);
+    buffer_append_data(&buf, rows, OBJSTM_SIZE * 5);
+    buffer_append(&buf, "\nendstream\nendobj\n");
+
+    free(rows);
+    free(packed);
+    free(objects.data);
+    free(header.data);
+
+    res = time_objstm("objstm", doc, &buf, xref_offset, iterations, false);
+    if (res == NSPDFERROR_OK) {
+        res = time_objstm("objstm_interleave",
+                          doc,
+                          &buf,
+                          xref_offset,
+                          iterations,
+                          true);
+    }
+
+    free(buf.data);
+
+    return res;
+}
+
+/**
+ * open of a document with many incremental updates
+ *
+ * Every update replaces the catalog, page tree and page so only the newest
+ *  cross reference section is needed to open the document.
+ */
+static nspdferror bench_incremental(unsigned int iterations)
+{
+    struct bench_buffer buf = { NULL, 0, 0 };
+    struct nspdf_doc *doc;
+    strmoff_t offsets[3];
+    strmoff_t xref_offset = 0;
+    strmoff_t prev;
+    unsigned int update;
+    unsigned int iteration;
+    unsigned int index;
+    nspdferror res = NSPDFERROR_OK;
+    double start;
+    double elapsed = 0;
+
+    buffer_append(&buf, "%%PDF-1.4\n");
+    for (update = 0; update <= INCREMENTAL_UPDATES; update++) {
+        offsets[0] = buf.length;
+        buffer_append(&buf,
+                      "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+        offsets[1] = buf.length;
+        buffer_append(&buf,
+                      "2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\n"
+                      "endobj\n");
+        offsets[2] = buf.length;
+        buffer_append(&buf,
+                      "3 0 obj\n<< /Type /Page /Parent 2 0 R "
+                      "/Resources << >> /MediaBox [0 0 %u 792] >>\n"
+                      "endobj\n",
+                      612 + update);
+
+        prev = xref_offset;
+        xref_offset = buf.length;
+        buffer_append(&buf, "xref\n0 4\n0000000000 65535 f\r\n");
+        for (index = 0; index < 3; index++) {
+            buffer_append(&buf,
+                          "%010u 00000 n\r\n",
+                          (unsigned int)offsets[index]);
+        }
+        buffer_append(&buf, "trailer\n<< /Size 4 /Root 1 0 R");
+        if (update > 0) {
+            buffer_append(&buf, " /Prev %u", (unsigned int)prev);
+        }
+        buffer_append(&buf,
+                      " >>\nstartxref\n%u\n%%%%EOF\n",
+                      (unsigned int)xref_offset);
+    }
+
+    for (iteration = 0; iteration < iterations; iteration++) {
+        res = nspdf_document_create(&doc);
+        if (res != NSPDFERROR_OK) {
+            break;
+        }
+
+        start = time_now();
+        res = nspdf_document_parse(doc, buf.data, buf.length);
+        elapsed += time_now() - start;
+
+        nspdf_document_destroy(doc);
+        if (res != NSPDFERROR_OK) {
+            printf("incremental_open failed (%d)\n", res);
+            break;
+        }
+    }
+    if (res == NSPDFERROR_OK) {
+        report("incremental_open",
+               elapsed,
+               iterations,
+               (uint64_t)buf.length * iterations);
+    }
+
+    free(buf.data);
+
+    return res;
+}
+
+int main(int argc, char **argv)
+{
+    struct nspdf_doc *doc;
+    nspdferror res;
+    unsigned int iterations = 10;
+    const char *content_file = NULL;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        content_file = argv[2];
+    }
+
+    res = nspdf_document_create(&doc);
+    if (res != NSPDFERROR_OK) {
+        printf("failed to create a document\n");
+        return res;
+    }
+
+    res = bench_skip_ws(iterations, content_file);
+    if (res == NSPDFERROR_OK) {
+        res = bench_lexer(doc, iterations, false);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = bench_lexer(doc, iterations, true);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = bench_content(doc, iterations);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = bench_dictionary(doc, iterations);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = bench_resources(doc, iterations);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = bench_widths(doc, iterations);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = bench_containers(doc, iterations);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = bench_xref(doc, iterations);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = bench_objstm(doc, iterations);
+    }
+    if (res == NSPDFERROR_OK) {
+        res = bench_incremental(iterations);
+    }
+
+    nspdf_document_destroy(doc);
+
+    return res;
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/*
+ * Progressively received incremental update test
+ *
+ * Appends a document with an incremental update replacing its information
+ *  dictionary in blocks of several sizes. However the data is split the
+ *  updated title must be found once all the data has been appended.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <libwapcaplet/libwapcaplet.h>
+
+#include <nspdf/document.h>
+#include <nspdf/meta.h>
+#include <nspdf/page.h>
+
+/** number of objects in the document including object zero */
+#define INCR_SIZE 5
+
+/** title of the updated information dictionary */
+#define INCR_TITLE "Updated"
+
+/**
+ * block sizes the document is appended in
+ */
+static const unsigned int block_sizes[] = { 1, 7, 64, 200, 512, 4096 };
+
+#define BLOCK_SIZE_COUNT (sizeof(block_sizes) / sizeof(block_sizes[0]))
+
+/**
+ * append formatted text to the document
+ *
+ * \return The offset the text was placed at.
+ */
+static size_t append_text(char *data, size_t *length, const char *text)
+{
+    size_t offset = *length;
+
+    *length += sprintf(data + *length, "%s", text);
+
+    return offset;
+}
+
+/**
+ * build a document with an original revision and one incremental update
+ *
+ * \return The length of the document.
+ */
+static size_t build_doc(char *data)
+{
+    size_t offsets[INCR_SIZE];
+    size_t length = 0;
+    size_t xref;
+    size_t update;
+    char text[256];
+    unsigned int index;
+
+    append_text(data, &length, "%PDF-1.4\n");
+    offsets[1] = append_text(data,
+                             &length,
+                             "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\n"
+                             "endobj\n");
+    offsets[2] = append_text(data,
+                             &length,
+                             "2 0 obj\n<< /Type /Pages /Kids [3 0 R] "
+                             "/Count 1 >>\nendobj\n");
+    offsets[3] = append_text(data,
+                             &length,
+                             "3 0 obj\n<< /Type /Page /Parent 2 0 R "
+                             "/Resources << >> /MediaBox [0 0 612 792] >>\n"
+                             "endobj\n");
+    offsets[4] = append_text(data,
+                             &length,
+                             "4 0 obj\n<< /Title (Original) >>\nendobj\n");
+
+    xref = append_text(data, &length, "xref\n0 5\n0000000000 65535 f\r\n");
+    for (index = 1; index < INCR_SIZE; index++) {
+        sprintf(text, "%010u 00000 n\r\n", (unsigned int)offsets[index]);
+        append_text(data, &length, text);
+    }
+    sprintf(text,
+            "trailer\n<< /Size %u /Root 1 0 R /Info 4 0 R >>\n"
+            "startxref\n%u\n%%%%EOF\n",
+            INCR_SIZE,
+            (unsigned int)xref);
+    append_text(data, &length, text);
+
+    /* the update replaces the information dictionary */
+    update = append_text(data,
+                         &length,
+                         "4 0 obj\n<< /Title (" INCR_TITLE ") >>\nendobj\n");
+    sprintf(text,
+            "xref\n4 1\n%010u 00000 n\r\n"
+            "trailer\n<< /Size %u /Root 1 0 R /Info 4 0 R /Prev %u >>\n"
+            "startxref\n%u\n%%%%EOF\n",
+            (unsigned int)update,
+            INCR_SIZE,
+            (unsigned int)xref,
+            (unsigned int)length);
+    append_text(data, &length, text);
+
+    return length;
+}
+
+/**
+ * append the document in fixed size blocks and check the updated title
+ */
+static unsigned int
+check_append(const char *data, size_t length, unsigned int block_size)
+{
+    struct nspdf_doc *doc;
+    lwc_string *title;
+    unsigned int page_count;
+    unsigned int failures = 0;
+    size_t offset;
+    size_t block;
+    nspdferror res;
+
+    res = nspdf_document_create(&doc);
+    if (res != NSPDFERROR_OK) {
+        printf("failed to create a document\n");
+        return 1;
+    }
+
+    res = NSPDFERROR_INCOMPLETE;
+    for (offset = 0; offset < length; offset += block) {
+        block = length - offset;
+        if (block > block_size) {
+            block = block_size;
+        }
+        res = nspdf_document_append_data(doc,
+                                         (const uint8_t *)data + offset,
+                                         block);
+        if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_INCOMPLETE)) {
+            break;
+        }
+    }
+    if ((res == NSPDFERROR_OK) || (res == NSPDFERROR_INCOMPLETE)) {
+        res = nspdf_document_append_done(doc);
+    }
+    if (res != NSPDFERROR_OK) {
+        printf("block %u: document parse failed (%d)\n", block_size, res);
+        nspdf_document_destroy(doc);
+        return 1;
+    }
+
+    res = nspdf_page_count(doc, &page_count);
+    if ((res != NSPDFERROR_OK) || (page_count != 1)) {
+        printf("block %u: page count not found (%d)\n", block_size, res);
+        failures++;
+    }
+
+    res = nspdf_get_title(doc, &title);
+    if (res != NSPDFERROR_OK) {
+        printf("block %u: title not found (%d)\n", block_size, res);
+        failures++;
+    } else if (strcmp(lwc_string_data(title), INCR_TITLE) != 0) {
+        printf("block %u: title \"%s\" instead of \"%s\"\n",
+               block_size,
+               lwc_string_data(title),
+               INCR_TITLE);
+        failures++;
+    }
+
+    nspdf_document_destroy(doc);
+
+    return failures;
+}
+
+int main(void)
+{
+    char data[2048];
+    size_t length;
+    unsigned int failures = 0;
+    unsigned int idx;
+
+    length = build_doc(data);
+
+    for (idx = 0; idx < BLOCK_SIZE_COUNT; idx++) {
+        failures += check_append(data, length, block_sizes[idx]);
+    }
+
+    printf("%u block sizes checked, %u failures\n",
+           (unsigned int)BLOCK_SIZE_COUNT,
+           failures);
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/*
+ * Number parser equivalence fuzz test
+ *
+ * Parses random numeric tokens with the COS lexer and compares the result
+ *  with the original two pass implementation which collected the decimal
+ *  places before summing them. The optional argument is the number of random
+ *  tokens to check.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <nspdf/document.h>
+
+#include "cos_stream.h"
+#include "cos_object.h"
+#include "cos_parse.h"
+#include "pdf_doc.h"
+#include "byte_class.h"
+
+/** largest token generated */
+#define TOKEN_MAX 28
+
+/**
+ * result of the reference parser
+ */
+struct ref_number {
+    nspdferror res;
+    bool real;
+    int64_t i;
+    float real_value;
+    unsigned int length; /**< bytes consumed including trailing whitespace */
+    bool comparable; /**< false if the reference overflowed its divisor */
+};
+
+/**
+ * original two pass number parser
+ */
+static void
+ref_parse_number(const uint8_t *data, struct ref_number *ref)
+{
+    uint8_t c;
+    unsigned int len;
+    uint8_t num[21];
+    unsigned int offset = 0;
+    unsigned int point = 0;
+    bool real = false;
+    bool neg = false;
+
+    ref->comparable = true;
+
+    c = data[offset];
+    if (c == '-') {
+        neg = true;
+        offset++;
+    } else if (c == '+') {
+        neg = false;
+        offset++;
+    }
+
+    for (len = 0; len < sizeof(num); len++) {
+        c = data[offset];
+
+        if (c == '.') {
+            real = true;
+            point = len;
+            offset++;
+            c = data[offset];
+        }
+
+        if ((bclass[c] & BC_DCML) != BC_DCML) {
+            int64_t result = 0;
+            uint64_t tens;
+
+            if (len == 0) {
+                ref->res = NSPDFERROR_SYNTAX;
+                return;
+            }
+
+            point = len - point;
+
+            for (tens = 1; len > 0; tens = tens * 10, len--) {
+                result += (num[len - 1] * tens);
+            }
+
+            while ((bclass[data[offset]] & BC_WSPC) != 0) {
+                offset++;
+            }
+
+            ref->res = NSPDFERROR_OK;
+            ref->real = real;
+            ref->length = offset;
+            if (real) {
+                unsigned int div = 1;
+
+                if (point > 9) {
+                    /* the divisor overflowed */
+                    ref->comparable = false;
+                }
+                for (; point > 0;point--) {
+                    div = div * 10;
+                }
+                if (neg) {
+                    ref->real_value = -((float)result / div);
+                } else {
+                    ref->real_value = (float)result / div;
+                }
+            } else {
+                if (neg) {
+                    ref->i = -result;
+                } else {
+                    ref->i = result;
+                }
+            }
+            return;
+        }
+        num[len] = c - '0';
+        offset++;
+    }
+    ref->res = NSPDFERROR_RANGE;
+}
+
+/**
+ * generate a random numeric token followed by whitespace and padding
+ */
+static unsigned int random_token(uint8_t *data)
+{
+    static const char alphabet[] = "0123456789012345678901234567890123456789.+-";
+    unsigned int len;
+    unsigned int idx;
+
+    len = 1 + (rand() % TOKEN_MAX);
+    for (idx = 0; idx < len; idx++) {
+        data[idx] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    /* mostly numbers with at most one point */
+    if ((rand() % 4) != 0) {
+        for (idx = 1; idx < len; idx++) {
+            if ((data[idx] == '+') || (data[idx] == '-')) {
+                data[idx] = '0' + (rand() % 10);
+            }
+        }
+    }
+    data[len++] = ' ';
+    stream_pad(data + len);
+
+    return len;
+}
+
+/**
+ * check one token
+ *
+ * \return true if the parsers agree
+ */
+static bool
+check_token(struct nspdf_doc *doc, uint8_t *data, unsigned int len)
+{
+    struct cos_stream stream;
+    struct cos_object *cobj;
+    struct ref_number ref;
+    strmoff_t offset = 0;
+    nspdferror res;
+    bool same;
+
+    switch (data[0]) {
+    case '-': case '+': case '.': case '0': case '1': case '2': case '3':
+    case '4': case '5': case '6': case '7': case '8': case '9':
+        break;
+
+    default:
+        /* not a number token */
+        return true;
+    }
+
+    ref_parse_number(data, &ref);
+    if (ref.comparable == false) {
+        return true;
+    }
+
+    stream.data = data;
+    stream.length = len;
+    stream.alloc = 0;
+    stream.source = NULL;
+    stream.arena = NULL;
+
+    res = cos_parse_object(doc, &stream, &offset, &cobj);
+    if (res != ref.res) {
+        same = false;
+    } else if (res != NSPDFERROR_OK) {
+        same = true;
+    } else {
+        if (ref.real) {
+            same = (cobj->type == COS_TYPE_REAL) &&
+                (memcmp(&cobj->u.real, &ref.real_value, sizeof(float)) == 0);
+        } else {
+            same = (cobj->type == COS_TYPE_INT) && (cobj->u.i == ref.i);
+        }
+        if (offset != ref.length) {
+            same = false;
+        }
+        cos_free_object(cobj);
+    }
+
+    if (same == false) {
+        printf("mismatch on \"%.*s\" result %d expected %d\n",
+               (int)(len - 1), data, res, ref.res);
+    }
+
+    return same;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *fixed[] = {
+        "0", "1", "-1", "+17", "123.456", "-.002", "4.", "-0.0", ".5",
+        "2147483648", "9223372036854775807", "12345678901234567890",
+        "123456789012345678901", "1.23456789", "0.000000001", "-", ".",
+        "+.", "1.2.3", "--1", NULL
+    };
+    uint8_t data[TOKEN_MAX + 1 + STREAM_PADDING];
+    struct nspdf_doc *doc;
+    nspdferror res;
+    unsigned int count = 1000000;
+    unsigned int idx;
+    unsigned int len;
+    unsigned int mismatches = 0;
+
+    if (argc > 1) {
+        count = strtoul(argv[1], NULL, 0);
+    }
+
+    res = nspdf_document_create(&doc);
+    if (res != NSPDFERROR_OK) {
+        printf("failed to create a document\n");
+        return res;
+    }
+
+    for (idx = 0; fixed[idx] != NULL; idx++) {
+        len = strlen(fixed[idx]);
+        memcpy(data, fixed[idx], len);
+        data[len++] = ' ';
+        stream_pad(data + len);
+        if (check_token(doc, data, len) == false) {
+            mismatches++;
+        }
+    }
+
+    srand(1);
+    for (idx = 0; idx < count; idx++) {
+        len = random_token(data);
+        if (check_token(doc, data, len) == false) {
+            mismatches++;
+        }
+    }
+
+    nspdf_document_destroy(doc);
+
+    printf("%u numbers checked, %u mismatches\n",
+           count + (unsigned int)(sizeof(fixed) / sizeof(fixed[0])) - 1,
+           mismatches);
+
+    return (mismatches == 0) ? 0 : 1;
+}
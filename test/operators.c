@@ -0,0 +1,283 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/*
+ * Content stream operator lookup test
+ *
+ * Checks every operator in the table below is found by the operator hash and
+ *  is recognised in a content stream, and that names which are not operators
+ *  are rejected.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <nspdf/document.h>
+
+#include "cos_stream.h"
+#include "cos_object.h"
+#include "cos_content.h"
+#include "cos_parse.h"
+#include "pdf_doc.h"
+
+/**
+ * operator names and the operator each should be found as
+ */
+static const struct {
+    const char *name;
+    enum content_operator operator;
+} operators[] = {
+    { "b", CONTENT_OP_b },
+    { "B", CONTENT_OP_B },
+    { "b*", CONTENT_OP_b_ },
+    { "B*", CONTENT_OP_B_ },
+    { "BDC", CONTENT_OP_BDC },
+    { "BI", CONTENT_OP_BI },
+    { "BMC", CONTENT_OP_BMC },
+    { "BT", CONTENT_OP_BT },
+    { "BX", CONTENT_OP_BX },
+    { "c", CONTENT_OP_c },
+    { "cm", CONTENT_OP_cm },
+    { "CS", CONTENT_OP_CS },
+    { "cs", CONTENT_OP_cs },
+    { "d", CONTENT_OP_d },
+    { "d0", CONTENT_OP_d0 },
+    { "d1", CONTENT_OP_d1 },
+    { "Do", CONTENT_OP_Do },
+    { "DP", CONTENT_OP_DP },
+    { "EI", CONTENT_OP_EI },
+    { "EMC", CONTENT_OP_EMC },
+    { "ET", CONTENT_OP_ET },
+    { "EX", CONTENT_OP_EX },
+    { "f", CONTENT_OP_f },
+    { "F", CONTENT_OP_F },
+    { "f*", CONTENT_OP_f_ },
+    { "G", CONTENT_OP_G },
+    { "g", CONTENT_OP_g },
+    { "gs", CONTENT_OP_gs },
+    { "h", CONTENT_OP_h },
+    { "i", CONTENT_OP_i },
+    { "ID", CONTENT_OP_ID },
+    { "j", CONTENT_OP_j },
+    { "J", CONTENT_OP_J },
+    { "K", CONTENT_OP_K },
+    { "k", CONTENT_OP_k },
+    { "l", CONTENT_OP_l },
+    { "m", CONTENT_OP_m },
+    { "M", CONTENT_OP_M },
+    { "MP", CONTENT_OP_MP },
+    { "n", CONTENT_OP_n },
+    { "q", CONTENT_OP_q },
+    { "Q", CONTENT_OP_Q },
+    { "re", CONTENT_OP_re },
+    { "RG", CONTENT_OP_RG },
+    { "rg", CONTENT_OP_rg },
+    { "ri", CONTENT_OP_ri },
+    { "s", CONTENT_OP_s },
+    { "S", CONTENT_OP_S },
+    { "SC", CONTENT_OP_SC },
+    { "sc", CONTENT_OP_sc },
+    { "SCN", CONTENT_OP_SCN },
+    { "scn", CONTENT_OP_scn },
+    { "sh", CONTENT_OP_sh },
+    { "T*", CONTENT_OP_T_ },
+    { "Tc", CONTENT_OP_Tc },
+    { "Td", CONTENT_OP_Td },
+    { "TD", CONTENT_OP_TD },
+    { "Tf", CONTENT_OP_Tf },
+    { "Tj", CONTENT_OP_Tj },
+    { "TJ", CONTENT_OP_TJ },
+    { "TL", CONTENT_OP_TL },
+    { "Tm", CONTENT_OP_Tm },
+    { "Tr", CONTENT_OP_Tr },
+    { "Ts", CONTENT_OP_Ts },
+    { "Tw", CONTENT_OP_Tw },
+    { "Tz", CONTENT_OP_Tz },
+    { "v", CONTENT_OP_v },
+    { "w", CONTENT_OP_w },
+    { "W", CONTENT_OP_W },
+    { "W*", CONTENT_OP_W_ },
+    { "y", CONTENT_OP_y },
+    { "'", CONTENT_OP__ },
+    { "\"", CONTENT_OP___ },
+};
+
+#define OPERATOR_COUNT (sizeof(operators) / sizeof(operators[0]))
+
+/**
+ * names which are not operators
+ */
+static const char *not_operators[] = {
+    "SS", "BB", "Tx", "x", "a", "Sc", "sC", "BD", "EM", "SCn", "sCN",
+    "T", "D", "E", "**", "\"\"", "''", "b**", "TJJ", NULL
+};
+
+/**
+ * pack an operator name into a lookup key
+ */
+static uint32_t operator_key(const char *name)
+{
+    uint32_t key = 0;
+
+    while (*name != 0) {
+        key = (key << 8) | (uint8_t)*name;
+        name++;
+    }
+    return key;
+}
+
+/**
+ * check every operator is found by its lookup key and has its name
+ */
+static unsigned int check_lookup(void)
+{
+    bool seen[OPERATOR_COUNT];
+    enum content_operator operator;
+    unsigned int failures = 0;
+    unsigned int idx;
+    nspdferror res;
+
+    memset(seen, 0, sizeof(seen));
+
+    for (idx = 0; idx < OPERATOR_COUNT; idx++) {
+        res = nspdf__cos_content_operator(operator_key(operators[idx].name),
+                                          &operator);
+        if ((res != NSPDFERROR_OK) ||
+            (operator != operators[idx].operator)) {
+            printf("operator \"%s\" not found (%d)\n",
+                   operators[idx].name, res);
+            failures++;
+            continue;
+        }
+        if (strcmp(nspdf__cos_content_operator_name(operator),
+                   operators[idx].name) != 0) {
+            printf("operator \"%s\" named \"%s\"\n",
+                   operators[idx].name,
+                   nspdf__cos_content_operator_name(operator));
+            failures++;
+        }
+        if ((unsigned int)operator >= OPERATOR_COUNT) {
+            printf("operator \"%s\" out of range\n", operators[idx].name);
+            failures++;
+        } else if (seen[operator]) {
+            printf("operator \"%s\" listed twice\n", operators[idx].name);
+            failures++;
+        } else {
+            seen[operator] = true;
+        }
+    }
+
+    for (idx = 0; not_operators[idx] != NULL; idx++) {
+        res = nspdf__cos_content_operator(operator_key(not_operators[idx]),
+                                          &operator);
+        if (res != NSPDFERROR_NOTFOUND) {
+            printf("\"%s\" found as operator %s\n",
+                   not_operators[idx],
+                   nspdf__cos_content_operator_name(operator));
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+/**
+ * check every operator is recognised in a content stream
+ */
+static unsigned int check_content(struct nspdf_doc *doc)
+{
+    uint8_t data[OPERATOR_COUNT * 4 + STREAM_PADDING];
+    struct cos_stream stream;
+    struct cos_stream *streams = &stream;
+    struct cos_object *content;
+    struct content_operation operation;
+    size_t offset = 0;
+    unsigned int failures = 0;
+    unsigned int length = 0;
+    unsigned int idx;
+    nspdferror res;
+
+    for (idx = 0; idx < OPERATOR_COUNT; idx++) {
+        length += sprintf((char *)data + length, "%s\n", operators[idx].name);
+    }
+    stream_pad(data + length);
+
+    stream.data = data;
+    stream.length = length;
+    stream.alloc = 0;
+    stream.source = NULL;
+    stream.arena = NULL;
+
+    res = cos_parse_content_streams(doc, &streams, 1, &content);
+    if (res != NSPDFERROR_OK) {
+        printf("content parse failed (%d)\n", res);
+        return 1;
+    }
+
+    if (content->u.content->length != OPERATOR_COUNT) {
+        printf("content has %u operations instead of %u\n",
+               content->u.content->length,
+               (unsigned int)OPERATOR_COUNT);
+        failures++;
+    } else {
+        for (idx = 0; idx < OPERATOR_COUNT; idx++) {
+            res = nspdf__cos_content_next(content->u.content,
+                                          &offset,
+                                          &operation);
+            if (res != NSPDFERROR_OK) {
+                printf("content operator \"%s\" not decoded (%d)\n",
+                       operators[idx].name, res);
+                failures++;
+                break;
+            }
+            if (operation.operator != operators[idx].operator) {
+                printf("content operator \"%s\" parsed as %s\n",
+                       operators[idx].name,
+                       nspdf__cos_content_operator_name(operation.operator));
+                failures++;
+            }
+        }
+        if (offset != content->u.content->size) {
+            printf("content decoded %zu of %zu bytes\n",
+                   offset, content->u.content->size);
+            failures++;
+        }
+    }
+
+    cos_free_object(content);
+
+    return failures;
+}
+
+int main(void)
+{
+    struct nspdf_doc *doc;
+    unsigned int failures;
+    nspdferror res;
+
+    res = nspdf_document_create(&doc);
+    if (res != NSPDFERROR_OK) {
+        printf("failed to create a document\n");
+        return res;
+    }
+
+    failures = check_lookup();
+    failures += check_content(doc);
+
+    nspdf_document_destroy(doc);
+
+    printf("%u operators checked, %u failures\n",
+           (unsigned int)OPERATOR_COUNT,
+           failures);
+
+    return (failures == 0) ? 0 : 1;
+}
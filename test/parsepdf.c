@@ -20,13 +20,18 @@
 #include <nspdf/meta.h>
 #include <nspdf/page.h>
 
+/**
+ * feed a file to the document in fixed size blocks as if being downloaded
+ */
 static nspdferror
-read_whole_pdf(const char *fname, uint8_t **buffer, uint64_t *buffer_length)
+append_whole_pdf(struct nspdf_doc *doc, const char *fname, size_t block_size)
 {
     FILE *f;
-    off_t len;
     uint8_t *buf;
     size_t rd;
+    nspdferror res = NSPDFERROR_INCOMPLETE;
+    size_t total = 0;
+    bool ready = false;
 
     f = fopen(fname, "r");
     if (f == NULL) {
@@ -34,27 +39,78 @@ read_whole_pdf(const char *fname, uint8_t **buffer, uint64_t *buffer_length)
         return NSPDFERROR_NOTFOUND;
     }
 
-    fseek(f, 0, SEEK_END);
-    len = ftello(f);
+    buf = malloc(block_size);
+    if (buf == NULL) {
+        fclose(f);
+        return NSPDFERROR_NOMEM;
+    }
 
-    buf = malloc(len);
-    fseek(f, 0, SEEK_SET);
+    while ((rd = fread(buf, 1, block_size, f)) > 0) {
+        res = nspdf_document_append_data(doc, buf, rd);
+        total += rd;
+        if ((res != NSPDFERROR_OK) && (res != NSPDFERROR_INCOMPLETE)) {
+            break;
+        }
+        if ((ready == false) &&
+            (res == NSPDFERROR_OK) &&
+            (nspdf_document_ready(doc) == NSPDFERROR_OK)) {
+            printf("ready after %zu bytes\n", total);
+            ready = true;
+        }
+    }
+    free(buf);
+    fclose(f);
 
-    rd = fread(buf, len, 1, f);
-    if (rd != 1) {
-        perror("pdf read");
-        free(buf);
-        return 1;
+    if ((res == NSPDFERROR_OK) || (res == NSPDFERROR_INCOMPLETE)) {
+        res = nspdf_document_append_done(doc);
     }
 
-    fclose(f);
+    return res;
+}
 
-    *buffer = buf;
-    *buffer_length = len;
+/**
+ * byte source fetch from a file as a stand in for a byte range fetcher
+ */
+static nspdferror
+file_fetch(void *ctx, uint64_t offset, uint8_t *buffer, size_t length)
+{
+    FILE *f = ctx;
 
+    if (fseeko(f, offset, SEEK_SET) != 0) {
+        return NSPDFERROR_RANGE;
+    }
+    if (fread(buffer, 1, length, f) != length) {
+        return NSPDFERROR_SIZE;
+    }
     return NSPDFERROR_OK;
 }
 
+/**
+ * open a document through a byte source reading chunks from a file
+ */
+static nspdferror
+source_whole_pdf(struct nspdf_doc *doc,
+                 const char *fname,
+                 size_t chunk_size,
+                 FILE **f_out)
+{
+    FILE *f;
+    off_t length;
+
+    f = fopen(fname, "r");
+    if (f == NULL) {
+        perror("pdf open");
+        return NSPDFERROR_NOTFOUND;
+    }
+
+    fseeko(f, 0, SEEK_END);
+    length = ftello(f);
+
+    *f_out = f;
+
+    return nspdf_document_open_source(doc, file_fetch, f, length, chunk_size);
+}
+
 static nspdferror
 pdf_path(const struct nspdf_style *style,
          const float *path,
@@ -97,7 +153,7 @@ static nspdferror render_pages(struct nspdf_doc *doc, unsigned int page_count)
 
     for (page_index = 0; page_index < 4; page_index++) {
         res = nspdf_get_page_dimensions(doc,
-                                        page_index,
+                                        page_render_list[page_index],
                                         &page_width,
                                         &page_height);
         printf("page w:%f h:%f\n", page_width, page_height);
@@ -113,31 +169,41 @@ static nspdferror render_pages(struct nspdf_doc *doc, unsigned int page_count)
 
 int main(int argc, char **argv)
 {
-    uint8_t *buffer;
-    uint64_t buffer_length;
     struct nspdf_doc *doc;
     nspdferror res;
     struct lwc_string_s *title;
     unsigned int page_count;
+    unsigned int page_index;
+    FILE *source_file = NULL;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t allocs;
+    uint64_t bytes;
+    uint64_t blocks;
 
-    if (argc < 2) {
-        fprintf(stderr, "Usage %s <filename>\n", argv[0]);
+    if ((argc != 2) && (argc != 4)) {
+        fprintf(stderr,
+                "Usage %s <filename> [append <block size>|source <chunk size>]\n",
+                argv[0]);
         return 1;
     }
 
-    res = read_whole_pdf(argv[1], &buffer, &buffer_length);
-    if (res != 0) {
-        printf("failed to read file\n");
-        return res;
-    }
-
     res = nspdf_document_create(&doc);
     if (res != NSPDFERROR_OK) {
         printf("failed to create a document\n");
         return res;
     }
 
-    res = nspdf_document_parse(doc, buffer, buffer_length);
+    if ((argc > 3) && (strcmp(argv[2], "append") == 0)) {
+        res = append_whole_pdf(doc, argv[1], strtoul(argv[3], NULL, 0));
+    } else if ((argc > 3) && (strcmp(argv[2], "source") == 0)) {
+        res = source_whole_pdf(doc,
+                               argv[1],
+                               strtoul(argv[3], NULL, 0),
+                               &source_file);
+    } else {
+        res = nspdf_document_open_file(doc, argv[1]);
+    }
     if (res != NSPDFERROR_OK) {
         printf("document parse failed (%d)\n", res);
         return res;
@@ -153,19 +219,43 @@ int main(int argc, char **argv)
         printf("Pages:%d\n", page_count);
     }
 
+    for (page_index = 0; page_index < page_count; page_index++) {
+        uint64_t offset;
+        uint64_t length;
+
+        res = nspdf_get_page_byte_range(doc, page_index, &offset, &length);
+        if (res != NSPDFERROR_OK) {
+            break;
+        }
+        printf("page %u bytes %" PRIu64 "+%" PRIu64 "\n",
+               page_index, offset, length);
+    }
+
     res = render_pages(doc, page_count);
         if (res != NSPDFERROR_OK) {
             printf("page render failed (%d)\n", res);
             return res;
         }
 
+    if (nspdf_document_source_stats(doc, &hits, &misses) == NSPDFERROR_OK) {
+        printf("chunk cache hits:%" PRIu64 " misses:%" PRIu64 "\n",
+               hits, misses);
+    }
+
+    if (nspdf_document_arena_stats(doc, &allocs, &bytes, &blocks) ==
+        NSPDFERROR_OK) {
+        printf("object arena allocations:%" PRIu64 " bytes:%" PRIu64
+               " blocks:%" PRIu64 "\n", allocs, bytes, blocks);
+    }
+
     res = nspdf_document_destroy(doc);
+    if (source_file != NULL) {
+        fclose(source_file);
+    }
     if (res != NSPDFERROR_OK) {
         printf("failed to destroy document (%d)\n", res);
         return res;
     }
 
-    free(buffer);
-
     return 0;
 }
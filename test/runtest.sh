@@ -2,3 +2,10 @@
 TEST_PATH=$1
 
 ${TEST_PATH}/test_parsepdf test/files/sn74ls173a.pdf
+${TEST_PATH}/test_parsepdf test/files/sn74ls173a.pdf append 4096
+${TEST_PATH}/test_parsepdf test/files/sn74ls173a.pdf source 4096
+${TEST_PATH}/test_benchmark 1
+${TEST_PATH}/test_numparse
+${TEST_PATH}/test_operators
+${TEST_PATH}/test_xrefwide
+${TEST_PATH}/test_incremental
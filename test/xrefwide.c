@@ -0,0 +1,230 @@
+/*
+ * Copyright 2018 Vincent Sanders <vince@netsurf-browser.org>
+ *
+ * This file is part of libnspdf.
+ *
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/*
+ * Cross reference offsets beyond 4GiB test
+ *
+ * Opens a synthetic document through a byte source. The catalog is near the
+ *  start and the page tree, information dictionary and a cross reference
+ *  stream with five byte offset fields are placed beyond 4GiB. The bytes
+ *  between are never stored. The document is opened with both a dense and a
+ *  sparse cross reference table.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <libwapcaplet/libwapcaplet.h>
+
+#include <nspdf/document.h>
+#include <nspdf/meta.h>
+#include <nspdf/page.h>
+
+/** offset of the objects placed beyond 4GiB */
+#define WIDE_BASE UINT64_C(0x140000000)
+
+/** number of entries in the cross reference stream */
+#define WIDE_ENTRIES 6
+
+/** title of the information dictionary */
+#define WIDE_TITLE "Beyond 4GiB"
+
+/**
+ * synthetic document data
+ */
+struct wide_doc {
+    uint8_t head[256]; /**< data at the start of the document */
+    size_t head_length;
+    uint8_t tail[1024]; /**< data at WIDE_BASE */
+    size_t tail_length;
+};
+
+/**
+ * append formatted text to a synthetic document region
+ */
+static uint64_t
+region_text(uint8_t *region, size_t *length, const char *text)
+{
+    uint64_t offset = *length;
+
+    memcpy(region + *length, text, strlen(text));
+    *length += strlen(text);
+
+    return offset;
+}
+
+/**
+ * build the synthetic document
+ *
+ * \param doc The document data to fill.
+ * \param size The Size entry of the cross reference stream.
+ * \return The length of the document.
+ */
+static uint64_t build_doc(struct wide_doc *doc, unsigned int size)
+{
+    uint64_t offsets[WIDE_ENTRIES];
+    char text[256];
+    uint8_t *row;
+    unsigned int index;
+    unsigned int byte;
+
+    doc->head_length = 0;
+    doc->tail_length = 0;
+
+    region_text(doc->head, &doc->head_length, "%PDF-1.5\n");
+    offsets[0] = 0;
+    offsets[1] = region_text(doc->head,
+                             &doc->head_length,
+                             "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\n"
+                             "endobj\n");
+
+    offsets[2] = WIDE_BASE + region_text(doc->tail,
+                                         &doc->tail_length,
+                                         "2 0 obj\n<< /Type /Pages "
+                                         "/Kids [3 0 R] /Count 1 >>\n"
+                                         "endobj\n");
+    offsets[3] = WIDE_BASE + region_text(doc->tail,
+                                         &doc->tail_length,
+                                         "3 0 obj\n<< /Type /Page "
+                                         "/Parent 2 0 R /Resources << >> "
+                                         "/MediaBox [0 0 612 792] >>\n"
+                                         "endobj\n");
+    offsets[4] = WIDE_BASE + region_text(doc->tail,
+                                         &doc->tail_length,
+                                         "4 0 obj\n<< /Title (" WIDE_TITLE
+                                         ") >>\nendobj\n");
+    offsets[5] = WIDE_BASE + doc->tail_length;
+
+    snprintf(text,
+             sizeof(text),
+             "5 0 obj\n<< /Type /XRef /Size %u /Index [0 %u] /W [1 5 1] "
+             "/Root 1 0 R /Info 4 0 R /Length %u >>\nstream\n",
+             size,
+             WIDE_ENTRIES,
+             WIDE_ENTRIES * 7);
+    region_text(doc->tail, &doc->tail_length, text);
+
+    /* rows of type, five byte offset and generation */
+    for (index = 0; index < WIDE_ENTRIES; index++) {
+        row = doc->tail + doc->tail_length;
+        row[0] = (index == 0) ? 0 : 1;
+        for (byte = 0; byte < 5; byte++) {
+            row[1 + byte] = offsets[index] >> (8 * (4 - byte));
+        }
+        row[6] = (index == 0) ? 255 : 0;
+        doc->tail_length += 7;
+    }
+
+    snprintf(text,
+             sizeof(text),
+             "\nendstream\nendobj\nstartxref\n%" PRIu64 "\n%%%%EOF\n",
+             offsets[5]);
+    region_text(doc->tail, &doc->tail_length, text);
+
+    return WIDE_BASE + doc->tail_length;
+}
+
+/**
+ * byte source fetch from the synthetic document
+ *
+ * Bytes outside the stored regions read as spaces.
+ */
+static nspdferror
+wide_fetch(void *ctx, uint64_t offset, uint8_t *buffer, size_t length)
+{
+    struct wide_doc *doc = ctx;
+    uint64_t start;
+    uint64_t end;
+
+    memset(buffer, ' ', length);
+
+    if (offset < doc->head_length) {
+        end = offset + length;
+        if (end > doc->head_length) {
+            end = doc->head_length;
+        }
+        memcpy(buffer, doc->head + offset, end - offset);
+    }
+
+    start = (offset > WIDE_BASE) ? offset : WIDE_BASE;
+    end = offset + length;
+    if (end > (WIDE_BASE + doc->tail_length)) {
+        end = WIDE_BASE + doc->tail_length;
+    }
+    if (start < end) {
+        memcpy(buffer + (start - offset),
+               doc->tail + (start - WIDE_BASE),
+               end - start);
+    }
+
+    return NSPDFERROR_OK;
+}
+
+/**
+ * open the synthetic document and check the objects beyond 4GiB resolve
+ */
+static unsigned int check_wide(struct wide_doc *wdoc, unsigned int size)
+{
+    struct nspdf_doc *doc;
+    lwc_string *title;
+    unsigned int page_count;
+    uint64_t length;
+    unsigned int failures = 0;
+    nspdferror res;
+
+    length = build_doc(wdoc, size);
+
+    res = nspdf_document_create(&doc);
+    if (res != NSPDFERROR_OK) {
+        printf("failed to create a document\n");
+        return 1;
+    }
+
+    res = nspdf_document_open_source(doc, wide_fetch, wdoc, length, 4096);
+    if (res != NSPDFERROR_OK) {
+        printf("Size %u: document parse failed (%d)\n", size, res);
+        nspdf_document_destroy(doc);
+        return 1;
+    }
+
+    res = nspdf_page_count(doc, &page_count);
+    if ((res != NSPDFERROR_OK) || (page_count != 1)) {
+        printf("Size %u: page count not found (%d)\n", size, res);
+        failures++;
+    }
+
+    res = nspdf_get_title(doc, &title);
+    if ((res != NSPDFERROR_OK) ||
+        (strcmp(lwc_string_data(title), WIDE_TITLE) != 0)) {
+        printf("Size %u: title not found (%d)\n", size, res);
+        failures++;
+    }
+
+    nspdf_document_destroy(doc);
+
+    return failures;
+}
+
+int main(void)
+{
+    struct wide_doc wdoc;
+    unsigned int failures;
+
+    /* dense table then sparse table for an inflated size */
+    failures = check_wide(&wdoc, WIDE_ENTRIES);
+    failures += check_wide(&wdoc, 1000000);
+
+    printf("offsets beyond 4GiB checked, %u failures\n", failures);
+
+    return (failures == 0) ? 0 : 1;
+}